@@ -0,0 +1,204 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "util/SpinLock.hpp"
+
+namespace skv::ondisk {
+
+/**
+ * @brief Sharded segmented LRU cache of device blocks.
+ * New blocks are admitted to the probationary segment and promoted to the protected one only when hit again,
+ * so one-time reads (scans, compaction) evict each other instead of the hot working set
+ */
+template <typename Key, typename Value, typename Hash = std::hash<std::decay_t<Key>>>
+class BlockCache final {
+public:
+    static constexpr std::size_t DEFAULT_SHARDS = 16;
+    static constexpr double PROTECTED_RATIO = 0.8; // share of shard capacity used by protected segment
+
+    using key_type      = std::decay_t<Key>;
+    using value_type    = std::decay_t<Value>;
+
+    struct Stats {
+        std::uint64_t hits{0};
+        std::uint64_t misses{0};
+        std::uint64_t evictions{0};
+        std::size_t size{0};        // cached blocks
+        std::size_t capacity{0};    // max cached blocks
+    };
+
+    /**
+     * @param capacity - max count of cached blocks
+     * @param shards - count of independently locked shards
+     */
+    explicit BlockCache(std::size_t capacity, std::size_t shards = DEFAULT_SHARDS):
+        shards_(std::max<std::size_t>(std::min(shards, capacity), 1))
+    {
+        const auto shardCapacity = std::max<std::size_t>((capacity + shards_.size() - 1) / shards_.size(), 1);
+
+        for (auto& shard : shards_) {
+            shard.capacity = shardCapacity;
+            shard.protectedCapacity = std::size_t(double(shardCapacity) * PROTECTED_RATIO);
+        }
+
+        capacity_ = shardCapacity * shards_.size();
+    }
+
+    ~BlockCache() noexcept = default;
+
+    BlockCache(const BlockCache&) = delete;
+    BlockCache& operator=(const BlockCache&) = delete;
+
+    BlockCache(BlockCache&&) = delete;
+    BlockCache& operator=(BlockCache&&) = delete;
+
+    /**
+     * @brief Admits block to probationary segment. Existing block is replaced in place
+     */
+    void insert(const key_type& key, const value_type& value) {
+        auto& shard = shardOf(key);
+        std::lock_guard locker(shard.lock);
+
+        if (auto it = shard.index.find(key); it != std::end(shard.index)) {
+            it->second->value = value;
+
+            return;
+        }
+
+        shard.probation.push_front(Item{key, value, false});
+
+        try {
+            shard.index.emplace(key, std::begin(shard.probation));
+        }
+        catch (...) {
+            shard.probation.pop_front();
+
+            throw;
+        }
+
+        while (shard.probation.size() + shard.protectedItems.size() > shard.capacity) {
+            auto& victims = shard.probation.empty()? shard.protectedItems : shard.probation;
+
+            shard.index.erase(victims.back().key);
+            victims.pop_back();
+
+            evictions_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Looks up block, promotes it to protected segment on hit
+     * @return true on hit
+     */
+    bool lookup(const key_type& key, value_type& value) {
+        auto& shard = shardOf(key);
+        std::lock_guard locker(shard.lock);
+
+        auto it = shard.index.find(key);
+
+        if (it == std::end(shard.index)) {
+            misses_.fetch_add(1, std::memory_order_relaxed);
+
+            return false;
+        }
+
+        hits_.fetch_add(1, std::memory_order_relaxed);
+
+        auto item = it->second;
+
+        value = item->value;
+
+        if (item->isProtected)
+            shard.protectedItems.splice(std::begin(shard.protectedItems), shard.protectedItems, item);
+        else {
+            item->isProtected = true;
+            shard.protectedItems.splice(std::begin(shard.protectedItems), shard.probation, item);
+
+            if (shard.protectedItems.size() > shard.protectedCapacity && shard.protectedItems.size() > 1) {
+                auto demoted = std::prev(std::end(shard.protectedItems));
+
+                demoted->isProtected = false;
+                shard.probation.splice(std::begin(shard.probation), shard.protectedItems, demoted);
+            }
+        }
+
+        return true;
+    }
+
+    void clear() {
+        for (auto& shard : shards_) {
+            std::lock_guard locker(shard.lock);
+
+            shard.index.clear();
+            shard.probation.clear();
+            shard.protectedItems.clear();
+        }
+    }
+
+    std::size_t size() const noexcept {
+        std::size_t total = 0;
+
+        for (auto& shard : shards_) {
+            std::lock_guard locker(shard.lock);
+
+            total += shard.index.size();
+        }
+
+        return total;
+    }
+
+    std::size_t capacity() const noexcept {
+        return capacity_;
+    }
+
+    Stats stats() const noexcept {
+        Stats s;
+
+        s.hits = hits_.load(std::memory_order_relaxed);
+        s.misses = misses_.load(std::memory_order_relaxed);
+        s.evictions = evictions_.load(std::memory_order_relaxed);
+        s.size = size();
+        s.capacity = capacity();
+
+        return s;
+    }
+
+private:
+    struct Item {
+        key_type key;
+        value_type value;
+        bool isProtected;
+    };
+
+    using list_type = std::list<Item>;
+
+    struct Shard {
+        mutable util::SpinLock<> lock; // all operations are short, as in MRUCache
+        list_type probation;
+        list_type protectedItems;
+        std::unordered_map<key_type, typename list_type::iterator, Hash> index;
+        std::size_t capacity{0};
+        std::size_t protectedCapacity{0};
+    };
+
+    Shard& shardOf(const key_type& key) noexcept {
+        return shards_[Hash{}(key) % shards_.size()];
+    }
+
+    std::vector<Shard> shards_;
+    std::size_t capacity_{0};
+    std::atomic<std::uint64_t> hits_{0};
+    std::atomic<std::uint64_t> misses_{0};
+    std::atomic<std::uint64_t> evictions_{0};
+};
+
+}
@@ -0,0 +1,474 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "util/SpinLock.hpp"
+
+namespace skv::ondisk {
+
+/**
+ * @brief Map of index records for dense keys (keys are issued by counter). Records are stored in array indexed by key,
+ * array is split into chunks of "ChunkSize" records allocated on demand. Free slot holds record with tombstone key.
+ * Lookup is single indexed load, slot costs sizeof(Value) only, no node or bucket overhead.
+ * Memory is proportional to largest key, so sparse keys should use hash map instead.
+ *
+ * One writer at a time: lookup() may be called concurrently with writer without any lock. Slots are guarded by
+ * version counters (seqlock, one counter per stripe of slots), so reader retries if slot was changed while it was
+ * being copied. Chunks and chunk directories are never released while map is alive, readers may still use them.
+ * All other members are for writer only.
+ * Iteration is in order of keys. Value should be trivially copyable, constructible from {key, {}, {}} and provide key()
+ */
+template <typename Key,
+          typename Value,
+          std::size_t ChunkSize = 4096>
+class DenseIndexMap final {
+    static constexpr std::size_t WORDS = (sizeof(Value) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+    static constexpr std::size_t STRIPE = 8; // slots sharing version counter
+
+    static_assert(std::is_integral_v<Key> && std::is_unsigned_v<Key>, "Key type should be unsigned integral type");
+    static_assert(std::is_trivially_copyable_v<Value>, "Value type should be trivially copyable");
+    static_assert(ChunkSize > 0 && ChunkSize % STRIPE == 0, "Chunk size should be multiple of 8");
+
+    class Iterator;
+
+public:
+    using key_type          = Key;
+    using mapped_type       = Value;
+    using size_type         = std::size_t;
+    using iterator          = Iterator;
+    using const_iterator    = Iterator;
+
+    static constexpr key_type TOMBSTONE = std::numeric_limits<key_type>::max();
+
+    DenseIndexMap() noexcept = default;
+    ~DenseIndexMap() noexcept = default;
+
+    DenseIndexMap(const DenseIndexMap& other) {
+        for (auto it = other.begin(); it != other.end(); ++it)
+            try_emplace(it->first, it->second);
+    }
+
+    DenseIndexMap& operator=(const DenseIndexMap& other) {
+        if (this != &other) {
+            DenseIndexMap copy{other};
+
+            swap(copy);
+        }
+
+        return *this;
+    }
+
+    DenseIndexMap(DenseIndexMap&& other) noexcept {
+        swap(other);
+    }
+
+    DenseIndexMap& operator=(DenseIndexMap&& other) noexcept {
+        DenseIndexMap tmp{std::move(other)};
+
+        swap(tmp);
+
+        return *this;
+    }
+
+    void swap(DenseIndexMap& other) noexcept {
+        using std::swap;
+
+        swap(chunks_, other.chunks_);
+        swap(directories_, other.directories_);
+        swap(size_, other.size_);
+
+        auto directory = directory_.load(std::memory_order_relaxed);
+
+        directory_.store(other.directory_.load(std::memory_order_relaxed), std::memory_order_release);
+        other.directory_.store(directory, std::memory_order_release);
+    }
+
+    iterator begin() const noexcept { return iterator{this, next(0)}; }
+
+    iterator end() const noexcept { return iterator{this, capacity()}; }
+
+    [[nodiscard]] iterator find(key_type k) const noexcept {
+        return occupied(k)? iterator{this, k} : end();
+    }
+
+    [[nodiscard]] size_type count(key_type k) const noexcept {
+        return occupied(k)? 1 : 0;
+    }
+
+    /**
+     * @brief Copies record of key "k", may be called concurrently with writer
+     * @return false if there is no such key
+     */
+    [[nodiscard]] bool lookup(key_type k, Value& v) const noexcept {
+        const auto* directory = directory_.load(std::memory_order_acquire);
+        const auto c = chunkOf(k);
+
+        if (!directory || c >= directory->capacity)
+            return false;
+
+        const auto* chunk = directory->chunks[c].load(std::memory_order_acquire);
+
+        if (!chunk)
+            return false;
+
+        const auto i = k % ChunkSize;
+        const auto& version = chunk->versions[i / STRIPE];
+        std::uint64_t words[WORDS];
+        std::size_t step = 0;
+
+        for (;;) {
+            const auto before = version.load(std::memory_order_acquire);
+
+            if (before & 1) { // slot is being written, writer may be preempted
+                util::PauseBackoff<>::backoff(++step);
+
+                continue;
+            }
+
+            for (std::size_t w = 0; w < WORDS; ++w)
+                words[w] = chunk->words[i * WORDS + w].load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (version.load(std::memory_order_relaxed) == before)
+                break;
+        }
+
+        const auto found = decode(words);
+
+        if (found.key() != k)
+            return false;
+
+        v = found;
+
+        return true;
+    }
+
+    /**
+     * @brief Inserts "v" unless key "k" is present already
+     * @return iterator to record of key "k" and true if "v" was inserted
+     */
+    std::pair<iterator, bool> try_emplace(key_type k, const Value& v) {
+        if (occupied(k))
+            return {iterator{this, k}, false};
+
+        if (k == TOMBSTONE)
+            throw std::length_error("Key is reserved");
+
+        auto* chunk = allocate(chunkOf(k));
+
+        write(chunk, k % ChunkSize, v);
+
+        ++size_;
+
+        return {iterator{this, k}, true};
+    }
+
+    /**
+     * @brief Overwrites record "it" points to
+     */
+    void assign(iterator it, const Value& v) noexcept {
+        write(chunkAt(it.key_), it.key_ % ChunkSize, v);
+    }
+
+    /**
+     * @brief Frees slot. Chunk is kept even if it has no records left
+     * @return iterator following erased one
+     */
+    iterator erase(iterator it) noexcept {
+        const auto k = it.key_;
+
+        write(chunkAt(k), k % ChunkSize, Value{TOMBSTONE, {}, {}});
+
+        --size_;
+
+        return iterator{this, next(k + 1)};
+    }
+
+    size_type erase(key_type k) noexcept {
+        if (!occupied(k))
+            return 0;
+
+        erase(iterator{this, k});
+
+        return 1;
+    }
+
+    /**
+     * @brief Releases all chunks, shouldn't be called concurrently with readers
+     */
+    void clear() noexcept {
+        DenseIndexMap tmp;
+
+        swap(tmp);
+    }
+
+    [[nodiscard]] size_type size() const noexcept {
+        return size_;
+    }
+
+    [[nodiscard]] bool empty() const noexcept {
+        return size_ == 0;
+    }
+
+    /**
+     * @brief Bytes allocated for records and chunk directories. Doesn't shrink as records are erased, only clear()
+     * releases memory
+     */
+    [[nodiscard]] std::size_t memoryUsage() const noexcept {
+        std::size_t bytes = chunks_.size() * sizeof(Chunk);
+
+        for (const auto& directory : directories_)
+            bytes += directory->capacity * sizeof(std::atomic<Chunk*>);
+
+        return bytes;
+    }
+
+    [[nodiscard]] bool operator==(const DenseIndexMap& other) const noexcept {
+        if (size_ != other.size_)
+            return false;
+
+        for (auto it = begin(), oit = other.begin(); it != end(); ++it, ++oit) {
+            if (it.key_ != oit.key_ || it->second != oit->second)
+                return false;
+        }
+
+        return true;
+    }
+
+    [[nodiscard]] bool operator!=(const DenseIndexMap& other) const noexcept {
+        return !(*this == other);
+    }
+
+private:
+    struct Chunk {
+        Chunk() noexcept {
+            std::uint64_t empty[WORDS];
+
+            encode(Value{TOMBSTONE, {}, {}}, empty);
+
+            for (std::size_t i = 0; i < ChunkSize; ++i) {
+                for (std::size_t w = 0; w < WORDS; ++w)
+                    words[i * WORDS + w].store(empty[w], std::memory_order_relaxed);
+            }
+
+            for (auto& version : versions)
+                version.store(0, std::memory_order_relaxed);
+        }
+
+        std::atomic<std::uint64_t> words[ChunkSize * WORDS];
+        std::atomic<std::uint32_t> versions[ChunkSize / STRIPE]; // odd while slot of stripe is written
+    };
+
+    /* Chunk pointers by chunk index, replaced by larger copy when map grows */
+    struct Directory {
+        explicit Directory(std::size_t n):
+            capacity{n},
+            chunks{std::make_unique<std::atomic<Chunk*>[]>(n)}
+        {
+            for (std::size_t c = 0; c < n; ++c)
+                chunks[c].store(nullptr, std::memory_order_relaxed);
+        }
+
+        const std::size_t capacity;
+        std::unique_ptr<std::atomic<Chunk*>[]> chunks;
+    };
+
+    /* Dereferenced iterator: key and copy of record, as std::pair of std::unordered_map */
+    struct Reference {
+        const key_type first;
+        const Value second;
+    };
+
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = std::pair<const key_type, Value>;
+        using difference_type   = std::ptrdiff_t;
+        using reference         = Reference;
+
+        struct pointer {
+            reference ref;
+
+            const reference* operator->() const noexcept { return &ref; }
+        };
+
+        Iterator() noexcept = default;
+
+        reference operator*() const noexcept {
+            return {key_, map_->read(key_)};
+        }
+
+        pointer operator->() const noexcept {
+            return {**this};
+        }
+
+        Iterator& operator++() noexcept {
+            key_ = map_->next(key_ + 1);
+
+            return *this;
+        }
+
+        Iterator operator++(int) noexcept {
+            auto tmp = *this;
+
+            ++(*this);
+
+            return tmp;
+        }
+
+        [[nodiscard]] bool operator==(const Iterator& other) const noexcept {
+            return map_ == other.map_ && key_ == other.key_;
+        }
+
+        [[nodiscard]] bool operator!=(const Iterator& other) const noexcept {
+            return !(*this == other);
+        }
+
+    private:
+        friend class DenseIndexMap;
+
+        Iterator(const DenseIndexMap* map, key_type key) noexcept:
+            map_{map},
+            key_{key}
+        {}
+
+        const DenseIndexMap* map_{nullptr};
+        key_type key_{0};
+    };
+
+    static constexpr std::size_t chunkOf(key_type k) noexcept {
+        return std::size_t(k / ChunkSize);
+    }
+
+    static void encode(const Value& v, std::uint64_t (&words)[WORDS]) noexcept {
+        std::memset(words, 0, sizeof(words));
+        std::memcpy(words, &v, sizeof(Value));
+    }
+
+    static Value decode(const std::uint64_t (&words)[WORDS]) noexcept {
+        Value v;
+
+        std::memcpy(&v, words, sizeof(Value));
+
+        return v;
+    }
+
+    Chunk* chunkAt(key_type k) const noexcept {
+        const auto* directory = directory_.load(std::memory_order_relaxed);
+        const auto c = chunkOf(k);
+
+        if (!directory || c >= directory->capacity)
+            return nullptr;
+
+        return directory->chunks[c].load(std::memory_order_relaxed);
+    }
+
+    /* Chunk of index "c", directory is grown and chunk is allocated if needed */
+    Chunk* allocate(std::size_t c) {
+        auto* directory = directory_.load(std::memory_order_relaxed);
+
+        if (!directory || c >= directory->capacity) {
+            const auto capacity = std::max<std::size_t>({c + 1, directory? directory->capacity * 2 : 0, 16});
+            auto grown = std::make_unique<Directory>(capacity);
+
+            for (std::size_t i = 0; directory && i < directory->capacity; ++i)
+                grown->chunks[i].store(directory->chunks[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+            directories_.reserve(directories_.size() + 1);
+
+            directory = grown.get();
+            directories_.push_back(std::move(grown)); // previous directory is kept for readers still using it
+            directory_.store(directory, std::memory_order_release);
+        }
+
+        if (auto* chunk = directory->chunks[c].load(std::memory_order_relaxed))
+            return chunk;
+
+        chunks_.reserve(chunks_.size() + 1);
+        chunks_.push_back(std::make_unique<Chunk>());
+
+        auto* chunk = chunks_.back().get();
+
+        directory->chunks[c].store(chunk, std::memory_order_release);
+
+        return chunk;
+    }
+
+    /* Seqlock write, writer is single */
+    static void write(Chunk* chunk, std::size_t i, const Value& v) noexcept {
+        auto& version = chunk->versions[i / STRIPE];
+        const auto current = version.load(std::memory_order_relaxed);
+        std::uint64_t words[WORDS];
+
+        encode(v, words);
+
+        version.store(current + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (std::size_t w = 0; w < WORDS; ++w)
+            chunk->words[i * WORDS + w].store(words[w], std::memory_order_relaxed);
+
+        version.store(current + 2, std::memory_order_release);
+    }
+
+    /* Writer side read, slots don't change under writer */
+    Value read(key_type k) const noexcept {
+        const auto* chunk = chunkAt(k);
+        const auto i = k % ChunkSize;
+        std::uint64_t words[WORDS];
+
+        for (std::size_t w = 0; w < WORDS; ++w)
+            words[w] = chunk->words[i * WORDS + w].load(std::memory_order_relaxed);
+
+        return decode(words);
+    }
+
+    bool occupied(key_type k) const noexcept {
+        return chunkAt(k) && read(k).key() == k;
+    }
+
+    key_type capacity() const noexcept {
+        const auto* directory = directory_.load(std::memory_order_relaxed);
+
+        return directory? key_type(directory->capacity * ChunkSize) : 0;
+    }
+
+    /* First occupied slot starting at "k", capacity() if there is none */
+    key_type next(key_type k) const noexcept {
+        const auto last = capacity();
+
+        while (k < last) {
+            if (!chunkAt(k)) {
+                k = key_type((chunkOf(k) + 1) * ChunkSize);
+
+                continue;
+            }
+
+            if (read(k).key() == k)
+                return k;
+
+            ++k;
+        }
+
+        return last;
+    }
+
+    std::vector<std::unique_ptr<Chunk>> chunks_;
+    std::vector<std::unique_ptr<Directory>> directories_; // last one is current
+    std::atomic<Directory*> directory_{nullptr};
+    size_type size_{0};
+};
+
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+namespace skv::ondisk {
+
+/**
+ * @brief Durability guarantee of log device appends
+ */
+enum class Durability: std::uint8_t {
+    None,           // data handed over to OS on append, never synced explicitly (not even on close)
+    Flush,          // data handed over to OS on append, synced on close. Default
+    Fsync,          // every append (or append group) synced before append returns
+    FsyncEveryN,    // synced after every N appended records
+    FsyncEveryMs    // synced on append if more than N milliseconds passed since last sync
+};
+
+}
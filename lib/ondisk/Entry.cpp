@@ -4,7 +4,7 @@
 namespace skv::ondisk {
 
 Entry::Entry(Record &&record) noexcept:
-    record_{record}
+    record_{std::move(record)}
 {
 
 }
@@ -19,6 +19,8 @@ public:
     using key_type          = std::decay_t<Key>;
     using block_index_type  = std::decay_t<BlockIndex>;
     using bytes_count_type  = std::decay_t<BytesCount>;
+    using block_offset_type = std::uint32_t;                /* offset of record within its first block (packed records) */
+    using segment_index_type = std::uint32_t;               /* log device segment containing record */
 
     static_assert (std::is_integral_v<key_type> && sizeof(key_type) >= sizeof(std::uint16_t), "Key type should be integral type (16 bit width minimum)");
     static_assert (std::is_integral_v<block_index_type > && sizeof(block_index_type) >= sizeof(std::uint16_t), "BlockIndex type should be integral type (16 bit width minimum)");
@@ -26,8 +28,8 @@ public:
 
     constexpr IndexRecord() noexcept = default;
 
-    constexpr IndexRecord(key_type k, block_index_type  bi, bytes_count_type bc) noexcept:
-        key_{k}, blockIndex_{bi}, bytesCount_{bc}
+    constexpr IndexRecord(key_type k, block_index_type  bi, bytes_count_type bc, block_offset_type bo = 0, segment_index_type si = 0) noexcept:
+        key_{k}, blockIndex_{bi}, bytesCount_{bc}, blockOffset_{bo}, segment_{si}
     {}
 
     ~IndexRecord() noexcept = default;
@@ -44,10 +46,16 @@ public:
 
     constexpr bytes_count_type bytesCount() const noexcept { return bytesCount_; }
 
+    constexpr block_offset_type blockOffset() const noexcept { return blockOffset_; }
+
+    constexpr segment_index_type segment() const noexcept { return segment_; }
+
     [[nodiscard]] bool operator==(const IndexRecord& other) const noexcept {
         return key_ == other.key_ &&
                blockIndex_ == other.blockIndex_ &&
-               bytesCount_ == other.bytesCount_;
+               bytesCount_ == other.bytesCount_ &&
+               blockOffset_ == other.blockOffset_ &&
+               segment_ == other.segment_;
     }
 
     [[nodiscard]] bool operator!=(const IndexRecord& other) const noexcept {
@@ -62,16 +70,44 @@ private:
     key_type key_{};
     block_index_type  blockIndex_{};
     bytes_count_type bytesCount_{};
+    block_offset_type blockOffset_{};
+    segment_index_type segment_{};
 };
 
+template <typename Writer, typename K, typename BI, typename BC>
+inline void serializeIndexRecord(Writer& s, const IndexRecord<K, BI, BC>& p)
+{
+    s << p.key()
+      << p.blockIndex()
+      << p.bytesCount()
+      << p.blockOffset()
+      << p.segment();
+}
+
+template <typename Reader, typename K, typename BI, typename BC>
+inline void deserializeIndexRecord(Reader& ds, IndexRecord<K, BI, BC>& p)
+{
+    decltype(p.key()) k;
+    decltype(p.blockIndex()) bi;
+    decltype(p.bytesCount()) bc;
+    decltype(p.blockOffset()) bo;
+    decltype(p.segment()) si;
+
+    ds >> k
+       >> bi
+       >> bc
+       >> bo
+       >> si;
+
+    p = IndexRecord<K, BI, BC>{k, bi, bc, bo, si};
+}
+
 template <typename K, typename BI, typename BC>
 inline std::ostream& operator<<(std::ostream& _os, const IndexRecord<K, BI, BC>& p)
 {
     util::Serializer s{_os};
 
-    s << p.key()
-      << p.blockIndex()
-      << p.bytesCount();
+    serializeIndexRecord(s, p);
 
     return _os;
 }
@@ -81,17 +117,25 @@ inline std::istream& operator>>(std::istream& _is, IndexRecord<K, BI, BC>& p)
 {
     util::Deserializer ds{_is};
 
-    decltype(p.key()) k;
-    decltype(p.blockIndex()) bi;
-    decltype(p.bytesCount()) bc;
+    deserializeIndexRecord(ds, p);
 
-    ds >> k
-       >> bi
-       >> bc;
+    return _is;
+}
 
-    p = IndexRecord<K, BI, BC>{k, bi, bc};
+template <typename K, typename BI, typename BC>
+inline util::BufferWriter& operator<<(util::BufferWriter& w, const IndexRecord<K, BI, BC>& p)
+{
+    serializeIndexRecord(w, p);
 
-    return _is;
+    return w;
+}
+
+template <typename K, typename BI, typename BC>
+inline util::BufferReader& operator>>(util::BufferReader& r, IndexRecord<K, BI, BC>& p)
+{
+    deserializeIndexRecord(r, p);
+
+    return r;
 }
 
 }
@@ -6,45 +6,81 @@
 #include <iostream>
 #include <type_traits>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 
+#include "DenseIndexMap.hpp"
 #include "IndexRecord.hpp"
 #include "util/Serialization.hpp"
 #include "util/Unused.hpp"
 
 namespace skv::ondisk {
 
+/**
+ * @brief Index records are kept in hash map: any keys, ~3x memory of dense layout
+ */
+struct HashIndexLayout {
+    static constexpr bool ConcurrentReads = false;
+
+    template <typename Key, typename Record>
+    using table_type = std::unordered_map<Key, Record>;
+};
+
+/**
+ * @brief Index records are kept in array indexed by key, see DenseIndexMap. Suits keys issued by counter.
+ * Records may be looked up without lock while table is modified
+ */
+template <std::size_t ChunkSize = 4096>
+struct DenseIndexLayout {
+    static constexpr bool ConcurrentReads = true;
+
+    template <typename Key, typename Record>
+    using table_type = DenseIndexMap<Key, Record, ChunkSize>;
+};
+
 template <typename Key,
           typename BlockIndex,
-          typename BytesCount>
+          typename BytesCount,
+          typename Layout>
 class IndexTable;
 
-template <typename Key,
+template <typename Writer,
+          typename Key,
           typename BlockIndex,
-          typename BytesCount>
-std::ostream& operator<<(std::ostream& _os, const IndexTable<Key, BlockIndex, BytesCount>& p);
+          typename BytesCount,
+          typename Layout>
+void serializeIndexTable(Writer& s, const IndexTable<Key, BlockIndex, BytesCount, Layout>& p);
 
-template <typename Key,
+template <typename Reader,
+          typename Key,
           typename BlockIndex,
-          typename BytesCount>
-std::istream& operator>>(std::istream& _is, IndexTable<Key, BlockIndex, BytesCount>& p);
+          typename BytesCount,
+          typename Layout>
+void deserializeIndexTable(Reader& ds, IndexTable<Key, BlockIndex, BytesCount, Layout>& p);
 
 /**
  * @brief Index table
  */
 template <typename Key          = std::uint64_t,
           typename BlockIndex   = std::uint32_t,
-          typename BytesCount   = std::uint32_t> // in one record(!!!)
+          typename BytesCount   = std::uint32_t, // in one record(!!!)
+          typename Layout       = HashIndexLayout>
 class IndexTable final {
 public:
     using key_type          = std::decay_t<Key>;
     using block_index_type  = std::decay_t<BlockIndex>;
     using bytes_count_type  = std::decay_t<BytesCount>;
     using index_record_type = IndexRecord<key_type, block_index_type, bytes_count_type>;
-    using table_type        = std::unordered_map<key_type, index_record_type>;
+    using segment_index_type = typename index_record_type::segment_index_type;
+    using table_type        = typename Layout::template table_type<key_type, index_record_type>;
+    using footprint_table_type = std::unordered_map<segment_index_type, std::uint64_t>;
+    using changes_type      = std::unordered_set<key_type>;
 
     using iterator          = typename table_type::iterator;
     using const_iterator    = typename table_type::const_iterator;
 
+    static constexpr bool ConcurrentReads = Layout::ConcurrentReads; // lookup() is safe while table is modified
+
 
     static_assert (std::is_integral_v<key_type> && sizeof(key_type) >= sizeof(std::uint16_t), "Key type should be integral type (16 bit width minimum)");
     static_assert (std::is_integral_v<block_index_type > && sizeof(block_index_type) >= sizeof(std::uint16_t), "BlockIndex type should be integral type (16 bit width minimum)");
@@ -83,23 +119,85 @@ public:
         return table_.find(k);
     }
 
+    /**
+     * @brief Copies record of key "k". If ConcurrentReads is set, may be called without lock concurrently with
+     * (single) writer, otherwise table shouldn't be modified meanwhile
+     * @return false if there is no such key
+     */
+    [[nodiscard]] bool lookup(const key_type& k, index_record_type& idx) const noexcept {
+        if constexpr (ConcurrentReads)
+            return table_.lookup(k, idx);
+        else {
+            const auto it = table_.find(k);
+
+            if (it == table_.end())
+                return false;
+
+            idx = it->second;
+
+            return true;
+        }
+    }
+
     [[nodiscard]] bool empty() const {
         return begin() == end();
     }
 
     bool insert(const index_record_type& idx) {
-        table_[idx.key()] = idx;
+        auto [it, inserted] = table_.try_emplace(idx.key(), idx);
+
+        if (!inserted)
+            replace(it, idx);
+        else {
+            account(idx, 1);
+            track(idx.key());
+        }
 
         return true;
     }
 
+    /**
+     * @brief Overwrites record "it" points to. Records should be changed only this way, so footprints stay exact
+     */
+    void replace(iterator it, const index_record_type& idx) {
+        assert(it->first == idx.key());
+
+        account(it->second, -1);
+
+        if constexpr (ConcurrentReads)
+            table_.assign(it, idx); // concurrent readers see either old or new record
+        else
+            it->second = idx;
+
+        account(idx, 1);
+        track(idx.key());
+    }
+
+    /**
+     * @brief Replaces all records by "count" records at "records" (e.g. mapped from index table file). Hash table is
+     * sized once, so records are inserted without rehashing
+     */
+    void load(const index_record_type* records, std::size_t count) {
+        table_.clear();
+        recount();
+
+        if constexpr (!ConcurrentReads)
+            table_.reserve(count);
+
+        for (std::size_t i = 0; i < count; ++i)
+            insert(records[i]);
+    }
+
     iterator erase(iterator it) {
+        account(it->second, -1);
+        track(it->first);
+
         return table_.erase(it);
     }
 
     iterator erase(const key_type& k) {
         if (auto it = find(k); it != end())
-            return table_.erase(it);
+            return erase(it);
 
         return end();
     }
@@ -109,7 +207,7 @@ public:
     }
 
     /**
-     * @brief Size of all records on disk (in bytes). Updates only on loading index table from disk. Used for calulation of compaction rate.
+     * @brief Size of all records on disk (in bytes). Updated on every insert, replace and erase. Used for calulation of compaction rate.
      * @return
      */
     std::uint64_t diskFootprint() const noexcept {
@@ -117,13 +215,35 @@ public:
     }
 
     /**
-     * @brief Size of all records on disk (in blocks). Updates only on loading index table from disk. Used for calulation of compaction rate.
+     * @brief Size of all records on disk (in blocks). Updated on every insert, replace and erase. Used for calulation of compaction rate.
+     * Packed records share blocks, so their footprint is count of blocks they would occupy after compaction
      * @return
      */
     std::uint64_t blockFootprint() const noexcept {
+        if (packed_ && blockSize_ > 0)
+            return (diskFootprint_ / blockSize_) + (diskFootprint_ % blockSize_? 1 : 0);
+
         return blockFootprint_;
     }
 
+    /**
+     * @brief Bytes of log segment occupied by live records: records are padded to block size unless packed
+     * @return
+     */
+    std::uint64_t segmentFootprint(segment_index_type segment) const noexcept {
+        const auto it = segmentFootprints_.find(segment);
+
+        return (it == std::end(segmentFootprints_))? 0 : it->second;
+    }
+
+    /**
+     * @brief Live bytes of all segments referred by index table, see segmentFootprint()
+     * @return
+     */
+    const footprint_table_type& segmentFootprints() const noexcept {
+        return segmentFootprints_;
+    }
+
     /**
      * @brief Size of disk block
      * @return
@@ -136,77 +256,238 @@ public:
      * @brief Sets block size
      * @return
      */
-    void setBlockSize(std::uint32_t bs) noexcept {
+    void setBlockSize(std::uint32_t bs) {
         blockSize_ = bs;
+
+        recount();
+    }
+
+    /**
+     * @brief Records are packed into shared blocks (not padded to block size)
+     * @return
+     */
+    bool packed() const noexcept {
+        return packed_;
+    }
+
+    /**
+     * @brief Sets records packing, affects block footprint
+     * @return
+     */
+    void setPacked(bool packed) {
+        packed_ = packed;
+
+        recount();
+    }
+
+    /**
+     * @brief Starts (or stops) tracking of keys inserted, replaced and erased. Tracked keys are cleared
+     */
+    void trackChanges(bool track) {
+        tracked_ = track;
+        changes_.clear();
+    }
+
+    /**
+     * @brief Keys changed since changes were taken last time (or tracking was started)
+     * @return
+     */
+    [[nodiscard]] changes_type takeChanges() {
+        return std::exchange(changes_, changes_type{});
+    }
+
+    /**
+     * @brief Returns changes taken but not persisted, so they are taken again next time
+     */
+    void restoreChanges(const changes_type& keys) {
+        if (tracked_)
+            changes_.insert(std::begin(keys), std::end(keys));
+    }
+
+    /**
+     * @brief Count of keys changed since changes were taken last time
+     * @return
+     */
+    std::size_t changesCount() const noexcept {
+        return changes_.size();
     }
 
     [[nodiscard]] bool operator==(const IndexTable& other) const noexcept {
-        // disk & block footprint ignored when comparing index tables
+        // disk & block footprint and changes ignored when comparing index tables
 
         return table_ == other.table_ &&
                blockSize_ == other.blockSize_;
     }
 
 private:
-    friend std::istream& operator>> <Key, BlockIndex, BytesCount>(std::istream& is, IndexTable& p);
-    friend std::istream& operator>> <Key, BlockIndex, BytesCount>(std::istream& is, IndexTable& p);
+    template <typename Writer, typename K, typename BI, typename BC, typename L>
+    friend void serializeIndexTable(Writer& s, const IndexTable<K, BI, BC, L>& p);
+
+    template <typename Reader, typename K, typename BI, typename BC, typename L>
+    friend void deserializeIndexTable(Reader& ds, IndexTable<K, BI, BC, L>& p);
+
+    static constexpr std::int64_t FORMAT_VERSION = 3; // written negated in place of records count, version 1 has no version mark
+
+    std::uint64_t blocksOf(const index_record_type& idx) const noexcept {
+        return (blockSize_ > 0)? (std::uint64_t(idx.bytesCount()) + blockSize_ - 1) / blockSize_ : 0;
+    }
+
+    /* Adds (sign > 0) or subtracts footprint of record */
+    void account(const index_record_type& idx, int sign) {
+        const auto bytes = std::uint64_t(idx.bytesCount());
+        const auto blocks = blocksOf(idx);
+        const auto segmentBytes = (packed_ || blockSize_ == 0)? bytes : blocks * blockSize_;
+
+        if (sign > 0) {
+            diskFootprint_ += bytes;
+            blockFootprint_ += blocks;
+            segmentFootprints_[idx.segment()] += segmentBytes;
+
+            return;
+        }
+
+        diskFootprint_ -= bytes;
+        blockFootprint_ -= blocks;
+
+        if (auto it = segmentFootprints_.find(idx.segment()); it != std::end(segmentFootprints_)) {
+            it->second -= segmentBytes;
+
+            if (it->second == 0)
+                segmentFootprints_.erase(it);
+        }
+    }
+
+    void track(const key_type& k) {
+        if (tracked_)
+            changes_.insert(k);
+    }
+
+    void recount() {
+        diskFootprint_ = 0;
+        blockFootprint_ = 0;
+        segmentFootprints_.clear();
+
+        for (const auto& p : table_)
+            account(p.second, 1);
+    }
 
     table_type table_;
     std::uint32_t blockSize_{0};
+    bool packed_{false};
     std::uint64_t diskFootprint_{0};
     std::uint64_t blockFootprint_{0};
+    footprint_table_type segmentFootprints_; // segment -> live bytes
+    bool tracked_{false};
+    changes_type changes_; // keys changed since last takeChanges()
 };
 
-template <typename Key,
+template <typename Writer,
+          typename Key,
           typename BlockIndex,
-          typename BytesCount>
-inline std::ostream& operator<<(std::ostream& _os, const IndexTable<Key, BlockIndex, BytesCount>& p)
+          typename BytesCount,
+          typename Layout>
+inline void serializeIndexTable(Writer& s, const IndexTable<Key, BlockIndex, BytesCount, Layout>& p)
 {
-    util::Serializer s{_os};
+    using table_type = IndexTable<Key, BlockIndex, BytesCount, Layout>;
 
     std::int64_t d = std::distance(std::cbegin(p), std::cend(p));
     assert(d >= 0);
 
-    s << d;
+    s << -table_type::FORMAT_VERSION
+      << d;
 
     std::for_each(std::cbegin(p), std::cend(p),
                   [&s](auto&& p) { s << p.second; });
-
-    return _os;
 }
 
-template <typename Key,
+template <typename Reader,
+          typename Key,
           typename BlockIndex,
-          typename BytesCount>
-inline std::istream& operator>>(std::istream& _is, IndexTable<Key, BlockIndex, BytesCount>& p)
+          typename BytesCount,
+          typename Layout>
+inline void deserializeIndexTable(Reader& ds, IndexTable<Key, BlockIndex, BytesCount, Layout>& p)
 {
-    util::Deserializer ds{_is};
-
-    using index_type = typename IndexTable<Key, BlockIndex, BytesCount>::index_record_type;
+    using index_type = typename IndexTable<Key, BlockIndex, BytesCount, Layout>::index_record_type;
 
     std::int64_t d;
     ds >> d;
 
-    for (decltype(d) i = 0; i < d; ++i) {
-        index_type idx;
+    // version 1: records count followed by records without block offset
+    // version 2: version mark, records count, records without segment
+    const auto version = (d >= 0)? std::int64_t{1} : -d;
 
-        ds >> idx;
+    if (version > 1)
+        ds >> d;
 
-        p.insert(idx);
+    for (decltype(d) i = 0; i < d && ds.good(); ++i) {
+        index_type idx;
 
-        p.diskFootprint_ += idx.bytesCount();
+        if (version < IndexTable<Key, BlockIndex, BytesCount, Layout>::FORMAT_VERSION) {
+            typename index_type::key_type k;
+            typename index_type::block_index_type bi;
+            typename index_type::bytes_count_type bc;
+            typename index_type::block_offset_type bo{0};
 
-        if (p.blockSize() > 0) {
-            auto blockCount = idx.bytesCount() / p.blockSize();
+            ds >> k >> bi >> bc;
 
-            if (idx.bytesCount() % p.blockSize() != 0)
-                ++blockCount;
+            if (version > 1)
+                ds >> bo;
 
-            p.blockFootprint_ += blockCount;
+            idx = index_type{k, bi, bc, bo};
         }
+        else
+            ds >> idx;
+
+        p.insert(idx);
     }
+}
+
+template <typename Key,
+          typename BlockIndex,
+          typename BytesCount,
+          typename Layout>
+inline std::ostream& operator<<(std::ostream& _os, const IndexTable<Key, BlockIndex, BytesCount, Layout>& p)
+{
+    util::Serializer s{_os};
+
+    serializeIndexTable(s, p);
+
+    return _os;
+}
+
+template <typename Key,
+          typename BlockIndex,
+          typename BytesCount,
+          typename Layout>
+inline std::istream& operator>>(std::istream& _is, IndexTable<Key, BlockIndex, BytesCount, Layout>& p)
+{
+    util::Deserializer ds{_is};
+
+    deserializeIndexTable(ds, p);
 
     return _is;
 }
 
+template <typename Key,
+          typename BlockIndex,
+          typename BytesCount,
+          typename Layout>
+inline util::BufferWriter& operator<<(util::BufferWriter& w, const IndexTable<Key, BlockIndex, BytesCount, Layout>& p)
+{
+    serializeIndexTable(w, p);
+
+    return w;
+}
+
+template <typename Key,
+          typename BlockIndex,
+          typename BytesCount,
+          typename Layout>
+inline util::BufferReader& operator>>(util::BufferReader& r, IndexTable<Key, BlockIndex, BytesCount, Layout>& p)
+{
+    deserializeIndexTable(r, p);
+
+    return r;
+}
+
 }
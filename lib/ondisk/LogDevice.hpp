@@ -1,14 +1,26 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <cstring>
+#include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <new>
+#include <set>
 #include <shared_mutex>
-#include <thread>
+#include <string_view>
 #include <tuple>
 #include <vector>
 
+#include "BlockCache.hpp"
+#include "Durability.hpp"
+#include "os/AsyncIO.hpp"
 #include "os/File.hpp"
 #include "util/Status.hpp"
 #include "util/Unused.hpp"
@@ -25,25 +37,99 @@ template <typename BlockIndex = std::uint32_t,
           typename Buffer     = std::vector<char>>
 class LogDevice final
 {
-    static constexpr std::size_t   MAX_READ_THREADS = 17;
     static constexpr std::uint32_t DEFAULT_BLOCK_SIZE = 2048;
     static constexpr std::uint32_t MIN_BLOCK_SIZE = 2048;
+    static constexpr std::uint32_t DEFAULT_SYNC_EVERY_N = 64;
+    static constexpr std::uint32_t DEFAULT_SYNC_EVERY_MS = 100;
+    static constexpr std::uint32_t DEFAULT_IO_QUEUE_DEPTH = 32;
+    static constexpr std::uint64_t DEFAULT_MAPPING_CHUNK_SIZE = 64 * 1024 * 1024;
+    static constexpr std::uint32_t DEFAULT_BLOCK_CACHE_SHARDS = 16;
+    static constexpr std::size_t GROUP_LEADER_ROUNDS = 4; // groups written by leader before it hands leadership over
+    static constexpr std::uint64_t END_OF_LOG_MAGIC_V1 = 0x31304C4F45564B53; // "SKVEOL01", end of log in blocks
+    static constexpr std::uint64_t END_OF_LOG_MAGIC = 0x32304C4F45564B53; // "SKVEOL02", end of log in bytes
+    static constexpr std::string_view END_OF_LOG_SUFFIX = ".eol";
 
 public:
     using buffer_type           = std::decay_t<Buffer>;                           /* maybe std::uint8_t is better choice */
     using buffer_value_type     = typename buffer_type::value_type; /* maybe std::uint8_t is better choice */
     using block_index_type      = std::decay_t<BlockIndex>;                       /* so we can address up to 16 TB */
     using block_count_type      = std::decay_t<BlockCount>;
+    using block_offset_type     = std::uint32_t;                                  /* offset of record within its first block */
     using bytes_count_type      = typename buffer_type::size_type;
 
     static_assert (std::is_unsigned_v<block_index_type>, "block_index_type should be unsigned");
     static_assert (std::is_unsigned_v<block_count_type>, "block_count_type should be unsigned");
     static_assert (std::is_unsigned_v<bytes_count_type>, "bytes_count_type should be unsigned");
 
+    using append_result_type    = std::tuple<Status, block_index_type, block_count_type, block_offset_type>;
+    using read_callback_type    = std::function<void(Status, buffer_type)>;
+    using IOEngine              = os::AsyncIO::Engine;
+
+    /* Block in cache, which may be shared by several devices */
+    struct CacheKey {
+        std::uint64_t device;
+        block_index_type block;
+
+        bool operator==(const CacheKey& other) const noexcept {
+            return device == other.device && block == other.block;
+        }
+    };
+
+    struct CacheKeyHash {
+        std::size_t operator()(const CacheKey& key) const noexcept {
+            return std::hash<std::uint64_t>{}((key.device * 0x9E3779B97F4A7C15ull) ^ std::uint64_t(key.block));
+        }
+    };
+
+    using block_cache_type      = BlockCache<CacheKey, std::shared_ptr<const buffer_type>, CacheKeyHash>;
+    using cache_stats_type      = typename block_cache_type::Stats;
+
     struct OpenOption {
         OpenOption() = default;
         std::uint32_t   BlockSize{DEFAULT_BLOCK_SIZE};
         bool            CreateNewIfNotExist{true};
+        bool            GroupCommit{false};                     // coalesce concurrent appends into one write
+        Durability      DurabilityMode{Durability::Flush};
+        std::uint32_t   SyncEveryN{DEFAULT_SYNC_EVERY_N};       // used by Durability::FsyncEveryN
+        std::uint32_t   SyncEveryMs{DEFAULT_SYNC_EVERY_MS};     // used by Durability::FsyncEveryMs
+        IOEngine        Engine{IOEngine::Blocking};             // engine serving readAsync()/appendAsync()
+        std::uint32_t   IOQueueDepth{DEFAULT_IO_QUEUE_DEPTH};   // max in-flight asynchronous operations
+        bool            MemoryMapped{false};                    // serve read()/view() from memory mapping of device file
+        std::uint64_t   MappingChunkSize{DEFAULT_MAPPING_CHUNK_SIZE}; // mapping grows by this value
+        bool            DirectIO{false};                        // bypass OS page cache, BlockSize should be multiple of os::File::DirectIOAlignment
+        std::uint64_t   BlockCacheSize{0};                      // bytes of user-space block cache (0 - disabled), not used with MemoryMapped
+        std::uint32_t   BlockCacheShards{DEFAULT_BLOCK_CACHE_SHARDS};
+        std::shared_ptr<block_cache_type> SharedBlockCache;     // cache shared with other devices, used instead of own one of BlockCacheSize
+        std::uint64_t   BlockCacheDeviceId{0};                  // tells blocks of this device from blocks of others in shared cache
+        std::uint64_t   PreallocationSize{0};                   // file space is reserved by chunks of this size (0 - disabled)
+        bool            PackRecords{false};                     // records aren't padded to block size, so they share blocks
+    };
+
+    /**
+     * @brief Read-only view of device data. Keeps memory it points to alive (even after device closed)
+     */
+    class View final {
+    public:
+        View() noexcept = default;
+
+        View(std::shared_ptr<const void> owner, const buffer_value_type* data, bytes_count_type size) noexcept:
+            owner_{std::move(owner)}, data_{data}, size_{size}
+        {}
+
+        const buffer_value_type* data() const noexcept { return data_; }
+
+        bytes_count_type size() const noexcept { return size_; }
+
+        bool empty() const noexcept { return size_ == 0; }
+
+        const buffer_value_type* begin() const noexcept { return data_; }
+
+        const buffer_value_type* end() const noexcept { return data_ + size_; }
+
+    private:
+        std::shared_ptr<const void> owner_;
+        const buffer_value_type* data_{nullptr};
+        bytes_count_type size_{0};
     };
 
     LogDevice() = default;
@@ -68,6 +154,12 @@ public:
         if (options.BlockSize % MIN_BLOCK_SIZE != 0)
             return Status::InvalidArgument("Invalid block size");
 
+        if (options.DirectIO && options.BlockSize % os::File::DirectIOAlignment != 0)
+            return Status::InvalidArgument("Invalid block size");
+
+        if (options.DirectIO && options.MemoryMapped)
+            return Status::InvalidArgument("Incompatible options");
+
         std::unique_lock lock(lock_);
 
         const auto exists = os::fs::exists(path);
@@ -77,15 +169,17 @@ public:
 
         path_ = path;
         openOption_ = options;
-        blocks_.store(0);
+        tail_.store(0);
         opened_ = false;
+        writeFailed_.store(false);
+        pendingWrites_.clear();
         writeHandle_.reset();
         fillbuffer.resize(options.BlockSize);
 
         if (!exists && !createNew())
             return Status::IOError("Unable to create block device");
 
-        auto file = os::File::open(path_, "rb+");
+        auto file = options.DirectIO? os::File::openDirect(path_, "rb+") : os::File::open(path_, "rb+");
         writeHandle_.swap(file);
 
         if (!writeHandle_)
@@ -95,10 +189,42 @@ public:
 
         SKV_UNUSED(os::File::seek(writeHandle_, 0, os::File::Seek::End));
 
-        blocks_.store(block_count_type(os::File::tell(writeHandle_) / blockSize()));
+        const auto fileSize = std::uint64_t(os::File::tell(writeHandle_));
+
+        tail_.store(fileSize);
+        allocated_ = fileSize;
+        tailExtended_ = false;
+
+        if (!initEndOfLog()) {
+            lock.unlock();
+
+            close();
+
+            return Status::IOError("Unable to open device");
+        }
+
+        unsyncedRecords_ = 0;
+        lastSync_ = std::chrono::steady_clock::now();
+
+        std::atomic_store(&cache_, std::shared_ptr<block_cache_type>{}); // readers still holding old cache keep it alive
+
+        if (options.SharedBlockCache && !options.MemoryMapped)
+            std::atomic_store(&cache_, options.SharedBlockCache);
+        else if (options.BlockCacheSize >= options.BlockSize && !options.MemoryMapped) {
+            try {
+                std::atomic_store(&cache_, std::make_shared<block_cache_type>(std::size_t(options.BlockCacheSize / options.BlockSize), options.BlockCacheShards));
+            }
+            catch (...) {
+                lock.unlock();
 
-        if (!initReaders()) {
-            lock_.unlock();
+                close();
+
+                return Status::Fatal("Out of memory");
+            }
+        }
+
+        if (!initReader() || !initTailBlock() || !asyncIO_.open(options.Engine, options.IOQueueDepth).isOk()) {
+            lock.unlock();
 
             close();
 
@@ -112,55 +238,70 @@ public:
      * @brief Close block device file
      */
     Status close() {
+        asyncIO_.close(); // waits for in-flight operations, their completions may need lock_
+
         std::unique_lock lock(lock_);
 
         if (!opened())
             return Status::Ok();
 
+        auto status = Status::Ok();
+
+        {
+            std::unique_lock slock(syncLock_);
+
+            if (openOption_.DurabilityMode != Durability::None)
+                status = doSync();
+            else if (!persistEndOfLog(false))
+                status = Status::IOError("Unable to save end of log");
+        }
+
         opened_ = false;
         writeHandle_.reset();
+        endOfLogHandle_.reset();
+        tailBlock_.reset();
 
-        for (std::size_t i = 0; i < MAX_READ_THREADS; ++i) {
-            std::unique_lock lock(readMutexes_[i]);
+        std::atomic_store(&readHandle_, os::File::Handle{});
+        std::atomic_store(&region_, std::shared_ptr<const MappedRegion>{});
 
-            readHandles_[i].reset();
-        }
+        if (auto cache = std::atomic_exchange(&cache_, std::shared_ptr<block_cache_type>{}); cache && !openOption_.SharedBlockCache)
+            cache->clear(); // concurrent readers may still use it, blocks are freed once they're done. Shared cache is cleared by owner
 
         path_.clear();
-        blocks_.store(0);
+        tail_.store(0);
 
         buffer_type tmp;
         fillbuffer.swap(tmp);
 
-        return Status::Ok();
+        return status;
     }
 
     /**
      * @brief Read "cnt" bytes starting from block index "n"
      * @param n - block index
      * @param cnt - bytes count
+     * @param offset - offset within block "n" (non-zero only for packed records)
      * @return {Status::Ok(), data} on success
      */
-    [[nodiscard]] std::tuple<Status, buffer_type> read(block_index_type n, bytes_count_type cnt) {
+    [[nodiscard]] std::tuple<Status, buffer_type> read(block_index_type n, bytes_count_type cnt, block_offset_type offset = 0) {
         if (cnt == 0)
             return {Status::InvalidArgument("Invalid count"), {}};
 
         buffer_type buffer;
-        auto status = read(n, buffer, cnt);
+        auto status = read(n, buffer, cnt, offset);
 
         return {status, status.isOk()? buffer : buffer_type{}};
     }
 
     /**
-     * @brief Read "cnt" bytes starting from block index "n"
+     * @brief Read "cnt" bytes starting from block index "n". Lock-free: all readers share one handle and use positional reads
      * @param n - block index
      * @param buffer - buffer for data. if buffer.size() < cnt buffer will be reallocated
      * @param cnt - bytes count
+     * @param offset - offset within block "n" (non-zero only for packed records)
      * @return {Status::Ok(), data} on success
      */
-    [[nodiscard]] Status read(block_index_type n, buffer_type& buffer, bytes_count_type cnt) {
-        static constexpr std::hash<std::thread::id> hasher;
-
+    [[nodiscard]] Status read(block_index_type n, buffer_type& buffer, bytes_count_type cnt, block_offset_type offset = 0) {
         if (cnt == 0)
             return Status::InvalidArgument("Empty buffer");
 
@@ -173,88 +314,306 @@ public:
             }
         }
 
-        auto totalBlocks = sizeInBlocks();
-        auto readBlocks = (cnt / blockSize()) + (cnt % blockSize()? 1 : 0);
-
         if (!opened())
             return Status::IOError("Device not opened");
-        if ((n + readBlocks) > totalBlocks)
-            return Status::InvalidArgument("Out of memory");
 
-        const auto readerId = hasher(std::this_thread::get_id()) % MAX_READ_THREADS;
+        if (auto status = checkRange(n, cnt, offset); !status.isOk())
+            return status;
+
+        const auto bytes = std::uint64_t(cnt) * sizeof(buffer_value_type);
+        const auto address = addressOf(n, offset);
+
+        if (openOption_.MemoryMapped) {
+            if (auto region = mappedRegion(address + bytes); region) {
+                std::memcpy(buffer.data(), region->data.get() + address, bytes);
+
+                return Status::Ok();
+            }
+        }
 
-        std::unique_lock lock(readMutexes_[readerId]);
+        if (auto cache = std::atomic_load(&cache_); cache) // keeps cache alive even if device is reopened concurrently
+            return readCached(*cache, address, buffer.data(), bytes);
 
-        auto& fhandle = readHandles_[readerId];
+        const auto fhandle = std::atomic_load(&readHandle_); // keeps handle alive even if device is closed concurrently
 
         if (!fhandle)
             return Status::IOError("Device not opened");
 
-        if (!os::File::seek(fhandle, std::int64_t(n) * std::int64_t(blockSize()), os::File::Seek::Set))
-            return Status::IOError("Unable to seek");
+        if (!openOption_.DirectIO) {
+            if (os::File::pread(fhandle, buffer.data(), bytes, std::int64_t(address)) != bytes)
+                return Status::IOError("Unable to read");
 
-        if (!os::File::read(buffer.data(), sizeof(buffer_value_type), cnt, fhandle))
-            return Status::IOError("Unable to seek");
+            return Status::Ok();
+        }
+
+        const auto first = address / blockSize() * blockSize();
+        const auto alignedBytes = blocksFor(address + bytes) * blockSize() - first;
+        auto staging = allocateAligned(alignedBytes);
+
+        if (!staging)
+            return Status::Fatal("Out of memory");
+
+        if (auto status = readBlocks(fhandle, first, alignedBytes, address + bytes - first, staging.get()); !status.isOk())
+            return status;
+
+        std::memcpy(buffer.data(), staging.get() + (address - first), bytes);
 
         return Status::Ok();
     }
 
     /**
-     * @brief Append data to device
+     * @brief Zero-copy access to "cnt" bytes starting from block index "n". Points directly to mapped device file if
+     * device opened with OpenOption::MemoryMapped, otherwise data is read into buffer owned by the view
+     * @param n - block index
+     * @param cnt - bytes count
+     * @param offset - offset within block "n" (non-zero only for packed records)
+     * @return {Status::Ok(), view} on success
+     */
+    [[nodiscard]] std::tuple<Status, View> view(block_index_type n, bytes_count_type cnt, block_offset_type offset = 0) {
+        if (cnt == 0)
+            return {Status::InvalidArgument("Empty buffer"), {}};
+
+        if (!opened())
+            return {Status::IOError("Device not opened"), {}};
+
+        if (auto status = checkRange(n, cnt, offset); !status.isOk())
+            return {status, {}};
+
+        if (openOption_.MemoryMapped) {
+            const auto address = addressOf(n, offset);
+
+            if (auto region = mappedRegion(address + std::uint64_t(cnt) * sizeof(buffer_value_type)); region) {
+                auto data = reinterpret_cast<const buffer_value_type*>(region->data.get() + address);
+
+                return {Status::Ok(), View{region->data, data, cnt}};
+            }
+        }
+
+        std::shared_ptr<buffer_type> buffer;
+
+        try {
+            buffer = std::make_shared<buffer_type>();
+        }
+        catch (...) {
+            return {Status::Fatal("Out of memory"), {}};
+        }
+
+        if (auto status = read(n, *buffer, cnt, offset); !status.isOk())
+            return {status, {}};
+
+        auto data = buffer->data();
+
+        return {Status::Ok(), View{std::move(buffer), data, cnt}};
+    }
+
+    /**
+     * @brief Read "cnt" bytes starting from block index "n" without waiting for completion.
+     * With IOEngine::IoUring callback is invoked on completion thread and shouldn't block, otherwise (and always with
+     * DirectIO or block cache) before readAsync() returns
+     * @param n - block index
+     * @param cnt - bytes count
+     * @param callback - receives {Status::Ok(), data} on success
+     * @param offset - offset within block "n" (non-zero only for packed records)
+     * @return Status::Ok() if read was submitted (callback will be invoked)
+     */
+    [[nodiscard]] Status readAsync(block_index_type n, bytes_count_type cnt, read_callback_type callback, block_offset_type offset = 0) {
+        if (cnt == 0)
+            return Status::InvalidArgument("Empty buffer");
+
+        if (!opened())
+            return Status::IOError("Device not opened");
+
+        if (auto status = checkRange(n, cnt, offset); !status.isOk())
+            return status;
+
+        if (std::atomic_load(&cache_) || openOption_.DirectIO) { // unaligned buffer can't be handed to the engine, served by read()
+            buffer_type buffer;
+            auto status = read(n, buffer, cnt, offset);
+
+            callback(status, status.isOk()? std::move(buffer) : buffer_type{});
+
+            return Status::Ok();
+        }
+
+        const auto fhandle = std::atomic_load(&readHandle_);
+
+        if (!fhandle)
+            return Status::IOError("Device not opened");
+
+        std::shared_ptr<buffer_type> buffer;
+
+        try {
+            buffer = std::make_shared<buffer_type>(cnt);
+        }
+        catch (...) {
+            return Status::Fatal("Out of memory");
+        }
+
+        const auto bytes = std::int64_t(cnt) * std::int64_t(sizeof(buffer_value_type));
+        auto data = buffer->data();
+
+        return asyncIO_.read(fhandle, data, std::uint64_t(bytes), std::int64_t(addressOf(n, offset)),
+                             [buffer{std::move(buffer)}, callback{std::move(callback)}, bytes](std::int64_t result) {
+                                 if (result != bytes)
+                                     callback(Status::IOError("Unable to read"), {});
+                                 else
+                                     callback(Status::Ok(), std::move(*buffer));
+                             });
+    }
+
+    /**
+     * @brief Append data to device. In group commit mode concurrent appends are coalesced into one write
      * @param buffer
-     * @return {Status::Ok(), index of written block, total written block count} on success
+     * @param bufferSize - count of bytes from buffer to write (0 - whole buffer)
+     * @return {Status::Ok(), index of first block, count of blocks record spans, offset within first block} on success
      */
-    [[nodiscard]] std::tuple<Status, block_index_type, block_count_type> append(const buffer_type& buffer, bytes_count_type bufferSize = 0) {
+    [[nodiscard]] append_result_type append(const buffer_type& buffer, bytes_count_type bufferSize = 0) {
         if (buffer.empty())
-            return {Status::InvalidArgument("Unable to write empty buffer"), 0, 0};
+            return failed(Status::InvalidArgument("Unable to write empty buffer"));
 
         if (!opened())
-            return {Status::IOError("Device not opened"), 0, 0};
+            return failed(Status::IOError("Device not opened"));
 
-        std::unique_lock lock(lock_);
+        bufferSize = (bufferSize == 0)? buffer.size() : std::min(bufferSize, buffer.size());
 
-        auto& fhandle = writeHandle_;
-        const auto cpos = os::File::tell(fhandle);
+        if (!openOption_.GroupCommit) {
+            std::unique_lock lock(lock_);
 
-        if (bufferSize == 0)
-            bufferSize = buffer.size();
-        else
-            bufferSize = std::min(bufferSize, buffer.size());
+            AppendRequest request{buffer.data(), bufferSize};
+            AppendRequest* requests[] = {&request};
+
+            return writeBatch(requests, 1)[0];
+        }
+
+        auto request = std::make_shared<AppendRequest>(buffer.data(), bufferSize);
+
+        return enqueue(std::move(request), true).get();
+    }
+
+    /**
+     * @brief Append data to device without waiting for write completion. Device takes ownership of buffer.
+     * In group commit mode the caller either joins the pending group (and returns immediately) or becomes
+     * group leader and writes the group itself. Otherwise with IOEngine::IoUring write is submitted to the ring
+     * and the future becomes ready on completion (packed records are written synchronously, because
+     * they share blocks with records still in flight).
+     * @param buffer
+     * @param bufferSize - count of bytes from buffer to write (0 - whole buffer)
+     * @return future of {Status::Ok(), index of first block, count of blocks record spans, offset within first block}
+     */
+    [[nodiscard]] std::future<append_result_type> appendAsync(buffer_type buffer, bytes_count_type bufferSize = 0) {
+        if (buffer.empty() || !opened()) {
+            std::promise<append_result_type> promise;
+
+            promise.set_value(failed(buffer.empty()? Status::InvalidArgument("Unable to write empty buffer") : Status::IOError("Device not opened")));
+
+            return promise.get_future();
+        }
 
-        if (os::File::write(buffer.data(), sizeof(buffer_value_type), bufferSize, fhandle) != bufferSize)
-            return {Status::Fatal("Unable to write."), 0, 0};
+        bufferSize = (bufferSize == 0)? buffer.size() : std::min(bufferSize, buffer.size());
 
-        if ((bufferSize % blockSize()) != 0) {
-            auto n = blockSize() - (bufferSize % blockSize());
+        auto request = std::make_shared<AppendRequest>(std::move(buffer), bufferSize);
 
-            if (os::File::write(fillbuffer.data(), sizeof(buffer_value_type), n, fhandle) != n)
-                return {Status::Fatal("Unable to write."), 0, 0};
+        if (openOption_.GroupCommit)
+            return enqueue(std::move(request), false);
+
+        auto future = request->promise.get_future();
+
+        if (asyncIO_.engine() == IOEngine::IoUring && !openOption_.PackRecords)
+            submitAppend(std::move(request));
+        else {
+            std::unique_lock lock(lock_);
+
+            AppendRequest* requests[] = {request.get()};
+
+            request->promise.set_value(writeBatch(requests, 1)[0]);
         }
 
-        os::File::flush(writeHandle_);
+        return future;
+    }
+
+    /**
+     * @brief Append several records with one write. Records are placed one after another in given order
+     * @param buffers
+     * @param count - count of buffers
+     * @return {Status::Ok(), index of first block, count of blocks record spans, offset within first block} per record
+     */
+    [[nodiscard]] std::vector<append_result_type> appendBatch(const buffer_type* buffers, std::size_t count) {
+        if (std::any_of(buffers, buffers + count, [](const auto& b) { return b.empty(); }))
+            return std::vector<append_result_type>(count, failed(Status::InvalidArgument("Unable to write empty buffer")));
+
+        if (!opened())
+            return std::vector<append_result_type>(count, failed(Status::IOError("Device not opened")));
+
+        std::vector<AppendRequest> requests;
+        std::vector<AppendRequest*> pointers;
 
-        const auto spos = os::File::tell(fhandle);
-        const auto blocksAdded = block_count_type(spos - cpos) / blockSize();
+        requests.reserve(count);
+        pointers.reserve(count);
 
-        blocks_.fetch_add(blocksAdded);
+        for (std::size_t i = 0; i < count; ++i) {
+            requests.emplace_back(buffers[i].data(), bytes_count_type(buffers[i].size()));
+            pointers.push_back(&requests.back());
+        }
+
+        std::unique_lock lock(lock_);
 
-        return {Status::Ok(), block_index_type(cpos / blockSize()), block_count_type(blocksAdded)};
+        return writeBatch(pointers.data(), count);
     }
 
     /**
-     * @brief sizeInBytes
+     * @brief Flush all appended data to the storage device
+     * @return Status::Ok() on success
+     */
+    Status sync() {
+        std::unique_lock lock(lock_);
+
+        if (!opened())
+            return Status::IOError("Device not opened");
+
+        std::unique_lock slock(syncLock_);
+
+        return doSync();
+    }
+
+    /**
+     * @brief Removes device file together with its end of log file
+     * @return true if device file removed
+     */
+    [[nodiscard]] static bool unlink(const os::path& path) noexcept {
+        SKV_UNUSED(os::File::unlink(endOfLogPath(path)));
+
+        return os::File::unlink(path);
+    }
+
+    /**
+     * @brief Renames device file together with its end of log file. Stale end of log file of "newPath" is removed
+     * @return true on success
+     */
+    [[nodiscard]] static bool rename(const os::path& oldPath, const os::path& newPath) noexcept {
+        SKV_UNUSED(os::File::unlink(endOfLogPath(newPath)));
+
+        if (!os::File::rename(oldPath, newPath))
+            return false;
+
+        boost::system::error_code ec;
+
+        return !os::fs::exists(endOfLogPath(oldPath), ec) || os::File::rename(endOfLogPath(oldPath), endOfLogPath(newPath));
+    }
+
+    /**
+     * @brief Logical size of device (end of last record)
      * @return
      */
     std::uint64_t sizeInBytes() const noexcept {
-        return uint64_t(openOption_.BlockSize) * sizeInBlocks();
+        return tail_.load();
     }
 
     /**
-     * @brief sizeInBlocks
+     * @brief Count of blocks used (last one may be partially filled if records are packed)
      * @return
      */
     block_count_type sizeInBlocks() const noexcept {
-        return blocks_.load();
+        return block_count_type(blocksFor(tail_.load()));
     }
 
     /**
@@ -265,6 +624,24 @@ public:
         return openOption_.BlockSize;
     }
 
+    /**
+     * @brief Engine actually serving asynchronous operations (io_uring falls back to blocking if unsupported by the kernel)
+     * @return
+     */
+    IOEngine ioEngine() const noexcept {
+        return asyncIO_.engine();
+    }
+
+    /**
+     * @brief Block cache counters, all zero if cache disabled
+     * @return
+     */
+    cache_stats_type cacheStats() const noexcept {
+        const auto cache = std::atomic_load(&cache_);
+
+        return cache? cache->stats() : cache_stats_type{};
+    }
+
     /**
      * @brief Device is opened
      * @return
@@ -274,31 +651,720 @@ public:
     }
 
 private:
+    struct AppendRequest {
+        AppendRequest(const buffer_value_type* d, bytes_count_type sz) noexcept:
+            data{d}, size{sz}
+        {}
+
+        AppendRequest(buffer_type&& b, bytes_count_type sz) noexcept:
+            owned{std::move(b)}, data{owned.data()}, size{sz}
+        {}
+
+        buffer_type owned;
+        const buffer_value_type* data;
+        bytes_count_type size;
+        std::promise<append_result_type> promise;
+        bool waiting{false};    // caller is blocked until request is written, so it may become leader
+        bool done{false};       // promise is set
+        bool lead{false};       // leadership is handed to caller
+    };
+
+    using AppendRequestPtr = std::shared_ptr<AppendRequest>;
+
+    static append_result_type failed(Status status) noexcept {
+        return {status, 0, 0, 0};
+    }
+
+    /* Group commit: the first caller finding no leader becomes one and writes pending requests group by group.
+     * After GROUP_LEADER_ROUNDS groups leadership is handed to caller waiting for its pending request ("wait"),
+     * so no caller writes for others forever. Requests of callers which don't wait are written by leader anyway */
+    std::future<append_result_type> enqueue(AppendRequestPtr request, bool wait) {
+        auto future = request->promise.get_future();
+
+        std::unique_lock qlock(queueLock_);
+
+        request->waiting = wait;
+        pendingAppends_.push_back(request);
+
+        if (groupLeaderActive_) { // current leader will write our request or hand leadership to us
+            if (!wait)
+                return future;
+
+            groupCond_.wait(qlock, [&request] { return request->done || request->lead; });
+
+            if (request->done)
+                return future;
+        }
+
+        groupLeaderActive_ = true;
+
+        lead(qlock);
+
+        return future;
+    }
+
+    void lead(std::unique_lock<std::mutex>& qlock) {
+        struct Leadership { // passed on however leader leaves
+            LogDevice& device;
+            std::unique_lock<std::mutex>& qlock;
+
+            ~Leadership() {
+                if (!qlock.owns_lock())
+                    qlock.lock();
+
+                device.handOver();
+            }
+        } leadership{*this, qlock};
+
+        std::vector<AppendRequestPtr> group;
+        std::vector<AppendRequest*> requests;
+
+        for (std::size_t round = 0; !pendingAppends_.empty(); ++round) {
+            if (round >= GROUP_LEADER_ROUNDS &&
+                std::any_of(std::begin(pendingAppends_), std::end(pendingAppends_), [](const auto& r) { return r->waiting; }))
+                return;
+
+            group.clear();
+            group.swap(pendingAppends_);
+
+            qlock.unlock();
+
+            std::vector<append_result_type> results;
+
+            try {
+                requests.clear();
+                std::transform(std::begin(group), std::end(group),
+                               std::back_inserter(requests),
+                               [](auto&& r) { return r.get(); });
+
+                std::unique_lock lock(lock_);
+
+                results = writeBatch(requests.data(), requests.size());
+            }
+            catch (...) { // requests of group fail, but their callers don't wait forever
+                results.clear();
+            }
+
+            for (std::size_t i = 0; i < group.size(); ++i)
+                group[i]->promise.set_value((i < results.size())? results[i] : failed(Status::Fatal("Unable to write.")));
+
+            qlock.lock();
+
+            for (const auto& r : group)
+                r->done = true;
+
+            groupCond_.notify_all();
+        }
+    }
+
+    /* Leader leaves: leadership goes to waiting caller of pending request, if there is one */
+    void handOver() noexcept {
+        auto it = std::find_if(std::begin(pendingAppends_), std::end(pendingAppends_), [](const auto& r) { return r->waiting; });
+
+        if (it != std::end(pendingAppends_)) {
+            (*it)->lead = true;
+            groupCond_.notify_all();
+        }
+        else
+            groupLeaderActive_ = false;
+    }
+
+    /* Reserves blocks for (unpacked) request and submits write to async engine. Blocks become readable when reserved,
+     * but their index is known to nobody until write completes. Writes complete out of order, so end of log file and
+     * cache see only writtenTail(). Short write is completed by blocking write, as blocking path does. Failed write
+     * leaves unwritten blocks within log (later records may be reserved already), so device refuses appends until
+     * it's reopened */
+    void submitAppend(AppendRequestPtr request) {
+        std::unique_lock lock(lock_);
+
+        if (!opened()) {
+            request->promise.set_value(failed(Status::IOError("Device not opened")));
+
+            return;
+        }
+
+        if (writeFailed_.load()) {
+            request->promise.set_value(failed(Status::Fatal("Log device failed")));
+
+            return;
+        }
+
+        const auto size = std::uint64_t(request->size) * sizeof(buffer_value_type);
+        const auto blockCount = blocksFor(size);
+        const auto padding = blockCount * blockSize() - size;
+        const auto start = appendPosition();
+
+        os::File::IoVec iov[] = {{request->data, size}, {fillbuffer.data(), padding}};
+        std::shared_ptr<char> staging;
+
+        if (openOption_.DirectIO) {
+            AppendRequest* requests[] = {request.get()};
+
+            staging = stage(requests, 1, start, start + blockCount * blockSize());
+
+            if (!staging) {
+                request->promise.set_value(failed(Status::Fatal("Out of memory")));
+
+                return;
+            }
+
+            iov[0] = {staging.get(), blockCount * blockSize()};
+            iov[1] = {nullptr, 0};
+        }
+
+        try {
+            std::lock_guard wlock(writesLock_);
+
+            pendingWrites_.insert(start);
+        }
+        catch (...) {
+            request->promise.set_value(failed(Status::Fatal("Out of memory")));
+
+            return;
+        }
+
+        reserve(start + blockCount * blockSize());
+
+        auto result = append_result_type{Status::Ok(), block_index_type(start / blockSize()), block_count_type(blockCount), 0};
+
+        auto status = asyncIO_.write(writeHandle_, iov, 2, std::int64_t(start),
+                                     [this, request, result, staging, start, vectors{std::array{iov[0], iov[1]}},
+                                      bytes{std::int64_t(blockCount * blockSize())}](std::int64_t written) {
+                                         if (written >= 0 && written < bytes)
+                                             written += std::int64_t(writeRest(vectors.data(), vectors.size(), std::uint64_t(written), start));
+
+                                         if (written != bytes) { // end of log stays before unwritten blocks
+                                             writeFailed_.store(true);
+                                             request->promise.set_value(failed(Status::Fatal("Unable to write.")));
+
+                                             return;
+                                         }
+
+                                         completeWrite(start);
+
+                                         if (auto status = syncIfNeeded(1); !status.isOk())
+                                             request->promise.set_value(failed(status));
+                                         else
+                                             request->promise.set_value(result);
+                                     });
+
+        if (status.isOk())
+            tail_.store(start + blockCount * blockSize());
+        else {
+            completeWrite(start);
+
+            request->promise.set_value(failed(status));
+        }
+    }
+
+    void completeWrite(std::uint64_t start) noexcept {
+        std::lock_guard wlock(writesLock_);
+
+        pendingWrites_.erase(start);
+    }
+
+    /* End of log covered by completed writes only: start of earliest async write still in flight */
+    std::uint64_t writtenTail() {
+        std::lock_guard wlock(writesLock_);
+
+        return pendingWrites_.empty()? tail_.load() : *std::begin(pendingWrites_);
+    }
+
+    /* Writes what is left of "count" buffers to be written at "offset" after first "skip" bytes were written */
+    std::uint64_t writeRest(const os::File::IoVec* iov, std::size_t count, std::uint64_t skip, std::uint64_t offset) noexcept {
+        os::File::IoVec rest[2];
+        std::size_t n = 0;
+        auto position = skip;
+
+        for (std::size_t i = 0; i < count && n < std::size(rest); ++i) {
+            if (position >= iov[i].size) {
+                position -= iov[i].size;
+
+                continue;
+            }
+
+            rest[n++] = {static_cast<const char*>(iov[i].data) + position, iov[i].size - position};
+            position = 0;
+        }
+
+        return os::File::pwritev(writeHandle_, rest, n, std::int64_t(offset + skip));
+    }
+
+    struct MappedRegion {
+        os::File::Mapping data;
+        std::uint64_t size;
+    };
+
+    /* Returns mapping covering at least "required" bytes of device file. Existing mapping is never changed, new one
+     * is published instead, so views and readers holding old mapping stay valid */
+    std::shared_ptr<const MappedRegion> mappedRegion(std::uint64_t required) {
+        auto region = std::atomic_load(&region_);
+
+        if (region && region->size >= required)
+            return region;
+
+        std::unique_lock lock(mapLock_);
+
+        region = std::atomic_load(&region_);
+
+        if (region && region->size >= required)
+            return region;
+
+        const auto fhandle = std::atomic_load(&readHandle_);
+
+#ifdef BUILDING_WINDOWS
+        const auto size = std::max(required, sizeInBytes()); // windows can't map beyond end of file
+#else
+        const auto chunk = std::max<std::uint64_t>(openOption_.MappingChunkSize, blockSize());
+        const auto size = ((required + chunk - 1) / chunk) * chunk;
+#endif
+
+        auto data = os::File::map(fhandle, size);
+
+        if (!data)
+            return {};
+
+        try {
+            region = std::make_shared<const MappedRegion>(MappedRegion{std::move(data), size});
+        }
+        catch (...) {
+            return {};
+        }
+
+        std::atomic_store(&region_, region);
+
+        return region;
+    }
+
+    std::uint64_t blocksFor(std::uint64_t bytes) const noexcept {
+        return (bytes / blockSize()) + (bytes % blockSize()? 1 : 0);
+    }
+
+    std::uint64_t addressOf(block_index_type n, block_offset_type offset) const noexcept {
+        return std::uint64_t(n) * blockSize() + offset;
+    }
+
+    /* Byte position of next record: unpacked records start at block boundary */
+    std::uint64_t appendPosition() const noexcept {
+        const auto tail = tail_.load();
+
+        return openOption_.PackRecords? tail : blocksFor(tail) * blockSize();
+    }
+
+    static std::shared_ptr<char> allocateAligned(std::uint64_t bytes) noexcept {
+        constexpr auto alignment = std::align_val_t{os::File::DirectIOAlignment};
+
+        auto ptr = static_cast<char*>(::operator new(std::size_t(bytes), alignment, std::nothrow));
+
+        if (!ptr)
+            return {};
+
+        try {
+            return std::shared_ptr<char>(ptr, [alignment](char* p) { ::operator delete(p, alignment); });
+        }
+        catch (...) {
+            ::operator delete(ptr, alignment);
+        }
+
+        return {};
+    }
+
+    /* Lays out requests written from "start" to "end" in one aligned buffer starting at block boundary: data of
+     * partially filled tail block, records (padded unless packed), zeros up to block boundary */
+    std::shared_ptr<char> stage(AppendRequest* const* requests, std::size_t count, std::uint64_t start, std::uint64_t end) const noexcept {
+        const auto first = start / blockSize() * blockSize();
+        const auto bytes = blocksFor(end) * blockSize() - first;
+        auto staging = allocateAligned(bytes);
+
+        if (!staging)
+            return {};
+
+        std::memset(staging.get(), 0, bytes);
+
+        if (start > first && tailBlock_)
+            std::memcpy(staging.get(), tailBlock_.get(), start - first);
+
+        auto position = start - first;
+
+        for (std::size_t i = 0; i < count; ++i) {
+            const auto size = std::uint64_t(requests[i]->size) * sizeof(buffer_value_type);
+
+            std::memcpy(staging.get() + position, requests[i]->data, size);
+
+            position += openOption_.PackRecords? size : blocksFor(size) * blockSize();
+        }
+
+        return staging;
+    }
+
+    /* Reads whole blocks, "offset" and "bytes" are multiples of block size and "ptr" is aligned in DirectIO mode.
+     * Read may stop at end of file (packed tail block) but should return at least "required" bytes */
+    Status readBlocks(const os::File::Handle& fhandle, std::uint64_t offset, std::uint64_t bytes, std::uint64_t required, char* ptr) const noexcept {
+        const auto count = os::File::pread(fhandle, ptr, bytes, std::int64_t(offset));
+
+        if (count < required)
+            return Status::IOError("Unable to read");
+
+        std::memset(ptr + count, 0, bytes - count);
+
+        return Status::Ok();
+    }
+
+    /* Serves blocks from cache, every run of missed blocks is read with one call. Only blocks below end of written
+     * log are admitted to cache: partially filled tail block still changes, blocks of writes in flight aren't written */
+    Status readCached(block_cache_type& cache, std::uint64_t address, buffer_value_type* ptr, std::uint64_t bytes) {
+        const auto firstBlock = address / blockSize();
+        const auto blockCount = std::size_t(blocksFor(address + bytes) - firstBlock);
+        const auto tail = writtenTail();
+        std::vector<std::shared_ptr<const buffer_type>> blocks(blockCount);
+
+        for (std::size_t i = 0; i < blockCount; ++i)
+            cache.lookup(CacheKey{openOption_.BlockCacheDeviceId, block_index_type(firstBlock + i)}, blocks[i]);
+
+        for (std::size_t i = 0; i < blockCount;) {
+            if (blocks[i]) {
+                ++i;
+
+                continue;
+            }
+
+            auto j = i;
+
+            while (j < blockCount && !blocks[j])
+                ++j;
+
+            const auto fhandle = std::atomic_load(&readHandle_);
+
+            if (!fhandle)
+                return Status::IOError("Device not opened");
+
+            const auto runOffset = (firstBlock + i) * blockSize();
+            const auto runBytes = std::uint64_t(j - i) * blockSize();
+            const auto required = std::min(address + bytes, runOffset + runBytes) - runOffset;
+            auto staging = allocateAligned(runBytes);
+
+            if (!staging)
+                return Status::Fatal("Out of memory");
+
+            if (auto status = readBlocks(fhandle, runOffset, runBytes, required, staging.get()); !status.isOk())
+                return status;
+
+            for (auto k = i; k < j; ++k) {
+                auto data = reinterpret_cast<const buffer_value_type*>(staging.get() + (k - i) * blockSize());
+
+                blocks[k] = std::make_shared<const buffer_type>(data, data + blockSize() / sizeof(buffer_value_type));
+
+                if ((firstBlock + k + 1) * blockSize() <= tail)
+                    cache.insert(CacheKey{openOption_.BlockCacheDeviceId, block_index_type(firstBlock + k)}, blocks[k]);
+            }
+
+            i = j;
+        }
+
+        auto dst = reinterpret_cast<char*>(ptr);
+        auto skip = address - firstBlock * blockSize();
+        std::uint64_t copied = 0;
+
+        for (std::size_t i = 0; i < blockCount; ++i) {
+            const auto chunk = std::min<std::uint64_t>(blockSize() - skip, bytes - copied);
+
+            std::memcpy(dst + copied, reinterpret_cast<const char*>(blocks[i]->data()) + skip, chunk);
+
+            copied += chunk;
+            skip = 0;
+        }
+
+        return Status::Ok();
+    }
+
+    Status checkRange(block_index_type n, bytes_count_type cnt, block_offset_type offset) const noexcept {
+        const auto bytes = std::uint64_t(cnt) * sizeof(buffer_value_type);
+
+        if (offset >= blockSize() || addressOf(n, offset) + bytes > tail_.load())
+            return Status::InvalidArgument("Out of range");
+
+        return Status::Ok();
+    }
+
+    /* Writes requests with a single gather write. lock_ must be held exclusively */
+    std::vector<append_result_type> writeBatch(AppendRequest* const* requests, std::size_t count) {
+        std::vector<append_result_type> results(count, failed(Status::IOError("Device not opened")));
+
+        if (!opened())
+            return results;
+
+        if (writeFailed_.load()) { // see submitAppend()
+            std::fill(std::begin(results), std::end(results), failed(Status::Fatal("Log device failed")));
+
+            return results;
+        }
+
+        std::vector<os::File::IoVec> iov;
+        iov.reserve(count * 2);
+
+        const auto start = appendPosition();
+        auto position = start;
+
+        for (std::size_t i = 0; i < count; ++i) {
+            const auto size = std::uint64_t(requests[i]->size) * sizeof(buffer_value_type);
+            const auto offset = position % blockSize();
+            const auto blockCount = blocksFor(offset + size);
+
+            iov.push_back({requests[i]->data, size});
+
+            results[i] = append_result_type{Status::Ok(), block_index_type(position / blockSize()), block_count_type(blockCount), block_offset_type(offset)};
+
+            if (openOption_.PackRecords)
+                position += size;
+            else {
+                const auto padding = blockCount * blockSize() - size;
+
+                if (padding > 0)
+                    iov.push_back({fillbuffer.data(), padding});
+
+                position += blockCount * blockSize();
+            }
+        }
+
+        auto writeOffset = start;
+        auto bytes = position - start;
+        std::shared_ptr<char> staging;
+
+        reserve(position);
+
+        if (openOption_.DirectIO) { // every vector of unbuffered write should be aligned, so batch is written as one buffer
+            staging = stage(requests, count, start, position);
+
+            if (!staging) {
+                std::fill(std::begin(results), std::end(results), failed(Status::Fatal("Out of memory")));
+
+                return results;
+            }
+
+            writeOffset = start / blockSize() * blockSize();
+            bytes = blocksFor(position) * blockSize() - writeOffset;
+
+            iov.assign(1, os::File::IoVec{staging.get(), bytes});
+
+            if (position % blockSize() != 0 && !tailExtended_) { // file is padded beyond logical end of log
+                std::unique_lock slock(syncLock_);
+
+                tailExtended_ = true;
+
+                if (!persistEndOfLog(true)) {
+                    std::fill(std::begin(results), std::end(results), failed(Status::IOError("Unable to save end of log")));
+
+                    return results;
+                }
+            }
+        }
+
+        if (os::File::pwritev(writeHandle_, iov.data(), iov.size(), std::int64_t(writeOffset)) != bytes) {
+            std::fill(std::begin(results), std::end(results), failed(Status::Fatal("Unable to write.")));
+
+            return results;
+        }
+
+        if (staging && tailBlock_ && position % blockSize() != 0) // next direct write rewrites partially filled block
+            std::memcpy(tailBlock_.get(), staging.get() + (position / blockSize() * blockSize() - writeOffset), position % blockSize());
+
+        tail_.store(position);
+
+        if (auto status = syncIfNeeded(count); !status.isOk())
+            std::fill(std::begin(results), std::end(results), failed(status));
+
+        return results;
+    }
+
+    /* Applies durability policy after "records" were written */
+    Status syncIfNeeded(std::size_t records) {
+        std::unique_lock lock(syncLock_);
+
+        switch (openOption_.DurabilityMode) {
+        case Durability::None:
+        case Durability::Flush:
+            return updateEndOfLog();
+        case Durability::Fsync:
+            return doSync();
+        case Durability::FsyncEveryN:
+            unsyncedRecords_ += records;
+
+            if (unsyncedRecords_ >= std::max<std::uint32_t>(openOption_.SyncEveryN, 1))
+                return doSync();
+
+            return updateEndOfLog();
+        case Durability::FsyncEveryMs:
+            unsyncedRecords_ += records;
+
+            if (std::chrono::steady_clock::now() - lastSync_ >= std::chrono::milliseconds{openOption_.SyncEveryMs})
+                return doSync();
+
+            return updateEndOfLog();
+        }
+
+        return Status::Ok();
+    }
+
+    /* Once file is extended beyond data, only end of log file tells where data ends. It's written (not synced) after
+     * every write not followed by sync, so records OS accepted survive crash of process as they do without it.
+     * syncLock_ must be held */
+    Status updateEndOfLog() {
+        if (tailExtended_ && !persistEndOfLog(false))
+            return Status::IOError("Unable to save end of log");
+
+        return Status::Ok();
+    }
+
+    Status doSync() { // syncLock_ must be held
+        unsyncedRecords_ = 0;
+        lastSync_ = std::chrono::steady_clock::now();
+
+        if (!os::File::sync(writeHandle_))
+            return Status::IOError("Unable to sync");
+
+        if (!persistEndOfLog(true))
+            return Status::IOError("Unable to save end of log");
+
+        return Status::Ok();
+    }
+
+    /* Reserves file space up to "end" bytes by PreallocationSize chunks. lock_ must be held exclusively.
+     * Preallocation is only an optimization, so failures are ignored */
+    void reserve(std::uint64_t end) {
+        if (openOption_.PreallocationSize == 0 || end <= allocated_)
+            return;
+
+        const auto chunk = std::max<std::uint64_t>(blocksFor(openOption_.PreallocationSize), 1) * blockSize();
+        const auto newAllocated = ((end + chunk - 1) / chunk) * chunk;
+
+        if (os::File::allocate(writeHandle_, allocated_, newAllocated - allocated_, true)) {
+            allocated_ = newAllocated;
+
+            return;
+        }
+
+        // file system can't keep file size: file is extended, so from now on only end of log file knows where data ends
+        std::unique_lock slock(syncLock_);
+
+        tailExtended_ = true;
+
+        if (persistEndOfLog(true) && os::File::allocate(writeHandle_, allocated_, newAllocated - allocated_, false))
+            allocated_ = newAllocated;
+    }
+
+    static os::path endOfLogPath(const os::path& path) {
+        auto p = path;
+
+        p += std::string(END_OF_LOG_SUFFIX);
+
+        return p;
+    }
+
+    /* End of log file is maintained if preallocation enabled, direct writes of packed records pad file to block size
+     * or it already exists. Logical end of log is taken from it
+     * only if file was extended beyond data, otherwise file size is authoritative (and survives crashes) */
+    bool initEndOfLog() {
+        const auto path = endOfLogPath(path_);
+        const auto exists = os::fs::exists(path);
+
+        if (!exists && openOption_.PreallocationSize == 0 && !(openOption_.DirectIO && openOption_.PackRecords))
+            return true;
+
+        endOfLogHandle_ = os::File::open(path, exists? "rb+" : "wb+");
+
+        if (!endOfLogHandle_)
+            return false;
+
+        std::uint64_t mark[3] = {0, 0, 0}; // magic, end of log, tail extended
+
+        if (exists && os::File::pread(endOfLogHandle_, mark, sizeof(mark), 0) == sizeof(mark) && mark[2] != 0) {
+            if (mark[0] == END_OF_LOG_MAGIC_V1)
+                mark[1] *= blockSize();
+
+            if (mark[0] == END_OF_LOG_MAGIC || mark[0] == END_OF_LOG_MAGIC_V1) {
+                tailExtended_ = true;
+
+                tail_.store(std::min<std::uint64_t>(mark[1], tail_.load()));
+            }
+        }
+
+        std::unique_lock slock(syncLock_);
+
+        return persistEndOfLog(true);
+    }
+
+    /* syncLock_ must be held */
+    bool persistEndOfLog(bool sync) {
+        if (!endOfLogHandle_)
+            return true;
+
+        const std::uint64_t mark[3] = {END_OF_LOG_MAGIC, writtenTail(), tailExtended_? 1u : 0u};
+
+        if (os::File::pwrite(endOfLogHandle_, mark, sizeof(mark), 0) != sizeof(mark))
+            return false;
+
+        return !sync || os::File::sync(endOfLogHandle_);
+    }
+
     bool createNew() {
         return static_cast<bool>(os::File::open(path_, "w"));
     }
 
-    bool initReaders() {
-        for (size_t i = 0; i < MAX_READ_THREADS; ++i) {
-            auto file = os::File::open(path_, "rb");
-            readHandles_[i].swap(file);
+    bool initReader() {
+        auto file = openOption_.DirectIO? os::File::openDirect(path_, "rb") : os::File::open(path_, "rb");
 
-            if (!readHandles_[i])
-                return false; // calling function will close all opened handles
-        }
+        if (!file)
+            return false; // calling function will close all opened handles
+
+        std::atomic_store(&readHandle_, std::move(file));
 
         return true;
     }
 
+    /* Direct writes of packed records rewrite partially filled tail block, so its data is kept in memory */
+    bool initTailBlock() {
+        if (!openOption_.DirectIO || !openOption_.PackRecords)
+            return true;
+
+        tailBlock_ = allocateAligned(blockSize());
+
+        if (!tailBlock_)
+            return false;
+
+        const auto tail = tail_.load();
+
+        if (tail % blockSize() == 0)
+            return true;
+
+        return readBlocks(writeHandle_, tail / blockSize() * blockSize(), blockSize(), tail % blockSize(), tailBlock_.get()).isOk();
+    }
+
     os::path path_;
     OpenOption openOption_;
-    std::atomic<block_count_type> blocks_{0};
-    bool opened_{false};
+    std::atomic<std::uint64_t> tail_{0}; // logical end of log in bytes
+    std::atomic<bool> opened_{false};
+    std::atomic<bool> writeFailed_{false}; // async write failed leaving unwritten blocks within log
+    std::mutex writesLock_;
+    std::set<std::uint64_t> pendingWrites_; // starts of async writes in flight (or failed), guarded by writesLock_
     os::File::Handle writeHandle_;
     buffer_type fillbuffer;
-    std::array<os::File::Handle, MAX_READ_THREADS> readHandles_;
-    std::array<std::mutex, MAX_READ_THREADS> readMutexes_;
+    os::File::Handle readHandle_; // accessed only via std::atomic_load/std::atomic_store
     std::shared_mutex lock_;
+    std::mutex queueLock_;
+    std::vector<AppendRequestPtr> pendingAppends_;
+    bool groupLeaderActive_{false};
+    std::condition_variable groupCond_;
+    std::mutex syncLock_;
+    std::size_t unsyncedRecords_{0};
+    std::chrono::steady_clock::time_point lastSync_{};
+    os::AsyncIO asyncIO_;
+    std::shared_ptr<const MappedRegion> region_; // accessed only via std::atomic_load/std::atomic_store
+    std::mutex mapLock_;
+    std::shared_ptr<block_cache_type> cache_; // accessed only via std::atomic_load/std::atomic_store
+    std::uint64_t allocated_{0}; // bytes of file space reserved, guarded by lock_
+    bool tailExtended_{false}; // file contains preallocated space beyond logical end of log
+    os::File::Handle endOfLogHandle_;
+    std::shared_ptr<char> tailBlock_; // aligned copy of partially filled tail block (packed records with DirectIO)
 };
 
 }
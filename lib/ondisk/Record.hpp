@@ -1,14 +1,18 @@
 #pragma once
 
+#include <algorithm>
 #include <cassert>
 #include <chrono>
 #include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <map>
 #include <memory>
 #include <set>
 #include <string>
+#include <string_view>
 #include <type_traits>
+#include <vector>
 
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/member.hpp>
@@ -17,6 +21,7 @@
 #include <boost/multi_index/tag.hpp>
 
 #include "Property.hpp"
+#include "RecordView.hpp"
 #include "vfs/IEntry.hpp"
 #include "vfs/IVolume.hpp"
 #include "util/Status.hpp"
@@ -32,7 +37,8 @@ using namespace skv::util;
 using namespace skv::vfs;
 
 /**
- * @brief Volume entry
+ * @brief Volume entry. Record read from flat format (see readFlat()) isn't unpacked: fields are read from its buffer
+ * until record is modified
  */
 class Record final {
 public:
@@ -55,52 +61,90 @@ public:
     }
 
     Record(const Record& other) {
-        using std::swap;
-
-        ImplPtr copy = std::make_unique<Impl>();
-        *copy = *other.impl_;
-
-        swap(impl_, copy);
+        copyFrom(other);
     }
 
     Record& operator=(const Record& other) {
-        using std::swap;
+        if (this != &other)
+            copyFrom(other);
 
-        ImplPtr copy = std::make_unique<Impl>();
-        *copy = *other.impl_;
+        return *this;
+    }
 
-        swap(impl_, copy);
+    Record(Record&& other) noexcept {
+        swap(other);
+    }
+
+    Record& operator=(Record&& other) noexcept {
+        swap(other);
 
         return *this;
     }
 
-    Record(Record&& other) noexcept {
-        using std::swap;
+    /**
+     * @brief Record occupying "size" bytes at "data" in flat format, bytes are copied into one buffer
+     * @return Status::Corruption() if record is malformed
+     */
+    static std::tuple<Status, Record> readFlat(const char* data, std::size_t size) {
+        auto [status, view] = RecordView::open(data, size);
 
-        swap(impl_, other.impl_);
+        if (!status.isOk())
+            return {status, {}};
+
+        auto buffer = std::make_unique<char[]>(size);
+
+        std::memcpy(buffer.get(), data, size);
+
+        return {Status::Ok(), Record{std::move(buffer), size}};
     }
 
-    Record& operator=(Record&& other) noexcept {
-        using std::swap;
+    /**
+     * @brief Appends record in flat format to "out", expired properties are skipped
+     */
+    template <typename Container>
+    void writeFlat(Container& out) const {
+        if (!impl_) {
+            out.insert(std::end(out), view_.data(), view_.data() + view_.size());
 
-        swap(impl_, other.impl_);
+            return;
+        }
 
-        return *this;
+        std::vector<RecordView::PropertyField> properties;
+
+        properties.reserve(impl_->properties_.size());
+
+        for (const auto& [prop, value] : impl_->properties_) {
+            auto it = impl_->propertyExpireMap_.find(prop);
+            const auto expires = (it != std::cend(impl_->propertyExpireMap_))? it->second : RecordView::NeverExpires;
+
+            if (!expired(expires))
+                properties.push_back({prop, &value, expires});
+        }
+
+        std::sort(std::begin(properties), std::end(properties), [](const auto& a, const auto& b) { return a.name < b.name; });
+
+        RecordView::write(out, impl_->key_, impl_->parent_, impl_->name_, properties, impl_->children_.template get<typename Impl::ChildByName>());
     }
 
     IEntry::Handle handle() const noexcept  {
-        return impl_->key_;
+        return impl_? impl_->key_ : view_.handle();
     }
 
     IEntry::Handle parent() const noexcept {
-        return impl_->parent_;
+        return impl_? impl_->parent_ : view_.parent();
     }
 
     std::string name() const  {
-        return impl_->name_;
+        return impl_? impl_->name_ : std::string{view_.name()};
     }
 
     bool hasProperty(const std::string& prop) const noexcept  {
+        if (!impl_) {
+            const auto i = view_.findProperty(prop);
+
+            return i != RecordView::npos && !expired(view_.propertyExpiration(i));
+        }
+
         if (propertyExpired(prop))
             return false;
 
@@ -116,6 +160,15 @@ public:
     }
 
     std::tuple<Status, Property> property(const std::string& prop) const  {
+        if (!impl_) {
+            const auto i = view_.findProperty(prop);
+
+            if (i == RecordView::npos || expired(view_.propertyExpiration(i)))
+                return {Status::NotFound("No such property"), {}};
+
+            return {Status::Ok(), view_.propertyValue(i)};
+        }
+
         if (propertyExpired(prop))
             return {Status::NotFound("No such property"), {}};
 
@@ -128,7 +181,7 @@ public:
     }
 
     Status removeProperty(const std::string& prop)  {
-        cancelPropertyExpiration(prop);
+        cancelPropertyExpiration(prop); // record is unpacked
 
         if (impl_->properties_.erase(prop) > 0)
             return Status::Ok();
@@ -140,6 +193,8 @@ public:
         if (!hasProperty(prop))
             return Status::NotFound("No such property");
 
+        materialize();
+
         auto nowms = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch());
 
         impl_->propertyExpireMap_[prop] = (nowms + tp).count();
@@ -148,6 +203,8 @@ public:
     }
 
     Status cancelPropertyExpiration(const std::string& prop)  {
+        materialize();
+
         impl_->propertyExpireMap_.erase(prop);
 
         return  Status::Ok();
@@ -156,6 +213,15 @@ public:
     IEntry::Properties properties() const  {
         IEntry::Properties ret;
 
+        if (!impl_) {
+            for (std::size_t i = 0; i < view_.propertiesCount(); ++i) {
+                if (!expired(view_.propertyExpiration(i)))
+                    ret[std::string{view_.propertyName(i)}] = view_.propertyValue(i);
+            }
+
+            return ret;
+        }
+
         for (const auto& [prop, value] : impl_->properties_) {
             if (!propertyExpired(prop))
                 ret[prop] = value;
@@ -167,6 +233,15 @@ public:
     std::set<std::string> propertiesNames() const  {
         std::set<std::string> ret;
 
+        if (!impl_) {
+            for (std::size_t i = 0; i < view_.propertiesCount(); ++i) {
+                if (!expired(view_.propertyExpiration(i)))
+                    ret.emplace(view_.propertyName(i));
+            }
+
+            return ret;
+        }
+
         for (const auto& [prop, value] : impl_->properties_) {
             SKV_UNUSED(value);
             
@@ -181,6 +256,8 @@ public:
         if (e.parent() != IVolume::InvalidHandle)
             return Status::InvalidArgument("Entry already has a parent");
 
+        materialize();
+
         Child c{e.name(), e.handle()};
 
         if (impl_->children_.insert(c).second) {
@@ -193,6 +270,8 @@ public:
     }
 
     Status removeChild(Record& e) {
+        materialize();
+
         auto& index = impl_->children_.template get<typename Impl::ChildByKey>();
 
         auto it = index.find(e.handle());
@@ -207,15 +286,48 @@ public:
     }
 
     Children children() const {
-        auto& index = impl_->children_.template get<typename Impl::ChildByKey>();
         Children ret;
 
+        if (!impl_) {
+            view_.forEachChild([&ret](std::string_view name, IEntry::Handle handle) { ret.emplace(name, handle); });
+
+            return ret;
+        }
+
+        auto& index = impl_->children_.template get<typename Impl::ChildByKey>();
+
         for (const auto& [name, handle] : index)
             ret[name] = handle;
 
         return ret;
     }
 
+    /**
+     * @brief Handle of child named "name"
+     */
+    std::tuple<Status, IEntry::Handle> child(const std::string& name) const {
+        if (!impl_) {
+            const auto handle = view_.findChild(name);
+
+            if (!handle)
+                return {Status::NotFound("No such child entry"), IVolume::InvalidHandle};
+
+            return {Status::Ok(), *handle};
+        }
+
+        auto& index = impl_->children_.template get<typename Impl::ChildByName>();
+        auto it = index.find(name);
+
+        if (it == std::end(index))
+            return {Status::NotFound("No such child entry"), IVolume::InvalidHandle};
+
+        return {Status::Ok(), it->second};
+    }
+
+    std::size_t childrenCount() const noexcept {
+        return impl_? impl_->children_.size() : view_.childrenCount();
+    }
+
     [[nodiscard]] bool operator==(const Record& other) const noexcept {
         return handle() == other.handle() &&
                parent() == other.parent() &&
@@ -237,15 +349,93 @@ public:
     }
 
 private:
-    friend std::ostream& operator<<(std::ostream& _os, const Record& p);
-    friend std::istream& operator>>(std::istream& _is, Record& p);
+    template <typename Reader>
+    friend void deserializeRecord(Reader& ds, Record& p);
+
+    template <typename Writer>
+    friend void serializeRecord(Writer& s, const Record& p);
+
+    friend std::size_t serializedSize(const Record& p) noexcept;
+
+    /* Takes ownership of "size" bytes of flat record validated by RecordView::open() */
+    Record(std::unique_ptr<char[]> buffer, std::size_t size) noexcept:
+        flat_{std::move(buffer)},
+        view_{std::get<1>(RecordView::open(flat_.get(), size))}
+    {}
+
+    void copyFrom(const Record& other) {
+        ImplPtr impl;
+        std::unique_ptr<char[]> flat;
+        RecordView view;
+
+        if (other.impl_) {
+            impl = std::make_unique<Impl>(*other.impl_);
+        }
+        else if (other.flat_) {
+            flat = std::make_unique<char[]>(other.view_.size());
+
+            std::memcpy(flat.get(), other.view_.data(), other.view_.size());
+
+            view = std::get<1>(RecordView::open(flat.get(), other.view_.size()));
+        }
+
+        impl_ = std::move(impl);
+        flat_ = std::move(flat);
+        view_ = view;
+    }
+
+    void swap(Record& other) noexcept {
+        using std::swap;
+
+        swap(impl_, other.impl_);
+        swap(flat_, other.flat_);
+        swap(view_, other.view_);
+    }
+
+    /* Unpacks record read from flat format, expired properties are dropped */
+    void materialize() {
+        if (impl_ || !flat_)
+            return;
+
+        auto impl = std::make_unique<Impl>();
+
+        impl->key_ = view_.handle();
+        impl->parent_ = view_.parent();
+        impl->name_ = view_.name();
+
+        for (std::size_t i = 0; i < view_.propertiesCount(); ++i) {
+            const auto expires = view_.propertyExpiration(i);
+
+            if (expired(expires))
+                continue;
+
+            std::string prop{view_.propertyName(i)};
+
+            if (expires != RecordView::NeverExpires)
+                impl->propertyExpireMap_[prop] = expires;
+
+            impl->properties_[std::move(prop)] = view_.propertyValue(i);
+        }
+
+        view_.forEachChild([&impl](std::string_view name, IEntry::Handle handle) {
+            impl->children_.insert(Child{std::string{name}, handle});
+        });
+
+        impl_ = std::move(impl);
+        flat_.reset();
+        view_ = {};
+    }
+
+    void setParent(IEntry::Handle p) {
+        materialize();
 
-    void setParent(IEntry::Handle p) noexcept {
         impl_->parent_ = p;
     }
 
     /* Removing all expired properties */
     void doPropertyCleanup() {
+        materialize();
+
         std::set<std::string> expired;
 
         for (const auto& [prop, tp] : impl_->propertyExpireMap_) {
@@ -265,8 +455,11 @@ private:
         if (it == std::cend(impl_->propertyExpireMap_))
             return false;
 
+        return expired(it->second);
+    }
+
+    static bool expired(std::int64_t exp) noexcept {
         auto now = chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
-        auto exp = it->second;
 
         return (now >= exp);
     }
@@ -293,15 +486,38 @@ private:
     using ImplPtr = std::unique_ptr<Impl>;
 
     ImplPtr impl_;
+    std::unique_ptr<char[]> flat_;  // record in flat format, until it's unpacked
+    RecordView view_;
+};
+
+/**
+ * @brief Bytes written by Record::writeFlat(), computed from sizes of fields (see RecordView) without laying
+ * record out. Property expiring meanwhile makes record written smaller
+ */
+inline std::size_t serializedSize(const Record& p) noexcept {
+    if (!p.impl_)
+        return p.view_.size();
 
+    const auto& children = p.impl_->children_.template get<typename Record::Impl::ChildByName>();
+    std::size_t size = RecordView::childrenSize(children);
+    std::size_t count = 0;
 
-};
+    for (const auto& [prop, value] : p.impl_->properties_) {
+        auto it = p.impl_->propertyExpireMap_.find(prop);
+        const auto expires = (it != std::cend(p.impl_->propertyExpireMap_))? it->second : RecordView::NeverExpires;
 
-inline std::istream& operator>>(std::istream& _is, Record& p) {
-    namespace be = boost::endian;
+        if (!Record::expired(expires)) {
+            size += RecordView::propertySize(prop, value, expires);
+            ++count;
+        }
+    }
 
-    Deserializer ds{_is};
+    return size + RecordView::headerSize(p.impl_->key_, p.impl_->parent_, p.impl_->name_, count, children.size());
+}
 
+/* Stream format, records are saved in flat format (see RecordView) now */
+template <typename Reader>
+inline void deserializeRecord(Reader& ds, Record& p) {
     decltype (p.handle()) handle;
     decltype (p.parent()) parent;
     decltype (p.name()) name;
@@ -316,7 +532,7 @@ inline std::istream& operator>>(std::istream& _is, Record& p) {
     std::uint64_t propertiesCount;
     ds >> propertiesCount;
 
-    for (decltype (propertiesCount) i = 0; i < propertiesCount; ++i) {
+    for (decltype (propertiesCount) i = 0; i < propertiesCount && ds.good(); ++i) {
         std::string prop;
         Property value;
 
@@ -330,18 +546,14 @@ inline std::istream& operator>>(std::istream& _is, Record& p) {
     std::uint64_t childrenCount;
     ds >> childrenCount;
 
-    for (decltype (childrenCount) i = 0; i < childrenCount; ++i) {
+    for (decltype (childrenCount) i = 0; i < childrenCount && ds.good(); ++i) {
         std::string cname;
         decltype (p.handle()) chandle;
 
         ds >> cname
            >> chandle;
 
-        Record child(chandle, cname);
-
-        [[maybe_unused]] auto status = ret.addChild(child);
-
-        assert(status.isOk());
+        ret.impl_->children_.insert(Record::Child{std::move(cname), chandle});
     }
 
     std::uint64_t expirePropertyCount;
@@ -349,7 +561,7 @@ inline std::istream& operator>>(std::istream& _is, Record& p) {
 
     auto& propertyExpire = ret.impl_->propertyExpireMap_;
 
-    for (decltype (expirePropertyCount) i = 0; i < expirePropertyCount; ++i) {
+    for (decltype (expirePropertyCount) i = 0; i < expirePropertyCount && ds.good(); ++i) {
         typename std::string pname;
         std::int64_t ts;
 
@@ -362,15 +574,12 @@ inline std::istream& operator>>(std::istream& _is, Record& p) {
     ret.doPropertyCleanup();
 
     p = std::move(ret);
-
-    return _is;
 }
 
-inline std::ostream& operator<<(std::ostream& _os, const Record& p) {
+template <typename Writer>
+inline void serializeRecord(Writer& s, const Record& p) {
     const_cast<Record&>(p).doPropertyCleanup();
 
-    Serializer s{_os};
-
     s << p.handle()
       << p.parent()
       << p.name();
@@ -385,7 +594,7 @@ inline std::ostream& operator<<(std::ostream& _os, const Record& p) {
           << value;
     }
 
-    const auto& children = p.children();
+    const auto& children = p.impl_->children_.template get<Record::Impl::ChildByName>();
     std::uint64_t childrenCount = children.size();
 
     s << childrenCount;
@@ -408,8 +617,34 @@ inline std::ostream& operator<<(std::ostream& _os, const Record& p) {
         s << name
           << tp;
     }
+}
+
+inline std::istream& operator>>(std::istream& _is, Record& p) {
+    Deserializer ds{_is};
+
+    deserializeRecord(ds, p);
+
+    return _is;
+}
+
+inline std::ostream& operator<<(std::ostream& _os, const Record& p) {
+    Serializer s{_os};
+
+    serializeRecord(s, p);
 
     return _os;
 }
 
+inline BufferReader& operator>>(BufferReader& r, Record& p) {
+    deserializeRecord(r, p);
+
+    return r;
+}
+
+inline BufferWriter& operator<<(BufferWriter& w, const Record& p) {
+    serializeRecord(w, p);
+
+    return w;
+}
+
 }
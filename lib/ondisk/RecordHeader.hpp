@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+
+#include "util/Crc32c.hpp"
+#include "util/Status.hpp"
+
+namespace skv::ondisk {
+
+using namespace skv::util;
+
+/**
+ * @brief Header of record appended to log device. Makes record self-describing: payload length, key, sequence number,
+ * flags and CRC32C of both header and payload, so index table can be rebuilt from log alone.
+ * Stored in host byte order, as the rest of on-disk data
+ *
+ * Version 1 header (24 bytes): magic, length, sequence, checksum, reserved. Such records are readable,
+ * but lack key and can't be replayed
+ * Version 2 header (32 bytes): magic, length, sequence, key, flags, checksum
+ */
+class RecordHeader final {
+    static constexpr std::uint32_t MAGIC_V1 = 0x31524B53; // "SKR1"
+    static constexpr std::uint32_t MAGIC    = 0x32524B53; // "SKR2"
+    static constexpr std::size_t SIZE_V1    = 24;
+
+public:
+    static constexpr std::size_t SIZE = 32;
+
+    enum Flags: std::uint32_t {
+        None        = 0,
+        Tombstone   = 1,    // key was removed, record has no payload
+        Flat        = 2     // payload is record in flat format (see RecordView), stream serialized otherwise
+    };
+
+    constexpr RecordHeader() noexcept = default;
+
+    constexpr RecordHeader(std::uint32_t length, std::uint64_t sequence, std::uint64_t key, std::uint32_t flags, std::uint32_t checksum, std::uint32_t size = SIZE) noexcept:
+        length_{length}, sequence_{sequence}, key_{key}, flags_{flags}, checksum_{checksum}, size_{size}
+    {}
+
+    /**
+     * @brief Payload bytes following header
+     */
+    constexpr std::uint32_t length() const noexcept { return length_; }
+
+    constexpr std::uint64_t sequence() const noexcept { return sequence_; }
+
+    constexpr std::uint64_t key() const noexcept { return key_; }
+
+    constexpr std::uint32_t flags() const noexcept { return flags_; }
+
+    constexpr bool tombstone() const noexcept { return (flags_ & Tombstone) != 0; }
+
+    constexpr std::uint32_t checksum() const noexcept { return checksum_; }
+
+    /**
+     * @brief Size of header itself (depends on header version)
+     */
+    constexpr std::uint32_t size() const noexcept { return size_; }
+
+    /**
+     * @brief Header carries key, so record may be replayed
+     */
+    constexpr bool replayable() const noexcept { return size_ == SIZE; }
+
+    /**
+     * @brief Writes header of payload at "dst"
+     * @param dst - SIZE bytes
+     * @param sequence - sequence number of record
+     * @param key - key of record
+     * @param flags - combination of Flags
+     * @param payload
+     * @param length - payload bytes
+     * @return
+     */
+    static RecordHeader write(char* dst, std::uint64_t sequence, std::uint64_t key, std::uint32_t flags, const char* payload, std::uint32_t length) noexcept {
+        encode(dst, length, sequence, key, flags, 0);
+
+        const RecordHeader header{length, sequence, key, flags, checksumOf(dst, SIZE - 4, payload, length)};
+
+        encode(dst, length, sequence, key, flags, header.checksum_);
+
+        return header;
+    }
+
+    /**
+     * @brief Size of record (header and payload) starting at "data" judging by its header
+     * @param available - bytes available at "data"
+     * @return 0 if there is no header at "data" (or "available" is too small to tell)
+     */
+    static std::size_t recordSize(const char* data, std::size_t available) noexcept {
+        std::uint32_t magic;
+        std::uint32_t length;
+
+        if (available < SIZE_V1)
+            return 0;
+
+        std::memcpy(&magic, data, sizeof(magic));
+        std::memcpy(&length, data + 4, sizeof(length));
+
+        if (magic == MAGIC)
+            return SIZE + length;
+
+        if (magic == MAGIC_V1)
+            return SIZE_V1 + length;
+
+        return 0;
+    }
+
+    /**
+     * @brief Reads and verifies header of record occupying "size" bytes at "data"
+     * @return {Status::Ok(), header} if checksum matches, Status::Corruption() if it doesn't,
+     * Status::NotFound() if record has no header (was written before headers were introduced)
+     */
+    static std::tuple<Status, RecordHeader> read(const char* data, std::size_t size) noexcept {
+        const auto expected = recordSize(data, size);
+
+        if (expected == 0 || expected != size)
+            return {Status::NotFound("No record header"), {}};
+
+        std::uint32_t magic;
+        std::uint32_t length;
+        std::uint64_t sequence;
+        std::uint64_t key{0};
+        std::uint32_t flags{None};
+        std::uint32_t checksum;
+
+        std::memcpy(&magic, data, sizeof(magic));
+        std::memcpy(&length, data + 4, sizeof(length));
+        std::memcpy(&sequence, data + 8, sizeof(sequence));
+
+        const auto headerSize = (magic == MAGIC)? SIZE : SIZE_V1;
+
+        if (magic == MAGIC) {
+            std::memcpy(&key, data + 16, sizeof(key));
+            std::memcpy(&flags, data + 24, sizeof(flags));
+            std::memcpy(&checksum, data + 28, sizeof(checksum));
+        }
+        else
+            std::memcpy(&checksum, data + 16, sizeof(checksum));
+
+        if (checksumOf(data, headerSize - ((magic == MAGIC)? 4 : 8), data + headerSize, length) != checksum)
+            return {Status::Corruption("Checksum mismatch"), {}};
+
+        return {Status::Ok(), RecordHeader{length, sequence, key, flags, checksum, std::uint32_t(headerSize)}};
+    }
+
+private:
+    static void encode(char* dst, std::uint32_t length, std::uint64_t sequence, std::uint64_t key, std::uint32_t flags, std::uint32_t checksum) noexcept {
+        const std::uint32_t magic = MAGIC;
+
+        std::memcpy(dst, &magic, sizeof(magic));
+        std::memcpy(dst + 4, &length, sizeof(length));
+        std::memcpy(dst + 8, &sequence, sizeof(sequence));
+        std::memcpy(dst + 16, &key, sizeof(key));
+        std::memcpy(dst + 24, &flags, sizeof(flags));
+        std::memcpy(dst + 28, &checksum, sizeof(checksum));
+    }
+
+    /* Checksum covers payload and header fields preceding checksum */
+    static std::uint32_t checksumOf(const char* header, std::size_t headerBytes, const char* payload, std::uint32_t length) noexcept {
+        return crc32c(header, headerBytes, crc32c(payload, length));
+    }
+
+    std::uint32_t length_{0};
+    std::uint64_t sequence_{0};
+    std::uint64_t key_{0};
+    std::uint32_t flags_{None};
+    std::uint32_t checksum_{0};
+    std::uint32_t size_{SIZE};
+};
+
+}
@@ -0,0 +1,755 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include "Property.hpp"
+#include "vfs/IEntry.hpp"
+#include "util/Status.hpp"
+#include "util/Varint.hpp"
+
+namespace skv::ondisk {
+
+using namespace skv::util;
+using namespace skv::vfs;
+
+/**
+ * @brief Read-only view of record stored in flat format. Fields are read straight from buffer: property and child
+ * lookups are binary searches, nothing is allocated (except value of string property).
+ * Stored in host byte order, offsets are relative to start of record, numbers are LEB128 varints (see Varint.hpp)
+ *
+ * Header: magic (4 bytes), size (4 bytes), handle, parent, name length, name, properties count, children count,
+ * offsets of properties (4 bytes each), offsets of every RESTART_INTERVAL-th child (4 bytes each)
+ * Property: name length, name, type << 1 | has expiration, [zigzag expiration time], value. Integer values are
+ * varints (zigzag if signed), floating point ones are copied as is, strings and blobs are prefixed by length
+ * Child: length of prefix shared with name of previous child, length of the rest of name, the rest of name, handle.
+ * Handle is zigzag difference with handle of previous child, unless child is first since restart: such child shares
+ * no prefix and has handle as is, so children are binary searched by restarts and scanned from the closest one.
+ * Properties and children are sorted by name
+ *
+ * Records written before (version 1) are read as well: 40 bytes header, 32 bytes property slots and
+ * 16 bytes child slots of fixed-width fields followed by names and values
+ */
+class RecordView final {
+public:
+    static constexpr std::uint32_t MAGIC            = 0x32464B53; // "SKF2"
+    static constexpr std::size_t RESTART_INTERVAL   = 16;
+
+    static constexpr std::int64_t NeverExpires = std::numeric_limits<std::int64_t>::max();
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    /* Property to write, see write() */
+    struct PropertyField {
+        std::string_view name;
+        const Property* value;
+        std::int64_t expires;   // ms since epoch
+    };
+
+    constexpr RecordView() noexcept = default;
+
+    /**
+     * @brief Validates record occupying "size" bytes at "data"
+     * @return {Status::Ok(), view} if every field lies within record, Status::Corruption() otherwise
+     */
+    static std::tuple<Status, RecordView> open(const char* data, std::size_t size) noexcept {
+        RecordView view{data, size};
+
+        if (size < 8 || view.read<std::uint32_t>(4) != size)
+            return {Status::Corruption("Invalid record"), {}};
+
+        const auto magic = view.read<std::uint32_t>(0);
+        const bool valid = (magic == MAGIC)? view.parse() : (magic == MAGIC_V1 && view.parseV1());
+
+        if (!valid)
+            return {Status::Corruption("Invalid record"), {}};
+
+        return {Status::Ok(), view};
+    }
+
+    /**
+     * @brief Appends record in flat format to "out"
+     * @param properties - sorted by name
+     * @param children - pairs of name and handle sorted by name
+     */
+    template <typename Container, typename Children>
+    static void write(Container& out, IEntry::Handle handle, IEntry::Handle parent, std::string_view name,
+                      const std::vector<PropertyField>& properties, const Children& children) {
+        std::uint64_t size = headerSize(handle, parent, name, properties.size(), children.size()) + childrenSize(children);
+
+        for (const auto& p : properties)
+            size += propertySize(p.name, *p.value, p.expires);
+
+        if (size > std::numeric_limits<std::uint32_t>::max())
+            throw std::length_error("Record too big");
+
+        const auto start = out.size();
+
+        out.resize(start + std::size_t(size));
+
+        char* dst = out.data() + start;
+        std::size_t pos = 8;
+
+        encode(dst, 0, MAGIC);
+        encode(dst, 4, std::uint32_t(size));
+
+        pos += encodeVarint(dst + pos, handle);
+        pos += encodeVarint(dst + pos, parent);
+        pos += writeString(dst + pos, name);
+        pos += encodeVarint(dst + pos, properties.size());
+        pos += encodeVarint(dst + pos, children.size());
+
+        const auto offsets = pos;
+        const auto restarts = offsets + properties.size() * sizeof(std::uint32_t);
+
+        pos = restarts + restartsCount(children.size()) * sizeof(std::uint32_t);
+
+        for (std::size_t i = 0; i < properties.size(); ++i) {
+            const auto& p = properties[i];
+            const bool expires = p.expires != NeverExpires;
+
+            encode(dst, offsets + i * sizeof(std::uint32_t), std::uint32_t(pos));
+
+            pos += writeString(dst + pos, p.name);
+            pos += encodeVarint(dst + pos, std::uint64_t(p.value->index()) << 1 | (expires? 1 : 0));
+
+            if (expires)
+                pos += encodeVarint(dst + pos, zigzagEncode(p.expires));
+
+            pos += writeValue(dst + pos, *p.value);
+        }
+
+        forEachChildEntry(children, [dst, restarts, &pos](std::size_t i, std::string_view child, std::size_t shared, std::uint64_t stored) {
+            if (i % RESTART_INTERVAL == 0)
+                encode(dst, restarts + i / RESTART_INTERVAL * sizeof(std::uint32_t), std::uint32_t(pos));
+
+            pos += encodeVarint(dst + pos, shared);
+            pos += writeString(dst + pos, child.substr(shared));
+            pos += encodeVarint(dst + pos, stored);
+        });
+    }
+
+    /**
+     * @brief Bytes taken by header of record except offsets of properties and children (see propertySize() and
+     * childrenSize()), see write()
+     */
+    static std::size_t headerSize(IEntry::Handle handle, IEntry::Handle parent, std::string_view name,
+                                  std::size_t propertiesCount, std::size_t childrenCount) noexcept {
+        return 8 + varintSize(handle) + varintSize(parent) + varintSize(name.size()) + name.size() +
+               varintSize(propertiesCount) + varintSize(childrenCount);
+    }
+
+    /**
+     * @brief Bytes taken by property (and its offset in header), see write()
+     */
+    static std::size_t propertySize(std::string_view name, const Property& value, std::int64_t expires) noexcept {
+        return sizeof(std::uint32_t) + varintSize(name.size()) + name.size() + varintSize(std::uint64_t(value.index()) << 1) +
+               ((expires != NeverExpires)? varintSize(zigzagEncode(expires)) : 0) + valueSize(value);
+    }
+
+    /**
+     * @brief Bytes taken by children sorted by name (and their restart offsets in header), see write()
+     */
+    template <typename Children>
+    static std::size_t childrenSize(const Children& children) noexcept {
+        std::size_t size = restartsCount(children.size()) * sizeof(std::uint32_t);
+
+        forEachChildEntry(children, [&size](std::size_t, std::string_view name, std::size_t shared, std::uint64_t handle) {
+            size += varintSize(shared) + varintSize(name.size() - shared) + name.size() - shared + varintSize(handle);
+        });
+
+        return size;
+    }
+
+    const char* data() const noexcept { return data_; }
+
+    std::size_t size() const noexcept { return size_; }
+
+    IEntry::Handle handle() const noexcept { return handle_; }
+
+    IEntry::Handle parent() const noexcept { return parent_; }
+
+    std::string_view name() const noexcept { return name_; }
+
+    std::size_t propertiesCount() const noexcept { return propertiesCount_; }
+
+    std::string_view propertyName(std::size_t i) const noexcept {
+        if (legacy())
+            return string(propertySlot(i));
+
+        PropertyEntry entry;
+
+        return propertyEntry(i, entry)? entry.name : std::string_view{};
+    }
+
+    /**
+     * @brief Expiration time of i-th property, ms since epoch (NeverExpires if property doesn't expire)
+     */
+    std::int64_t propertyExpiration(std::size_t i) const noexcept {
+        if (legacy())
+            return read<std::int64_t>(propertySlot(i) + 24);
+
+        PropertyEntry entry;
+
+        return propertyEntry(i, entry)? entry.expires : NeverExpires;
+    }
+
+    Property propertyValue(std::size_t i) const {
+        if (legacy()) {
+            const auto slot = propertySlot(i);
+
+            return readValue(read<std::uint16_t>(slot + 16), data_ + read<std::uint32_t>(slot + 8), read<std::uint32_t>(slot + 12), true);
+        }
+
+        PropertyEntry entry;
+
+        if (!propertyEntry(i, entry))
+            return {};
+
+        return readValue(entry.type, entry.value, entry.length, false);
+    }
+
+    /**
+     * @return index of property named "name" or npos
+     */
+    std::size_t findProperty(std::string_view name) const noexcept {
+        std::size_t first = 0;
+        std::size_t last = propertiesCount();
+
+        while (first < last) {
+            const auto middle = first + (last - first) / 2;
+            const auto c = propertyName(middle).compare(name);
+
+            if (c == 0)
+                return middle;
+
+            if (c < 0)
+                first = middle + 1;
+            else
+                last = middle;
+        }
+
+        return npos;
+    }
+
+    std::size_t childrenCount() const noexcept { return childrenCount_; }
+
+    /**
+     * @brief Calls f(name, handle) for every child in order of names
+     */
+    template <typename F>
+    void forEachChild(F&& f) const {
+        if (legacy()) {
+            for (std::size_t i = 0; i < childrenCount(); ++i) {
+                const auto slot = childSlot(i);
+
+                f(string(slot), IEntry::Handle(read<std::uint64_t>(slot + 8)));
+            }
+
+            return;
+        }
+
+        if (childrenCount() == 0)
+            return;
+
+        std::string name;
+        std::uint64_t handle{0};
+        const char* p = data_ + restart(0);
+
+        for (std::size_t i = 0; i < childrenCount(); ++i) {
+            ChildEntry entry;
+
+            if (!(p = childEntry(p, entry)))
+                return;
+
+            name.resize(entry.shared);
+            name.append(entry.suffix);
+            handle = (i % RESTART_INTERVAL == 0)? entry.handle : handle + std::uint64_t(zigzagDecode(entry.handle));
+
+            f(std::string_view{name}, IEntry::Handle(handle));
+        }
+    }
+
+    /**
+     * @return handle of child named "name" if there is such child
+     */
+    std::optional<IEntry::Handle> findChild(std::string_view name) const noexcept {
+        return legacy()? findChildV1(name) : findChildEntry(name);
+    }
+
+private:
+    static constexpr std::uint32_t MAGIC_V1            = 0x31464B53; // "SKF1"
+    static constexpr std::size_t HEADER_SIZE_V1        = 40;
+    static constexpr std::size_t PROPERTY_SLOT_SIZE_V1 = 32;
+    static constexpr std::size_t CHILD_SLOT_SIZE_V1    = 16;
+
+    struct PropertyEntry {
+        std::string_view name;
+        std::uint16_t type;
+        std::int64_t expires;
+        const char* value;
+        std::size_t length;
+    };
+
+    struct ChildEntry {
+        std::uint64_t shared;
+        std::string_view suffix;
+        std::uint64_t handle;   // as stored: difference with previous handle unless child is first since restart
+    };
+
+    RecordView(const char* data, std::size_t size) noexcept:
+        data_{data}, size_{size}
+    {}
+
+    bool legacy() const noexcept { return magic_ == MAGIC_V1; }
+
+    /* Reads header and checks every property and child */
+    bool parse() noexcept {
+        const char* const end = data_ + size_;
+        const char* p = data_ + 8;
+        std::uint64_t handle{0};
+        std::uint64_t parent{0};
+        std::uint64_t length{0};
+        std::uint64_t propertiesCount{0};
+        std::uint64_t childrenCount{0};
+
+        if (!(p = decodeVarint(p, end, handle)) || !(p = decodeVarint(p, end, parent)) ||
+            !(p = decodeVarint(p, end, length)) || length > std::uint64_t(end - p))
+            return false;
+
+        name_ = {p, std::size_t(length)};
+        p += length;
+
+        if (!(p = decodeVarint(p, end, propertiesCount)) || !(p = decodeVarint(p, end, childrenCount)) ||
+            propertiesCount > size_ || childrenCount > size_ ||
+            (propertiesCount + restartsCount(std::size_t(childrenCount))) * sizeof(std::uint32_t) > std::uint64_t(end - p))
+            return false;
+
+        magic_ = MAGIC;
+        handle_ = handle;
+        parent_ = parent;
+        propertiesCount_ = std::size_t(propertiesCount);
+        childrenCount_ = std::size_t(childrenCount);
+        properties_ = std::size_t(p - data_);
+        restarts_ = properties_ + propertiesCount_ * sizeof(std::uint32_t);
+
+        const auto entries = restarts_ + restartsCount(childrenCount_) * sizeof(std::uint32_t);
+
+        for (std::size_t i = 0; i < propertiesCount_; ++i) {
+            PropertyEntry entry;
+            const auto offset = read<std::uint32_t>(properties_ + i * sizeof(std::uint32_t));
+
+            if (offset < entries || !propertyEntry(i, entry))
+                return false;
+        }
+
+        p = nullptr;
+        length = 0;
+
+        for (std::size_t i = 0; i < childrenCount_; ++i) {
+            ChildEntry entry;
+
+            if (i % RESTART_INTERVAL == 0) {
+                const auto offset = restart(i / RESTART_INTERVAL);
+
+                if (offset < entries || offset >= size_ || (p && p != data_ + offset))
+                    return false;
+
+                p = data_ + offset;
+            }
+
+            if (!(p = childEntry(p, entry)) || entry.shared > length || (i % RESTART_INTERVAL == 0 && entry.shared != 0))
+                return false;
+
+            length = entry.shared + entry.suffix.size();
+        }
+
+        return true;
+    }
+
+    bool parseV1() noexcept {
+        if (size_ < HEADER_SIZE_V1)
+            return false;
+
+        propertiesCount_ = read<std::uint32_t>(32);
+        childrenCount_ = read<std::uint32_t>(36);
+
+        if (HEADER_SIZE_V1 + std::uint64_t(propertiesCount_) * PROPERTY_SLOT_SIZE_V1 +
+                std::uint64_t(childrenCount_) * CHILD_SLOT_SIZE_V1 > size_)
+            return false;
+
+        if (!within(read<std::uint32_t>(24), read<std::uint32_t>(28)))
+            return false;
+
+        for (std::size_t i = 0; i < propertiesCount_; ++i) {
+            const auto slot = propertySlot(i);
+            const auto type = read<std::uint16_t>(slot + 16);
+            const auto length = read<std::uint32_t>(slot + 12);
+
+            if (!within(read<std::uint32_t>(slot), read<std::uint32_t>(slot + 4)) ||
+                !within(read<std::uint32_t>(slot + 8), length) ||
+                type >= std::variant_size_v<Property> ||
+                (fixedSize(type) != 0 && fixedSize(type) != length))
+                return false;
+        }
+
+        for (std::size_t i = 0; i < childrenCount_; ++i) {
+            const auto slot = childSlot(i);
+
+            if (!within(read<std::uint32_t>(slot), read<std::uint32_t>(slot + 4)))
+                return false;
+        }
+
+        magic_ = MAGIC_V1;
+        handle_ = IEntry::Handle(read<std::uint64_t>(8));
+        parent_ = IEntry::Handle(read<std::uint64_t>(16));
+        name_ = string(24);
+
+        return true;
+    }
+
+    template <typename T>
+    T read(std::size_t offset) const noexcept {
+        T value;
+
+        std::memcpy(&value, data_ + offset, sizeof(value));
+
+        return value;
+    }
+
+    template <typename T>
+    static void encode(char* dst, std::size_t offset, T value) noexcept {
+        std::memcpy(dst + offset, &value, sizeof(value));
+    }
+
+    static std::size_t restartsCount(std::size_t childrenCount) noexcept {
+        return (childrenCount + RESTART_INTERVAL - 1) / RESTART_INTERVAL;
+    }
+
+    std::size_t restart(std::size_t i) const noexcept {
+        return read<std::uint32_t>(restarts_ + i * sizeof(std::uint32_t));
+    }
+
+    /* Decodes i-th property, false if it doesn't lie within record */
+    bool propertyEntry(std::size_t i, PropertyEntry& entry) const noexcept {
+        const char* const end = data_ + size_;
+        const auto offset = read<std::uint32_t>(properties_ + i * sizeof(std::uint32_t));
+        const char* p = data_ + std::min<std::size_t>(offset, size_);
+        std::uint64_t length{0};
+        std::uint64_t tag{0};
+
+        if (!(p = decodeVarint(p, end, length)) || length > std::uint64_t(end - p))
+            return false;
+
+        entry.name = {p, std::size_t(length)};
+        p += length;
+
+        if (!(p = decodeVarint(p, end, tag)) || (tag >> 1) >= std::variant_size_v<Property>)
+            return false;
+
+        entry.type = std::uint16_t(tag >> 1);
+        entry.expires = NeverExpires;
+
+        if ((tag & 1) != 0) {
+            std::uint64_t expires{0};
+
+            if (!(p = decodeVarint(p, end, expires)))
+                return false;
+
+            entry.expires = zigzagDecode(expires);
+        }
+
+        const auto [fixed, integral] = typeOf(entry.type);
+
+        if (integral) {
+            std::uint64_t value{0};
+
+            entry.value = p;
+
+            if (!(p = decodeVarint(p, end, value)))
+                return false;
+
+            entry.length = std::size_t(p - entry.value);
+        }
+        else if (fixed != 0) {
+            if (fixed > std::size_t(end - p))
+                return false;
+
+            entry.value = p;
+            entry.length = fixed;
+        }
+        else {
+            if (!(p = decodeVarint(p, end, length)) || length > std::uint64_t(end - p))
+                return false;
+
+            entry.value = p;
+            entry.length = std::size_t(length);
+        }
+
+        return true;
+    }
+
+    /* Decodes child at "p", returns position of next child or nullptr if child doesn't lie within record */
+    const char* childEntry(const char* p, ChildEntry& entry) const noexcept {
+        const char* const end = data_ + size_;
+        std::uint64_t length{0};
+
+        if (!(p = decodeVarint(p, end, entry.shared)) || !(p = decodeVarint(p, end, length)) || length > std::uint64_t(end - p))
+            return nullptr;
+
+        entry.suffix = {p, std::size_t(length)};
+
+        return decodeVarint(p + length, end, entry.handle);
+    }
+
+    /* Restart with greatest name not above "name" is found by binary search, its children are scanned. Name of child
+     * isn't assembled: prefix matched so far tells whether child sharing longer prefix with previous one is still
+     * ordered before "name" */
+    std::optional<IEntry::Handle> findChildEntry(std::string_view name) const noexcept {
+        std::size_t first = 0;
+        std::size_t last = restartsCount(childrenCount());
+
+        while (first < last) {
+            const auto middle = first + (last - first) / 2;
+            ChildEntry entry;
+
+            if (!childEntry(data_ + restart(middle), entry))
+                return std::nullopt;
+
+            if (entry.suffix.compare(name) <= 0)
+                first = middle + 1;
+            else
+                last = middle;
+        }
+
+        if (first == 0)
+            return std::nullopt;
+
+        const auto count = std::min(RESTART_INTERVAL, childrenCount() - (first - 1) * RESTART_INTERVAL);
+        const char* p = data_ + restart(first - 1);
+        std::uint64_t handle{0};
+        std::size_t matched = 0;
+        int order = 0;
+
+        for (std::size_t i = 0; i < count; ++i) {
+            ChildEntry entry;
+
+            if (!(p = childEntry(p, entry)))
+                return std::nullopt;
+
+            handle = (i == 0)? entry.handle : handle + std::uint64_t(zigzagDecode(entry.handle));
+
+            if (i == 0 || entry.shared <= matched) {
+                const auto shared = std::size_t(entry.shared);
+                const auto length = shared + entry.suffix.size();
+                const auto rest = name.substr(shared);
+
+                matched = shared + std::size_t(std::mismatch(std::begin(entry.suffix), std::end(entry.suffix),
+                                                             std::begin(rest), std::end(rest)).first - std::begin(entry.suffix));
+
+                if (matched == length && matched == name.size())
+                    return IEntry::Handle(handle);
+
+                if (matched == length)
+                    order = -1;
+                else if (matched == name.size())
+                    order = 1;
+                else
+                    order = (std::uint8_t(entry.suffix[matched - shared]) < std::uint8_t(name[matched]))? -1 : 1;
+            }
+
+            if (order > 0)
+                return std::nullopt;
+        }
+
+        return std::nullopt;
+    }
+
+    std::optional<IEntry::Handle> findChildV1(std::string_view name) const noexcept {
+        std::size_t first = 0;
+        std::size_t last = childrenCount();
+
+        while (first < last) {
+            const auto middle = first + (last - first) / 2;
+            const auto c = string(childSlot(middle)).compare(name);
+
+            if (c == 0)
+                return IEntry::Handle(read<std::uint64_t>(childSlot(middle) + 8));
+
+            if (c < 0)
+                first = middle + 1;
+            else
+                last = middle;
+        }
+
+        return std::nullopt;
+    }
+
+    /* Calls f(index, name, length of prefix shared with previous name, handle as stored) for children to write */
+    template <typename Children, typename F>
+    static void forEachChildEntry(const Children& children, F&& f) {
+        std::string_view previous;
+        std::uint64_t previousHandle{0};
+        std::size_t i = 0;
+
+        for (const auto& [name, handle] : children) {
+            const std::string_view current{name};
+            const bool restart = i % RESTART_INTERVAL == 0;
+            const auto shared = restart? 0 : std::size_t(std::mismatch(std::begin(previous), std::end(previous),
+                                                                      std::begin(current), std::end(current)).first - std::begin(previous));
+
+            f(i, current, shared, restart? std::uint64_t(handle) : zigzagEncode(std::int64_t(std::uint64_t(handle) - previousHandle)));
+
+            previous = current;
+            previousHandle = handle;
+            ++i;
+        }
+    }
+
+    /* String referred by offset and length stored at "offset" (version 1) */
+    std::string_view string(std::size_t offset) const noexcept {
+        return {data_ + read<std::uint32_t>(offset), read<std::uint32_t>(offset + 4)};
+    }
+
+    std::size_t propertySlot(std::size_t i) const noexcept {
+        return HEADER_SIZE_V1 + i * PROPERTY_SLOT_SIZE_V1;
+    }
+
+    std::size_t childSlot(std::size_t i) const noexcept {
+        return HEADER_SIZE_V1 + propertiesCount_ * PROPERTY_SLOT_SIZE_V1 + i * CHILD_SLOT_SIZE_V1;
+    }
+
+    bool within(std::uint32_t offset, std::uint32_t length) const noexcept {
+        return std::uint64_t(offset) + length <= size_;
+    }
+
+    static std::size_t writeString(char* dst, std::string_view s) noexcept {
+        const auto size = encodeVarint(dst, s.size());
+
+        if (!s.empty())
+            std::memcpy(dst + size, s.data(), s.size());
+
+        return size + s.size();
+    }
+
+    /* Size of value of "type" (0 if values of "type" vary in size) and whether it's integer */
+    template <std::size_t I = 0>
+    static std::tuple<std::size_t, bool> typeOf(std::uint16_t type) noexcept {
+        if constexpr (I == std::variant_size_v<Property>) {
+            return {0, false};
+        }
+        else {
+            using T = std::variant_alternative_t<I, Property>;
+
+            if (type != I)
+                return typeOf<I + 1>(type);
+
+            if constexpr (std::is_arithmetic_v<T>)
+                return {sizeof(T), std::is_integral_v<T>};
+            else
+                return {0, false};
+        }
+    }
+
+    static std::size_t fixedSize(std::uint16_t type) noexcept {
+        return std::get<0>(typeOf(type));
+    }
+
+    template <typename T>
+    static std::uint64_t integerOf(T v) noexcept {
+        if constexpr (std::is_signed_v<T>)
+            return zigzagEncode(v);
+        else
+            return v;
+    }
+
+    static std::size_t valueSize(const Property& value) noexcept {
+        return std::visit([](auto&& v) -> std::size_t {
+            using T = std::decay_t<decltype(v)>;
+
+            if constexpr (std::is_integral_v<T>)
+                return varintSize(integerOf(v));
+            else if constexpr (std::is_arithmetic_v<T>)
+                return sizeof(v);
+            else
+                return varintSize(v.size()) + v.size();
+        }, value);
+    }
+
+    static std::size_t writeValue(char* dst, const Property& value) noexcept {
+        return std::visit([dst](auto&& v) -> std::size_t {
+            using T = std::decay_t<decltype(v)>;
+
+            if constexpr (std::is_integral_v<T>) {
+                return encodeVarint(dst, integerOf(v));
+            }
+            else if constexpr (std::is_arithmetic_v<T>) {
+                std::memcpy(dst, &v, sizeof(v));
+
+                return sizeof(v);
+            }
+            else
+                return writeString(dst, std::string_view{v.data(), v.size()});
+        }, value);
+    }
+
+    /* Value of "length" bytes at "data", integers are varints unless record is of version 1 */
+    template <std::size_t I = 0>
+    static Property readValue(std::uint16_t type, const char* data, std::size_t length, bool legacy) {
+        if constexpr (I == std::variant_size_v<Property>) {
+            return {};
+        }
+        else {
+            using T = std::variant_alternative_t<I, Property>;
+
+            if (type != I)
+                return readValue<I + 1>(type, data, length, legacy);
+
+            if constexpr (std::is_integral_v<T>) {
+                if (!legacy) {
+                    std::uint64_t value{0};
+
+                    if (!decodeVarint(data, data + length, value))
+                        return {};
+
+                    if constexpr (std::is_signed_v<T>)
+                        return Property{std::in_place_index<I>, T(zigzagDecode(value))};
+                    else
+                        return Property{std::in_place_index<I>, T(value)};
+                }
+            }
+
+            if constexpr (std::is_arithmetic_v<T>) {
+                T value;
+
+                std::memcpy(&value, data, sizeof(value));
+
+                return Property{std::in_place_index<I>, value};
+            }
+            else
+                return Property{std::in_place_index<I>, data, data + length};
+        }
+    }
+
+    const char* data_{nullptr};
+    std::size_t size_{0};
+    std::uint32_t magic_{0};
+    IEntry::Handle handle_{0};
+    IEntry::Handle parent_{0};
+    std::string_view name_;
+    std::size_t propertiesCount_{0};
+    std::size_t childrenCount_{0};
+    std::size_t properties_{0};   // offset of property offsets
+    std::size_t restarts_{0};     // offset of restart offsets
+};
+
+}
@@ -0,0 +1,694 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "Durability.hpp"
+#include "LogDevice.hpp"
+#include "os/File.hpp"
+#include "util/Status.hpp"
+#include "util/Unused.hpp"
+
+namespace skv::ondisk {
+
+using namespace skv::util;
+
+/**
+ * @brief Log device split into numbered segment files ("<path>.000000", "<path>.000001", ...).
+ * Records are appended to the last (active) segment, which is sealed and replaced by a new one when it reaches
+ * segment size. Sealed segments are never written again, so they may be compacted and unlinked one by one:
+ * appends hold shared lock of segment's append gate, segment is sealed (or unlinked) once gate is drained.
+ * Each segment is addressed by its own block indices, so volume size isn't limited by block_index_type.
+ */
+template <typename SegmentIndex = std::uint32_t,
+          typename BlockIndex   = std::uint32_t,
+          typename BlockCount   = std::uint32_t,
+          typename Buffer       = std::vector<char>>
+class SegmentedLogDevice final
+{
+    static constexpr std::uint64_t DEFAULT_SEGMENT_SIZE = std::uint64_t{256} * 1024 * 1024;
+    static constexpr int SEGMENT_SUFFIX_DIGITS = 6;
+
+public:
+    using segment_type          = LogDevice<BlockIndex, BlockCount, Buffer>;
+    using segment_index_type    = std::decay_t<SegmentIndex>;
+    using buffer_type           = typename segment_type::buffer_type;
+    using block_index_type      = typename segment_type::block_index_type;
+    using block_count_type      = typename segment_type::block_count_type;
+    using block_offset_type     = typename segment_type::block_offset_type;
+    using bytes_count_type      = typename segment_type::bytes_count_type;
+    using read_callback_type    = typename segment_type::read_callback_type;
+    using block_cache_type      = typename segment_type::block_cache_type;
+    using cache_stats_type      = typename segment_type::cache_stats_type;
+    using View                  = typename segment_type::View;
+
+    static_assert (std::is_unsigned_v<segment_index_type>, "segment_index_type should be unsigned");
+
+    using append_result_type    = std::tuple<Status, segment_index_type, block_index_type, block_count_type, block_offset_type>;
+
+    struct OpenOption: segment_type::OpenOption {
+        OpenOption() = default;
+        std::uint64_t   SegmentSize{DEFAULT_SEGMENT_SIZE}; // active segment is sealed when next record doesn't fit. Other options are applied to every segment, but one block cache of BlockCacheSize is shared by all of them
+    };
+
+    struct SegmentInfo {
+        segment_index_type index;
+        std::uint64_t bytes;    // logical size of segment
+        bool active;            // segment receives appends
+    };
+
+    SegmentedLogDevice() = default;
+
+    ~SegmentedLogDevice() noexcept {
+        close();
+    }
+
+    SegmentedLogDevice(const SegmentedLogDevice&) = delete;
+    SegmentedLogDevice& operator=(const SegmentedLogDevice&) = delete;
+
+    SegmentedLogDevice(SegmentedLogDevice&&) = delete;
+    SegmentedLogDevice& operator=(SegmentedLogDevice&&) = delete;
+
+    /**
+     * @brief Opens all segments of device. Monolithic device file created before segmentation becomes segment 0
+     * @param path - device path, segment files are named after it
+     * @param options
+     * @return
+     */
+    [[nodiscard]] Status open(const os::path& path, OpenOption options) {
+        std::unique_lock lock(segmentsLock_);
+
+        if (std::atomic_load(&segments_))
+            return Status::InvalidOperation("Device already opened");
+
+        auto indices = listSegments(path);
+        boost::system::error_code ec;
+
+        if (indices.empty() && os::fs::is_regular_file(path, ec)) {
+            if (!segment_type::rename(path, segmentPath(path, 0)))
+                return Status::IOError("Unable to open device");
+
+            indices.push_back(0);
+        }
+
+        if (indices.empty()) {
+            if (!options.CreateNewIfNotExist)
+                return Status::IOError("File not exists.");
+
+            indices.push_back(0);
+        }
+
+        path_ = path;
+        openOption_ = options;
+
+        auto segments = std::make_shared<Segments>();
+
+        try {
+            if (!options.SharedBlockCache && options.BlockCacheSize >= options.BlockSize && !options.MemoryMapped)
+                openOption_.SharedBlockCache = std::make_shared<block_cache_type>(std::size_t(options.BlockCacheSize / options.BlockSize), options.BlockCacheShards);
+
+            segments->cache = openOption_.SharedBlockCache;
+
+            segments->devices.resize(std::size_t(indices.back()) + 1);
+            segments->gates.resize(std::size_t(indices.back()) + 1);
+
+            for (auto index : indices)
+                segments->gates[index] = std::make_shared<std::shared_mutex>();
+        }
+        catch (...) {
+            return Status::Fatal("Out of memory");
+        }
+
+        segments->active = indices.back();
+
+        for (auto index : indices) {
+            auto [status, device] = openSegment(index);
+
+            if (!status.isOk()) {
+                closeSegments(*segments);
+
+                return status;
+            }
+
+            segments->devices[index] = std::move(device);
+        }
+
+        std::atomic_store(&segments_, std::shared_ptr<const Segments>{std::move(segments)});
+
+        return Status::Ok();
+    }
+
+    /**
+     * @brief Closes all segments
+     */
+    Status close() {
+        std::unique_lock lock(segmentsLock_);
+
+        auto segments = std::atomic_load(&segments_);
+
+        if (!segments)
+            return Status::Ok();
+
+        std::atomic_store(&segments_, std::shared_ptr<const Segments>{});
+
+        openOption_.SharedBlockCache.reset(); // freed once concurrent readers are done
+
+        return closeSegments(*segments);
+    }
+
+    /**
+     * @brief Read "cnt" bytes starting from block index "n" of segment "s". Lock-free
+     * @return {Status::Ok(), data} on success
+     */
+    [[nodiscard]] std::tuple<Status, buffer_type> read(segment_index_type s, block_index_type n, bytes_count_type cnt, block_offset_type offset = 0) {
+        auto device = segment(s);
+
+        if (!device)
+            return {Status::InvalidArgument("Invalid segment"), {}};
+
+        return device->read(n, cnt, offset);
+    }
+
+    /**
+     * @brief Read "cnt" bytes starting from block index "n" of segment "s". Lock-free
+     * @return Status::Ok() on success
+     */
+    [[nodiscard]] Status read(segment_index_type s, block_index_type n, buffer_type& buffer, bytes_count_type cnt, block_offset_type offset = 0) {
+        auto device = segment(s);
+
+        if (!device)
+            return Status::InvalidArgument("Invalid segment");
+
+        return device->read(n, buffer, cnt, offset);
+    }
+
+    /**
+     * @brief Zero-copy access to "cnt" bytes starting from block index "n" of segment "s", see LogDevice::view()
+     * @return {Status::Ok(), view} on success
+     */
+    [[nodiscard]] std::tuple<Status, View> view(segment_index_type s, block_index_type n, bytes_count_type cnt, block_offset_type offset = 0) {
+        auto device = segment(s);
+
+        if (!device)
+            return {Status::InvalidArgument("Invalid segment"), {}};
+
+        return device->view(n, cnt, offset);
+    }
+
+    /**
+     * @brief Read "cnt" bytes starting from block index "n" of segment "s" without waiting for completion, see LogDevice::readAsync()
+     * @return Status::Ok() if read was submitted (callback will be invoked)
+     */
+    [[nodiscard]] Status readAsync(segment_index_type s, block_index_type n, bytes_count_type cnt, read_callback_type callback, block_offset_type offset = 0) {
+        auto device = segment(s);
+
+        if (!device)
+            return Status::InvalidArgument("Invalid segment");
+
+        return device->readAsync(n, cnt, std::move(callback), offset);
+    }
+
+    /**
+     * @brief Append data to active segment. Segments are switched only when active one is full, otherwise
+     * append is served by active segment holding only shared lock of its append gate
+     * @param buffer
+     * @param bufferSize - count of bytes from buffer to write (0 - whole buffer)
+     * @return {Status::Ok(), segment index, index of first block, count of blocks, offset within first block} on success
+     */
+    [[nodiscard]] append_result_type append(const buffer_type& buffer, bytes_count_type bufferSize = 0) {
+        if (buffer.empty())
+            return failed(Status::InvalidArgument("Unable to write empty buffer"));
+
+        const auto bytes = std::uint64_t((bufferSize == 0)? buffer.size() : std::min(bufferSize, buffer.size()));
+
+        while (true) {
+            auto segments = std::atomic_load(&segments_);
+
+            if (!segments)
+                return failed(Status::IOError("Device not opened"));
+
+            auto index = segments->active;
+            auto device = segments->devices[index];
+            std::shared_lock appending(*segments->gates[index]);
+
+            if (!active(index))
+                continue; // segment was sealed concurrently
+
+            const auto size = device->sizeInBytes();
+
+            if (size > 0 && size + bytes > openOption_.SegmentSize) { // segment size is a soft limit: concurrent appends may exceed it
+                appending.unlock();
+
+                if (auto status = roll(index); !status.isOk())
+                    return failed(status);
+
+                continue;
+            }
+
+            auto [status, blockIndex, blockCount, blockOffset] = device->append(buffer, bufferSize);
+
+            if (!status.isOk() && !device->opened())
+                continue; // device was closed concurrently
+
+            return {status, index, blockIndex, blockCount, blockOffset};
+        }
+    }
+
+    /**
+     * @brief Append several records, records sharing segment are written with one write
+     * @param buffers
+     * @param count - count of buffers
+     * @return {Status::Ok(), segment index, index of first block, count of blocks, offset within first block} per record
+     */
+    [[nodiscard]] std::vector<append_result_type> appendBatch(const buffer_type* buffers, std::size_t count) {
+        std::vector<append_result_type> results;
+
+        results.reserve(count);
+
+        for (std::size_t first = 0; first < count;) {
+            auto segments = std::atomic_load(&segments_);
+
+            if (!segments) {
+                results.resize(count, failed(Status::IOError("Device not opened")));
+
+                return results;
+            }
+
+            auto index = segments->active;
+            auto device = segments->devices[index];
+            std::shared_lock appending(*segments->gates[index]);
+
+            if (!active(index))
+                continue; // segment was sealed concurrently
+
+            auto size = device->sizeInBytes();
+            auto last = first;
+
+            for (; last < count; ++last) {
+                const auto blockSize = std::uint64_t(device->blockSize());
+                const auto bytes = openOption_.PackRecords? buffers[last].size() : (buffers[last].size() + blockSize - 1) / blockSize * blockSize;
+
+                if (size > 0 && size + bytes > openOption_.SegmentSize)
+                    break;
+
+                size += bytes;
+            }
+
+            if (last == first) { // active segment is full
+                appending.unlock();
+
+                if (auto status = roll(index); !status.isOk()) {
+                    results.resize(count, failed(status));
+
+                    return results;
+                }
+
+                continue;
+            }
+
+            auto written = device->appendBatch(buffers + first, last - first);
+
+            if (!std::get<0>(written.front()).isOk() && !device->opened())
+                continue; // device was closed concurrently
+
+            for (const auto& [status, blockIndex, blockCount, blockOffset] : written)
+                results.emplace_back(status, index, blockIndex, blockCount, blockOffset);
+
+            first = last;
+        }
+
+        return results;
+    }
+
+    /**
+     * @brief Flush all appended data to the storage device. Sealed segments are flushed when sealed
+     * @return Status::Ok() on success
+     */
+    Status sync() {
+        auto segments = std::atomic_load(&segments_);
+
+        if (!segments)
+            return Status::IOError("Device not opened");
+
+        return segments->devices[segments->active]->sync();
+    }
+
+    /**
+     * @brief Seals active segment (if it isn't empty) and starts new one
+     * @return Status::Ok() on success
+     */
+    Status roll() {
+        auto segments = std::atomic_load(&segments_);
+
+        if (!segments)
+            return Status::IOError("Device not opened");
+
+        if (segments->devices[segments->active]->sizeInBytes() == 0)
+            return Status::Ok();
+
+        return roll(segments->active);
+    }
+
+    /**
+     * @brief Closes and removes sealed segment. Readers still holding the segment get errors
+     * @param s - segment index
+     * @return Status::Ok() on success
+     */
+    Status unlinkSegment(segment_index_type s) {
+        std::unique_lock lock(segmentsLock_);
+
+        auto segments = std::atomic_load(&segments_);
+
+        if (!segments)
+            return Status::IOError("Device not opened");
+
+        if (s >= segments->devices.size() || !segments->devices[s])
+            return Status::InvalidArgument("Invalid segment");
+
+        if (s == segments->active)
+            return Status::InvalidOperation("Segment is active");
+
+        std::shared_ptr<Segments> updated;
+
+        try {
+            updated = std::make_shared<Segments>(*segments);
+        }
+        catch (...) {
+            return Status::Fatal("Out of memory");
+        }
+
+        auto device = std::move(updated->devices[s]);
+        auto gate = std::move(updated->gates[s]);
+
+        std::atomic_store(&segments_, std::shared_ptr<const Segments>{std::move(updated)});
+
+        lock.unlock();
+
+        std::unique_lock{*gate}.unlock(); // appends which found segment active are finished
+
+        SKV_UNUSED(device->close());
+
+        if (!segment_type::unlink(segmentPath(path_, s)))
+            return Status::IOError("Unable to unlink segment");
+
+        return Status::Ok();
+    }
+
+    /**
+     * @brief Removes all segments of device (and monolithic device file)
+     * @return true if all files removed
+     */
+    [[nodiscard]] static bool unlink(const os::path& path) noexcept {
+        bool removed = true;
+
+        try {
+            for (auto index : listSegments(path))
+                removed = segment_type::unlink(segmentPath(path, index)) && removed;
+        }
+        catch (...) {
+            removed = false;
+        }
+
+        boost::system::error_code ec;
+
+        if (os::fs::exists(path, ec))
+            removed = segment_type::unlink(path) && removed;
+
+        return removed;
+    }
+
+    /**
+     * @brief Path of segment file
+     * @return
+     */
+    static os::path segmentPath(const os::path& path, segment_index_type s) {
+        std::ostringstream suffix;
+        suffix << '.' << std::setw(SEGMENT_SUFFIX_DIGITS) << std::setfill('0') << std::uint64_t(s);
+
+        auto p = path;
+
+        p += suffix.str();
+
+        return p;
+    }
+
+    /**
+     * @brief Existing segments in ascending order
+     * @return
+     */
+    std::vector<SegmentInfo> segments() const {
+        std::vector<SegmentInfo> result;
+
+        auto segments = std::atomic_load(&segments_);
+
+        if (!segments)
+            return result;
+
+        for (std::size_t i = 0; i < segments->devices.size(); ++i) {
+            if (segments->devices[i])
+                result.push_back({segment_index_type(i), segments->devices[i]->sizeInBytes(), i == segments->active});
+        }
+
+        return result;
+    }
+
+    /**
+     * @brief Index of segment receiving appends
+     * @return
+     */
+    segment_index_type activeSegment() const noexcept {
+        auto segments = std::atomic_load(&segments_);
+
+        return segments? segments->active : 0;
+    }
+
+    /**
+     * @brief Position following last appended data: {active segment, its logical size}. Appends started after
+     * the call are placed at or after it
+     * @return
+     */
+    std::tuple<segment_index_type, std::uint64_t> end() const noexcept {
+        auto segments = std::atomic_load(&segments_);
+
+        if (!segments)
+            return {0, 0};
+
+        return {segments->active, segments->devices[segments->active]->sizeInBytes()};
+    }
+
+    /**
+     * @brief Logical size of all segments
+     * @return
+     */
+    std::uint64_t sizeInBytes() const noexcept {
+        return accumulate([](const auto& device) { return device.sizeInBytes(); });
+    }
+
+    /**
+     * @brief Count of blocks used by all segments
+     * @return
+     */
+    std::uint64_t sizeInBlocks() const noexcept {
+        return accumulate([](const auto& device) { return std::uint64_t(device.sizeInBlocks()); });
+    }
+
+    /**
+     * @brief Block size in bytes
+     * @return
+     */
+    std::uint32_t blockSize() const noexcept {
+        return openOption_.BlockSize;
+    }
+
+    /**
+     * @brief Counters of block cache shared by segments
+     * @return
+     */
+    cache_stats_type cacheStats() const noexcept {
+        auto segments = std::atomic_load(&segments_);
+
+        if (!segments || !segments->cache)
+            return {};
+
+        return segments->cache->stats();
+    }
+
+    /**
+     * @brief Device is opened
+     * @return
+     */
+    [[nodiscard]] bool opened() const noexcept {
+        return static_cast<bool>(std::atomic_load(&segments_));
+    }
+
+private:
+    /* Immutable snapshot of segments, replaced as a whole when segment is added or removed */
+    struct Segments {
+        std::vector<std::shared_ptr<segment_type>> devices; // indexed by segment index, empty if segment removed
+        std::vector<std::shared_ptr<std::shared_mutex>> gates; // append gates of devices
+        std::shared_ptr<block_cache_type> cache; // shared by devices, blocks are keyed by segment index
+        segment_index_type active{0};
+    };
+
+    static append_result_type failed(Status status) noexcept {
+        return {status, 0, 0, 0, 0};
+    }
+
+    /* Segment "s" still receives appends. Checked under append gate of "s", so segment isn't sealed until append is done */
+    bool active(segment_index_type s) const noexcept {
+        auto segments = std::atomic_load(&segments_);
+
+        return segments && segments->active == s;
+    }
+
+    std::shared_ptr<segment_type> segment(segment_index_type s) const noexcept {
+        auto segments = std::atomic_load(&segments_);
+
+        if (!segments || s >= segments->devices.size())
+            return {};
+
+        return segments->devices[s];
+    }
+
+    template <typename F>
+    std::uint64_t accumulate(F&& f) const noexcept {
+        std::uint64_t total = 0;
+
+        auto segments = std::atomic_load(&segments_);
+
+        if (!segments)
+            return total;
+
+        for (const auto& device : segments->devices) {
+            if (device)
+                total += f(*device);
+        }
+
+        return total;
+    }
+
+    /* Seals segment "full" and makes new segment active, unless it was already done by concurrent append.
+     * New segment is published first, then appends still writing to "full" are waited for, then "full" is synced */
+    Status roll(segment_index_type full) {
+        std::unique_lock lock(segmentsLock_);
+
+        auto segments = std::atomic_load(&segments_);
+
+        if (!segments)
+            return Status::IOError("Device not opened");
+
+        if (segments->active != full)
+            return Status::Ok();
+
+        const auto index = segment_index_type(full + 1);
+
+        if (index == 0)
+            return Status::Fatal("Out of segments");
+
+        auto [status, device] = openSegment(index);
+
+        if (!status.isOk())
+            return status;
+
+        std::shared_ptr<Segments> updated;
+
+        try {
+            updated = std::make_shared<Segments>(*segments);
+            updated->devices.push_back(std::move(device));
+            updated->gates.push_back(std::make_shared<std::shared_mutex>());
+        }
+        catch (...) {
+            return Status::Fatal("Out of memory");
+        }
+
+        updated->active = index;
+
+        std::atomic_store(&segments_, std::shared_ptr<const Segments>{std::move(updated)});
+
+        std::unique_lock{*segments->gates[full]}.unlock(); // appends which found segment active are finished
+
+        if (openOption_.DurabilityMode != Durability::None) // sealed segment is never synced again
+            return segments->devices[full]->sync();
+
+        return Status::Ok();
+    }
+
+    std::tuple<Status, std::shared_ptr<segment_type>> openSegment(segment_index_type index) {
+        std::shared_ptr<segment_type> device;
+
+        try {
+            device = std::make_shared<segment_type>();
+        }
+        catch (...) {
+            return {Status::Fatal("Out of memory"), {}};
+        }
+
+        typename segment_type::OpenOption opts = openOption_;
+        opts.CreateNewIfNotExist = true;
+        opts.BlockCacheDeviceId = std::uint64_t(index);
+
+        if (auto status = device->open(segmentPath(path_, index), opts); !status.isOk())
+            return {status, {}};
+
+        return {Status::Ok(), std::move(device)};
+    }
+
+    static Status closeSegments(const Segments& segments) {
+        auto result = Status::Ok();
+
+        for (const auto& device : segments.devices) {
+            if (!device)
+                continue;
+
+            if (auto status = device->close(); !status.isOk() && result.isOk())
+                result = status;
+        }
+
+        return result;
+    }
+
+    /* Segment files are "<path>.<digits>", end of log files of segments ("<path>.<digits>.eol") are skipped */
+    static std::vector<segment_index_type> listSegments(const os::path& path) {
+        std::vector<segment_index_type> indices;
+
+        const auto directory = path.has_parent_path()? path.parent_path() : os::path{"."};
+        const auto prefix = path.filename().string() + '.';
+        boost::system::error_code ec;
+
+        for (os::fs::directory_iterator it{directory, ec}, end; !ec && it != end; it.increment(ec)) {
+            const auto name = it->path().filename().string();
+
+            if (name.size() <= prefix.size() || name.compare(0, prefix.size(), prefix) != 0)
+                continue;
+
+            const auto digits = name.substr(prefix.size());
+
+            if (digits.size() > std::numeric_limits<segment_index_type>::digits10 ||
+                !std::all_of(std::begin(digits), std::end(digits), [](unsigned char c) { return std::isdigit(c); }))
+                continue;
+
+            indices.push_back(segment_index_type(std::stoull(digits)));
+        }
+
+        std::sort(std::begin(indices), std::end(indices));
+
+        return indices;
+    }
+
+    os::path path_;
+    OpenOption openOption_;
+    std::shared_ptr<const Segments> segments_; // accessed only via std::atomic_load/std::atomic_store
+    std::mutex segmentsLock_; // serializes changes of segments
+};
+
+}
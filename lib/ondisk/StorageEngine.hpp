@@ -1,29 +1,46 @@
 ﻿#pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <cstring>
+#include <deque>
 #include <limits>
+#include <memory>
 #include <mutex>
+#include <optional>
+#include <set>
 #include <shared_mutex>
 #include <sstream>
 #include <string>
 #include <string_view>
-#include <fstream>
+#include <future>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
-#include <boost/iostreams/stream.hpp>
-
-#include "ContainerStreamDevice.hpp"
+#include "Durability.hpp"
 #include "Record.hpp"
+#include "RecordHeader.hpp"
 #include "IndexTable.hpp"
-#include "LogDevice.hpp"
+#include "SegmentedLogDevice.hpp"
+#include "os/AsyncIO.hpp"
 #include "os/File.hpp"
 #include "vfs/IEntry.hpp"
 #include "util/Log.hpp"
 #include "util/Serialization.hpp"
 #include "util/SpinLock.hpp"
 #include "util/Status.hpp"
+#include "util/RateLimiter.hpp"
 #include "util/String.hpp"
+#include "util/ThreadPool.hpp"
 #include "util/Unused.hpp"
 
 namespace skv::ondisk {
@@ -34,7 +51,8 @@ namespace skv::ondisk {
 template <typename BlockIndexT   = std::uint32_t,
           typename BytesCountT   = std::uint32_t,
           IEntry::Handle _InvalidKey = 0,
-          IEntry::Handle _RootKey    = 1>
+          IEntry::Handle _RootKey    = 1,
+          typename IndexLayoutT  = HashIndexLayout> // DenseIndexLayout<> suits keys issued by newKey()
 class StorageEngine final {
     static constexpr auto DeviceNotOpenedStatus = skv::util::Status::IOError("Device not opened");
     static constexpr auto ExceptionThrownStatus = skv::util::Status::Fatal("Exception");
@@ -46,10 +64,11 @@ public:
 
     using block_index_type  = std::decay_t<BlockIndexT>;
     using bytes_count_type  = std::decay_t<BytesCountT>;
-    using index_table_type  = IndexTable<IEntry::Handle, block_index_type, bytes_count_type>;
+    using index_table_type  = IndexTable<IEntry::Handle, block_index_type, bytes_count_type, IndexLayoutT>;
     using index_record_type = typename index_table_type::index_record_type;
+    using segment_index_type = typename index_record_type::segment_index_type;
     using buffer_type       = std::vector<char>;
-    using log_device_type   = LogDevice<block_index_type, block_index_type, buffer_type>;
+    using log_device_type   = SegmentedLogDevice<segment_index_type, block_index_type, block_index_type, buffer_type>;
 
     static_assert (std::is_unsigned_v<block_index_type>,    "Block index type should be unsigned");
     static_assert (std::is_unsigned_v<bytes_count_type>,    "Bytes count type should be unsigned");
@@ -59,12 +78,65 @@ public:
     struct OpenOptions {
         static constexpr double         DefaultCompactionRatio{0.6}; // 60%
         static constexpr std::uint64_t  DefaultCompactionDeviceMinSize{std::uint64_t{1024 * 1024 * 1024} * 4}; // 4GB
+        static constexpr std::uint32_t  DefaultCompactionIntervalMs{1000};
+        static constexpr std::uint64_t  DefaultCompactionStepSize{64 * 1024 * 1024}; // 64MB
+        static constexpr std::uint32_t  DefaultCompactionThreads{4};
+        static constexpr std::uint32_t  DefaultCheckpointIntervalMs{30000};
         static constexpr std::uint32_t  DefaultLogDeviceBlockSize{2048};
 
+        static constexpr std::uint32_t  DefaultLogDeviceSyncEveryN{64};
+        static constexpr std::uint32_t  DefaultLogDeviceSyncEveryMs{100};
+        static constexpr std::uint32_t  DefaultLogDeviceIOQueueDepth{32};
+        static constexpr std::uint64_t  DefaultLogDeviceSegmentSize{std::uint64_t{256} * 1024 * 1024}; // 256MB
+
         double          CompactionRatio{DefaultCompactionRatio};
         std::uint64_t   CompactionDeviceMinSize{DefaultCompactionDeviceMinSize};
+        bool            CompactionOnline{true};
+        std::uint32_t   CompactionIntervalMs{DefaultCompactionIntervalMs};
+        std::uint64_t   CompactionStepSize{DefaultCompactionStepSize};
+        std::uint64_t   CompactionBytesPerSec{0};
+        std::uint32_t   CompactionIOPS{0};
+        std::uint32_t   CompactionThreads{DefaultCompactionThreads};
+        std::uint32_t   CheckpointIntervalMs{DefaultCheckpointIntervalMs}; // 0 - index table is checkpointed by close and compaction only
         std::uint32_t   LogDeviceBlockSize{DefaultLogDeviceBlockSize};
         bool            LogDeviceCreateNewIfNotExist{true};
+        bool            LogDeviceGroupCommit{false};
+        Durability      LogDeviceDurability{Durability::Flush};
+        std::uint32_t   LogDeviceSyncEveryN{DefaultLogDeviceSyncEveryN};
+        std::uint32_t   LogDeviceSyncEveryMs{DefaultLogDeviceSyncEveryMs};
+        os::AsyncIO::Engine LogDeviceIOEngine{os::AsyncIO::Engine::Blocking};
+        std::uint32_t   LogDeviceIOQueueDepth{DefaultLogDeviceIOQueueDepth};
+        bool            LogDeviceMemoryMapped{false};
+        bool            LogDeviceDirectIO{false};
+        std::uint64_t   LogDeviceBlockCacheSize{0};
+        std::uint64_t   LogDevicePreallocationSize{0};
+        bool            LogDevicePackRecords{false};
+        std::uint64_t   LogDeviceSegmentSize{DefaultLogDeviceSegmentSize};
+    };
+
+    struct SegmentUsage {
+        segment_index_type segment;
+        std::uint64_t   bytes;                      // logical size of segment
+        std::uint64_t   liveBytes;                  // occupied by records index table refers to
+        std::uint64_t   deadBytes;                  // overwritten and removed records, tombstones, padding of packed blocks
+        bool            active;
+    };
+
+    struct SpaceUsage {
+        std::uint64_t   totalBytes{0};
+        std::uint64_t   liveBytes{0};
+        std::uint64_t   deadBytes{0};
+        double          amplification{0};           // total bytes per live byte
+        std::vector<SegmentUsage> segments;
+        std::array<std::uint32_t, 10> garbageHistogram{}; // count of segments by share of dead bytes: [0%, 10%), ..., [90%, 100%]
+    };
+
+    struct CompactionProgress {
+        bool            running{false};             // job is started and isn't finished yet
+        std::uint64_t   totalBytes{0};              // live bytes of compacted segments when job started
+        std::uint64_t   movedBytes{0};
+        double          bytesPerSec{0};             // observed compaction throughput
+        std::chrono::seconds eta{0};                // estimated time left
     };
 
     StorageEngine() = default;
@@ -84,36 +156,35 @@ public:
     }
 
     [[nodiscard]] std::tuple<Status, Record> load(IEntry::Handle key) {
-        namespace io = boost::iostreams;
-
         if (key == InvalidEntryId)
             return {Status::InvalidArgument("Invalid entry id"), {}};
 
-        std::shared_lock locker(xLock_);
+        IndexReader reader{*this};
 
-        if (!opened())
+        if (!reader.entered())
             return {DeviceNotOpenedStatus, {}};
 
         auto [istatus, index] = getIndexRecord(key);
 
-        locker.unlock();
-
         if (!istatus.isOk())
             return {Status::InvalidArgument("Key doesnt exist"), {}};
 
         try {
-            auto [status, buffer] = logDevice_.read(index.blockIndex(), index.bytesCount());
+            // deserializing directly from device view: no copy if device is memory mapped
+            auto [status, view] = logDevice_.view(index.segment(), index.blockIndex(), index.bytesCount(), index.blockOffset());
 
-            if (!status.isOk())
-                return {status, {}};
+            while (!status.isOk()) { // record may be moved by online compaction and its segment unlinked
+                auto [rstatus, current] = getIndexRecord(key);
 
-            io::stream<ContainerStreamDevice<buffer_type>> stream(buffer);
-            Record e;
+                if (!rstatus.isOk() || current == index)
+                    return {status, {}};
+
+                index = current;
 
-            stream.seekg(0, BOOST_IOS::beg);
-            stream >> e;
+                std::tie(status, view) = logDevice_.view(index.segment(), index.blockIndex(), index.bytesCount(), index.blockOffset());
+            }
 
-            return {Status::Ok(), e};
+            return deserialize(key, view.data(), view.size());
         }
         catch (const std::bad_alloc&) {
             return {BadAllocThrownStatus, {}};
@@ -130,56 +201,235 @@ public:
         }
     }
 
-    [[nodiscard]] Status save(const Record& e) {
-        namespace io = boost::iostreams;
+    /**
+     * @brief Loads records of several keys. Index records are resolved under one lock, records lying next to each
+     * other on device are read by one read. Large batches are read and deserialized in parallel
+     * @return status and record of every key, in order of "keys"
+     */
+    [[nodiscard]] std::vector<std::tuple<Status, Record>> loadBatch(const std::vector<IEntry::Handle>& keys) {
+        std::vector<std::tuple<Status, Record>> results(keys.size());
+        std::vector<std::pair<index_record_type, std::size_t>> located; // index record and position of its key
 
-        if (e.handle() == InvalidEntryId)
-            return Status::InvalidArgument("Invalid entry id");
+        IndexReader reader{*this};
 
-        buffer_type buffer;
-        io::stream<ContainerStreamDevice<buffer_type>> stream(buffer);
+        try {
+            located.reserve(keys.size());
+
+            std::shared_lock<std::shared_mutex> locker(indexLock_, std::defer_lock);
+
+            if constexpr (!index_table_type::ConcurrentReads)
+                locker.lock();
+
+            std::size_t step = 0;
+
+            for (;;) { // lock-free lookups are repeated if batch was published meanwhile, so batches are seen whole
+                const auto publishes = batchPublishes_.load(std::memory_order_acquire);
+
+                if (publishes & 1) {
+                    PauseBackoff<>::backoff(++step);
+
+                    continue;
+                }
+
+                located.clear();
+
+                for (std::size_t i = 0; i < keys.size(); ++i) {
+                    index_record_type index;
+
+                    if (!reader.entered())
+                        std::get<0>(results[i]) = DeviceNotOpenedStatus;
+                    else if (keys[i] == InvalidEntryId)
+                        std::get<0>(results[i]) = Status::InvalidArgument("Invalid entry id");
+                    else if (indexTable_.lookup(keys[i], index))
+                        located.emplace_back(index, i);
+                    else
+                        std::get<0>(results[i]) = Status::InvalidArgument("Key doesnt exist");
+                }
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+
+                if (batchPublishes_.load(std::memory_order_relaxed) == publishes)
+                    break;
+            }
+        }
+        catch (...) {
+            for (auto& result : results)
+                std::get<0>(result) = BadAllocThrownStatus;
+
+            return results;
+        }
+
+        std::sort(std::begin(located), std::end(located), [](const auto& a, const auto& b) {
+            return std::make_tuple(a.first.segment(), a.first.blockIndex(), a.first.blockOffset()) <
+                   std::make_tuple(b.first.segment(), b.first.blockIndex(), b.first.blockOffset());
+        });
+
+        const auto blockSize = std::uint64_t(logDevice_.blockSize());
+        std::vector<std::pair<std::size_t, std::size_t>> runs; // ranges of "located" read at once
+
+        auto offsetOf = [blockSize](const index_record_type& index) {
+            return std::uint64_t(index.blockIndex()) * blockSize + index.blockOffset();
+        };
 
         try {
-            stream << e;
-            stream.flush();
+            std::uint64_t runEnd = 0;
 
-            if (buffer.empty())
-                return Status::Fatal("Unable to serialize entry!");
+            for (std::size_t i = 0; i < located.size(); ++i) {
+                const auto& index = located[i].first;
+                const auto start = offsetOf(index);
 
-            if (sizeof(bytes_count_type) < sizeof(std::uint64_t)) { // overflow check
-                constexpr std::uint64_t max_bytes_count = std::numeric_limits<bytes_count_type>::max();
+                if (runs.empty() || index.segment() != located[runs.back().first].first.segment() ||
+                        start > runEnd + blockSize || start + index.bytesCount() - offsetOf(located[runs.back().first].first) > LOAD_BATCH_READ_SIZE)
+                    runs.emplace_back(i, i);
 
-                if (buffer.size() > max_bytes_count)
-                    return  Status::IOError("Entry to big");
+                runs.back().second = i + 1;
+                runEnd = (runs.back().first == i)? start + index.bytesCount() : std::max(runEnd, start + index.bytesCount());
             }
         }
-        catch (const std::bad_alloc&) {
+        catch (...) {
+            for (const auto& [index, position] : located)
+                std::get<0>(results[position]) = BadAllocThrownStatus;
+
+            return results;
+        }
+
+        forEachRange(runs.size(), std::max<std::size_t>(1, runs.size() * LOAD_BATCH_RECORDS_PER_THREAD / std::max<std::size_t>(1, located.size())),
+                     [this, &keys, &located, &runs, &results, &offsetOf](std::size_t first, std::size_t last) {
+            for (auto r = first; r < last; ++r) {
+                const auto [begin, end] = runs[r];
+
+                if (end - begin == 1) { // view of device: no copy if device is memory mapped
+                    const auto& [index, position] = located[begin];
+
+                    try {
+                        auto [status, view] = logDevice_.view(index.segment(), index.blockIndex(), index.bytesCount(), index.blockOffset());
+
+                        // record may be moved by online compaction, load() finds its new place
+                        results[position] = status.isOk()? deserialize(keys[position], view.data(), view.size()) : load(keys[position]);
+                    }
+                    catch (...) {
+                        results[position] = {BadAllocThrownStatus, {}};
+                    }
+
+                    continue;
+                }
+
+                const auto& front = located[begin].first;
+                const auto start = offsetOf(front);
+                std::uint64_t span = 0;
+
+                for (auto i = begin; i < end; ++i)
+                    span = std::max(span, offsetOf(located[i].first) + located[i].first.bytesCount() - start);
+
+                buffer_type buffer;
+                auto status = Status::Ok();
+
+                try {
+                    status = logDevice_.read(front.segment(), front.blockIndex(), buffer, bytes_count_type(span), front.blockOffset());
+                }
+                catch (...) {
+                    status = BadAllocThrownStatus;
+                }
+
+                for (auto i = begin; i < end; ++i) {
+                    const auto& [index, position] = located[i];
+
+                    if (!status.isOk())
+                        results[position] = load(keys[position]);
+                    else
+                        results[position] = deserialize(keys[position], buffer.data() + (offsetOf(index) - start), index.bytesCount());
+                }
+            }
+        });
+
+        return results;
+    }
+
+    [[nodiscard]] Status save(const Record& e) {
+        if (e.handle() == InvalidEntryId)
+            return Status::InvalidArgument("Invalid entry id");
+
+        PooledBuffer pooled;
+        auto& buffer = pooled.buffer;
+
+        if (auto status = serialize(e, buffer); !status.isOk())
+            return status;
+
+        std::uint64_t sequence;
+
+        try {
+            sequence = beginSave(e.handle());
+        }
+        catch (...) {
             return BadAllocThrownStatus;
         }
-        catch (const std::exception& e) {
-            Log::e("StoreEngine", "Exception when saving entry: ", e.what());
 
-            return ExceptionThrownStatus;
+        RecordHeader::write(buffer.data(), sequence, e.handle(), RecordHeader::Flat, buffer.data() + RecordHeader::SIZE, std::uint32_t(buffer.size() - RecordHeader::SIZE));
+
+        auto status = appendRecord(e.handle(), buffer);
+
+        endSave(e.handle(), sequence);
+
+        return status;
+    }
+
+    /**
+     * @brief Saves records with one append to log device. Large batches are serialized in parallel.
+     * Index records are published at once: readers see either none or all records of batch
+     * @return Status::Ok() on success, nothing is published otherwise
+     */
+    [[nodiscard]] Status saveBatch(const std::vector<const Record*>& records) {
+        if (records.empty())
+            return Status::Ok();
+
+        for (const auto* e : records) {
+            if (!e || e->handle() == InvalidEntryId)
+                return Status::InvalidArgument("Invalid entry id");
+        }
+
+        std::vector<buffer_type> buffers;
+        std::uint64_t sequence;
+
+        try {
+            buffers.resize(records.size());
+
+            if (auto status = serializeBatch(records, buffers); !status.isOk())
+                return status;
+
+            sequence = beginSaveBatch(records);
         }
         catch (...) {
-            Log::e("StoreEngine", "save(): Unknown exception");
+            return BadAllocThrownStatus;
+        }
 
-            return ExceptionThrownStatus;
+        for (std::size_t i = 0; i < records.size(); ++i) {
+            auto& buffer = buffers[i];
+
+            RecordHeader::write(buffer.data(), sequence + i, records[i]->handle(), RecordHeader::Flat, buffer.data() + RecordHeader::SIZE, std::uint32_t(buffer.size() - RecordHeader::SIZE));
         }
 
-        std::unique_lock locker(xLock_);
+        auto status = appendRecords(records, buffers);
 
-        if (!opened())
-            return DeviceNotOpenedStatus;
+        for (std::size_t i = 0; i < records.size(); ++i)
+            endSave(records[i]->handle(), sequence + i);
 
-        [[maybe_unused]] auto [status, blockIndex, blockCount] = logDevice_.append(buffer);
+        return status;
+    }
 
-        assert(blockCount >= 1);
+    [[nodiscard]] Status saveBatch(const std::vector<Record>& records) {
+        std::vector<const Record*> ptrs;
 
-        if (!status.isOk())
-            return status;
+        try {
+            ptrs.reserve(records.size());
+
+            for (const auto& e : records)
+                ptrs.push_back(&e);
+        }
+        catch (...) {
+            return BadAllocThrownStatus;
+        }
 
-        return insertIndexRecord(index_record_type{e.handle(), blockIndex, bytes_count_type(buffer.size())});
+        return saveBatch(ptrs);
     }
 
     Status remove(const Record& e) {
@@ -187,18 +437,25 @@ public:
     }
 
     Status remove(IEntry::Handle key) {
-        std::unique_lock locker(xLock_);
+        std::unique_lock locker(xLock_); // orders tombstone with appends of the same key, readers don't take it
 
         if (!opened())
             return DeviceNotOpenedStatus;
 
-        auto it = indexTable_.find(key);
-
-        if (it == std::end(indexTable_))
+        if (std::get<0>(getIndexRecord(key)).isInvalidArgument())
             return Status::InvalidArgument("Key doesnt exist");
 
         try {
-            indexTable_.erase(it);
+            buffer_type tombstone(RecordHeader::SIZE); // log replay shouldn't resurrect removed key
+
+            RecordHeader::write(tombstone.data(), nextSequence(), key, RecordHeader::Tombstone, tombstone.data() + RecordHeader::SIZE, 0);
+
+            if (auto status = std::get<0>(logDevice_.append(tombstone)); !status.isOk())
+                return status;
+
+            std::unique_lock ilocker(indexLock_);
+
+            indexTable_.erase(key);
         }
         catch (...) {
             return ExceptionThrownStatus;
@@ -212,241 +469,1944 @@ public:
 
         openOptions_ = opts;
 
+        directory_ = directory;
+        storageName_ = storageName;
+
         logDevicePath_ = createPath(directory, storageName, LOG_DEVICE_SUFFIX);
         idxtPath_   = createPath(directory, storageName, INDEX_TABLE_SUFFIX);
+        dirtyMarkPath_ = createPath(directory, storageName, DIRTY_MARK_SUFFIX);
+        compactionJobPath_ = createPath(directory, storageName, COMPACTION_JOB_SUFFIX);
 
         if (auto status = openDevice(logDevicePath_); !status.isOk())
             return status;
-        if (auto status = openIndexTable(idxtPath_); !status.isOk())
-            return status;
 
-        if (indexTable_.empty() && logDevice_.sizeInBlocks() > 0)
-            return Status::Fatal("Broken storage");
+        auto [tstatus, complete] = openIndexTable(idxtPath_);
 
-        opened_ = true;
+        if (!tstatus.isOk())
+            return tstatus;
 
-        directory_ = directory;
-        storageName_ = storageName;
+        // after crash records appended since last checkpoint are missing in index table (or it's missing at all)
+        if (!complete || os::fs::exists(dirtyMarkPath_) || (indexTable_.empty() && logDevice_.sizeInBytes() > 0)) {
+            auto status = recoverIndexTable();
+
+            pruneFreeKeys();
+
+            if (status.isOk()) // broken chain of deltas is replaced
+                status = checkpointIndexTable(!complete);
+
+            if (!status.isOk()) {
+                SKV_UNUSED(closeDevice());
+
+                return status;
+            }
+        }
+
+        if (!os::File::open(dirtyMarkPath_, "w")) {
+            SKV_UNUSED(closeDevice());
+
+            return Status::IOError("Unable to mark storage");
+        }
+
+        try {
+            compactionLimiter_ = std::make_unique<RateLimiter<>>(openOptions_.CompactionBytesPerSec, openOptions_.CompactionIOPS);
+        }
+        catch (...) {
+            SKV_UNUSED(closeDevice());
+
+            return BadAllocThrownStatus;
+        }
+
+        loadCompactionJob();
+
+        backgroundStop_ = false;
+        opened_ = true;
 
         Status status = Status::Ok();
         [[maybe_unused]] auto [istatus, index] = getIndexRecord(RootEntryId);
 
-        if (!istatus.isOk()) {// creating root index if needed
-            locker.unlock();
+        locker.unlock();
 
+        if (!istatus.isOk()) {// creating root index if needed
             status = createRootIndex();
 
             opened_ = status.isOk();
         }
 
-        if (status.isOk())
-            return doOfflineCompaction();
+        if (status.isOk()) // one increment, the rest is done in background or by next open()
+            status = compactionStep(true);
+
+        if (status.isOk()) {
+            startCompactor();
+            startCheckpointer();
+        }
 
         return status;
     }
 
     Status close() {
+        stopBackground();
+
         std::unique_lock locker(xLock_);
 
         if (!opened())
             return Status::Ok();
 
-        auto status1 = closeDevice();
-        auto status2 = closeIndexTable();
-
         opened_ = false;
 
-        if (!status1.isOk())
-            return status1;
+        while (readers_.load() != 0) // index table outlives lookups in progress
+            std::this_thread::yield();
 
-        return status2;
-    }
+        auto status1 = checkpointIndexTable(false);
+        auto status2 = closeDevice();
 
-    bool opened() const noexcept {
-        return opened_;
-    }
+        if (status1.isOk() && status2.isOk())
+            SKV_UNUSED(os::File::unlink(dirtyMarkPath_)); // shutdown is clean, index table is up to date
 
-    IEntry::Handle newKey() noexcept {
-        std::lock_guard locker(spLock_);
+        if (!status2.isOk())
+            return status2;
 
-        return (keyCounter_++);
+        return status1;
     }
 
-    void reuseKey([[maybe_unused]] IEntry::Handle key) {
+    bool opened() const noexcept {
+        return opened_;
     }
 
-private:
-    const std::string INDEX_TABLE_SUFFIX       = ".index";
-    const std::string LOG_DEVICE_SUFFIX        = ".logd";
-    const std::string LOG_DEVICE_COMP_SUFFIX   = ".logdc";
-
-    std::tuple<Status, index_record_type> getIndexRecord(IEntry::Handle key) const {
-        auto it = indexTable_.find(key);
-
-        if (it == std::cend(indexTable_))
-            return {Status::InvalidArgument("Key doesnt exist"), {}};
-
-        return {Status::Ok(), it->second};
+    /**
+     * @brief Counters of log device block cache (hits, misses, evictions)
+     */
+    typename log_device_type::cache_stats_type blockCacheStats() const noexcept {
+        return logDevice_.cacheStats();
     }
 
-    Status insertIndexRecord(const index_record_type& index) {
-        if (indexTable_.insert(index))
-            return Status::Ok();
+    /**
+     * @brief Live and dead bytes of log, per segment and in total
+     */
+    SpaceUsage spaceUsage() const {
+        std::shared_lock locker(const_cast<std::shared_mutex&>(xLock_));
+        std::shared_lock ilocker(indexLock_);
 
-        return Status::Fatal("Unknown error");
-    }
+        SpaceUsage usage;
 
-    Status openDevice(const os::path& path) {
-        typename log_device_type::OpenOption opts;
-        opts.BlockSize = openOptions_.LogDeviceBlockSize;
-        opts.CreateNewIfNotExist = openOptions_.LogDeviceCreateNewIfNotExist;
+        if (!opened())
+            return usage;
 
-        return logDevice_.open(path, opts);
-    }
+        for (const auto& segment : logDevice_.segments()) {
+            const auto live = std::min(segment.bytes, indexTable_.segmentFootprint(segment.index));
+            const auto dead = segment.bytes - live;
 
-    Status closeDevice() {
-        return logDevice_.close();
-    }
+            usage.segments.push_back({segment.index, segment.bytes, live, dead, segment.active});
 
-    Status openIndexTable(const os::path& path) {
-		const auto& strPath = path.string();
+            usage.totalBytes += segment.bytes;
+            usage.liveBytes += live;
+            usage.deadBytes += dead;
 
-        std::fstream stream{strPath.c_str(), std::ios_base::in};
+            if (segment.bytes > 0) {
+                const auto bucket = std::size_t(double(dead) / double(segment.bytes) * usage.garbageHistogram.size());
 
-        indexTable_.setBlockSize(openOptions_.LogDeviceBlockSize);
+                ++usage.garbageHistogram[std::min(bucket, usage.garbageHistogram.size() - 1)];
+            }
+        }
 
-        if (stream.is_open()) {
-            Deserializer d{stream};
+        usage.amplification = (usage.liveBytes > 0)? double(usage.totalBytes) / double(usage.liveBytes) : 0;
 
-            d >> keyCounter_
-              >> indexTable_;
+        return usage;
+    }
 
-            stream.flush();
-            stream.close();
-        }
+    /**
+     * @brief Progress of current compaction job
+     */
+    CompactionProgress compactionProgress() const noexcept {
+        std::lock_guard locker(spLock_);
 
-        return Status::Ok();
+        return progress_;
     }
 
-    Status closeIndexTable() {
-        std::fstream stream{createPath(directory_, storageName_, INDEX_TABLE_SUFFIX), std::ios_base::out};
-
-        if (stream.is_open()) {
-            Serializer s{stream};
+    /**
+     * @brief Issues key for new record: lowest of keys handed back by reuseKey(), so handle space stays dense,
+     * or next key of counter
+     */
+    IEntry::Handle newKey() noexcept {
+        std::lock_guard locker(spLock_);
 
-            s << keyCounter_
-              << indexTable_;
+        if (!freeKeys_.empty()) {
+            const auto key = *std::begin(freeKeys_);
 
-            stream.flush();
-            stream.close();
+            freeKeys_.erase(std::begin(freeKeys_));
+            freeKeysChanged_ = true;
 
-            return Status::Ok();
+            return key;
         }
 
-        return Status::IOError("Unable to save index table");
-    }
-
-    Status createRootIndex() {
-        resetKeyCounter();
-
-        Record root{newKey(), ""};
-
-        return save(root);
+        return (keyCounter_++);
     }
 
+    /**
+     * @brief Hands back key of removed (or never saved) record, so newKey() issues it again. Caller guarantees
+     * key isn't referred anymore. Key of existing record is ignored. Free keys are persisted with index table
+     */
+    void reuseKey(IEntry::Handle key) {
+        if (key == InvalidEntryId || key == RootEntryId)
+            return;
 
-    std::string createPath(const os::path& directory, std::string_view storageName, std::string_view suffix) {
-        std::stringstream stream;
-        stream << directory.string() << char(os::fs::path::separator) << storageName << suffix;
-
-        return stream.str();
-    }
+        if (std::get<0>(getIndexRecord(key)).isOk())
+            return;
 
-    void resetKeyCounter() noexcept {
         std::lock_guard locker(spLock_);
 
-        keyCounter_ = RootEntryId;
+        if (key >= keyCounter_ || pendingSaves_.count(key) > 0)
+            return;
+
+        try {
+            freeKeys_.insert(key);
+            freeKeysChanged_ = true;
+        }
+        catch (...) { // key is left unused
+        }
     }
 
-    Status doOfflineCompaction() {
-        if (logDevice_.sizeInBytes() < openOptions_.CompactionDeviceMinSize)
-            return Status::Ok();
+private:
+    const std::string INDEX_TABLE_SUFFIX       = ".index";
+    const std::string LOG_DEVICE_SUFFIX        = ".logd";
+    const std::string DIRTY_MARK_SUFFIX        = ".dirty";
+    const std::string COMPACTION_JOB_SUFFIX    = ".compaction";
+    const std::string TEMPORARY_SUFFIX         = ".tmp";
+
+    static constexpr std::uint64_t LOG_SCAN_CHUNK_SIZE = 4 * 1024 * 1024;
+    static constexpr std::size_t SAVE_BATCH_RECORDS_PER_THREAD = 256; // smaller batches are serialized by caller only
+    static constexpr std::size_t SAVE_BUFFER_POOL_LIMIT = 1024 * 1024; // larger buffers of save() aren't kept by thread
+    static constexpr std::size_t LOAD_BATCH_RECORDS_PER_THREAD = 256;
+    static constexpr std::uint64_t LOAD_BATCH_READ_SIZE = 1024 * 1024; // max bytes of records read by one read
+    static constexpr std::size_t COMPACTION_JOB_SEGMENTS = 16; // most profitable segments compacted by one job
+    static constexpr std::size_t COMPACTION_CHUNK_RECORDS = 1024; // moved records are read, appended and published by chunks
+    static constexpr std::uint64_t COMPACTION_CHUNK_SIZE = 4 * 1024 * 1024;
+    static constexpr std::uint64_t INDEX_TABLE_MAGIC = 0x31425458444E4B53; // "SKNDXTB1"
+    static constexpr std::uint64_t INDEX_DELTA_MAGIC_V1 = 0x31444958444E4B53; // "SKNDXID1", fixed-width fields
+    static constexpr std::uint64_t INDEX_DELTA_MAGIC = 0x32444958444E4B53; // "SKNDXID2", varints, see writeIndexDelta()
+    static constexpr std::size_t INDEX_TABLE_WRITE_RECORDS = 64 * 1024; // records written to index table file by one write
+    static constexpr std::uint64_t INDEX_CHECKPOINT_MAX_DELTAS = 16; // longer chain of deltas is replaced by full index table
+    static constexpr std::uint64_t FREE_KEYS_UNCHANGED = std::numeric_limits<std::uint64_t>::max(); // in place of count of free keys in delta
+
+    using position_type = std::tuple<segment_index_type, block_index_type, std::uint32_t>; // record place in log
+    using log_position_type = std::tuple<segment_index_type, std::uint64_t>; // segment and byte offset within it
+    using workers_type = util::ThreadPool<>; // idle workers sleep, callers don't wait for them to wake up
+
+    /* Header of index table file. Index records follow it as they are laid out in memory (host byte order, as the rest
+     * of on-disk data), so they're aligned in mapped file. Size of records and their fields must match.
+     * Free keys (see reuseKey()) follow records up to end of file */
+    struct IndexTableHeader {
+        std::uint64_t magic;
+        std::uint32_t recordSize;
+        std::uint8_t keySize;
+        std::uint8_t blockIndexSize;
+        std::uint8_t bytesCountSize;
+        std::uint8_t reserved;
+        std::uint64_t count;
+        std::uint64_t keyCounter;
+        std::uint64_t sequence;
+        std::uint64_t segment;      // checkpoint position
+        std::uint64_t offset;
+        std::uint64_t generation;
+    };
 
-        const auto idxtBlocksOccupied = indexTable_.blockFootprint();
-        const auto diskBlocksOccupied = logDevice_.sizeInBlocks();
+    static_assert (sizeof(IndexTableHeader) == 64, "Index table header should be 64 bytes long");
+    static_assert (std::is_trivially_copyable_v<index_record_type>, "Index records are written as they are laid out in memory");
+    static_assert (sizeof(IndexTableHeader) % alignof(index_record_type) == 0, "Index records should be aligned in index table file");
 
-        double ratio = double(idxtBlocksOccupied) / double(diskBlocksOccupied);
+    /* Save isn't published yet. Its record is appended at or after log position taken before save was started */
+    struct PendingSave {
+        std::uint64_t sequence;
+        log_position_type start;
+    };
 
-        if (ratio > openOptions_.CompactionRatio)
-            return Status::Ok();
+    /* Live records [first, last) of sorted records of compaction step */
+    struct CompactionChunk {
+        std::size_t first;
+        std::size_t last;
+        std::uint64_t bytes;
+    };
 
-        index_table_type idxtCompacted;
-        typename log_device_type::OpenOption opts;
-        auto path = createPath(directory_, storageName_, LOG_DEVICE_COMP_SUFFIX);
+    /* Compaction job is persisted, so it's resumed after restart */
+    struct CompactionJob {
+        std::vector<segment_index_type> segments;   // compacted segments, ascending
+        position_type cursor;                       // records placed before cursor are already moved
+        std::uint64_t totalBytes{0};                // live bytes of compacted segments when job started
+        std::uint64_t movedBytes{0};
+    };
 
-        SKV_UNUSED(os::File::unlink(path));
+    /* Registers index lookup made without xLock_, close() waits for registered lookups before index table is gone */
+    class IndexReader final {
+    public:
+        explicit IndexReader(const StorageEngine& engine) noexcept:
+            engine_{engine}
+        {
+            engine_.readers_.fetch_add(1);
 
-        opts.BlockSize = openOptions_.LogDeviceBlockSize;
-        opts.CreateNewIfNotExist = true;
+            entered_ = engine_.opened();
+        }
 
-        log_device_type device;
+        ~IndexReader() noexcept {
+            engine_.readers_.fetch_sub(1);
+        }
 
-        if (!device.open(path, opts).isOk())
-            return Status::IOError("Unable to open device");
+        IndexReader(const IndexReader&) = delete;
+        IndexReader& operator=(const IndexReader&) = delete;
 
-        Status compStatus = Status::Ok();
-        buffer_type buffer;
+        [[nodiscard]] bool entered() const noexcept {
+            return entered_;
+        }
 
-        for (const auto& p : indexTable_) {
-            auto [key, index] = p;
-            auto status = logDevice_.read(index.blockIndex(), buffer, index.bytesCount());
+    private:
+        const StorageEngine& engine_;
+        bool entered_;
+    };
 
-            if (!status.isOk()) {
-                compStatus = status;
+    /* Marks publishing of batch, so lock-free lookups of several keys see either none or all index records of batch */
+    class BatchPublish final {
+    public:
+        explicit BatchPublish(std::atomic<std::uint64_t>& publishes) noexcept:
+            publishes_{publishes}
+        {
+            publishes_.store(publishes_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
 
-                break;
-            }
+        ~BatchPublish() noexcept {
+            publishes_.store(publishes_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
 
-            [[maybe_unused]] auto [appendStatus, blockIndex, blockCount] = device.append(buffer, index.bytesCount());
+        BatchPublish(const BatchPublish&) = delete;
+        BatchPublish& operator=(const BatchPublish&) = delete;
 
-            assert(blockCount >= 1);
+    private:
+        std::atomic<std::uint64_t>& publishes_;
+    };
 
-            if (!appendStatus.isOk()) {
-                compStatus = status;
+    /* Record found by log replay */
+    struct ReplayedRecord {
+        std::uint64_t sequence;
+        bool tombstone;
+        index_record_type index;
+    };
 
-                break;
-            }
+    /* Buffer of save() is taken from thread's pool and returned back, so its capacity is reused by next save */
+    struct PooledBuffer {
+        PooledBuffer() noexcept:
+            buffer{std::move(pool())}
+        {}
 
-            [[maybe_unused]] auto inserted = idxtCompacted.insert(index_record_type{key, blockIndex, bytes_count_type(buffer.size())});
+        ~PooledBuffer() noexcept {
+            if (buffer.capacity() <= SAVE_BUFFER_POOL_LIMIT)
+                pool() = std::move(buffer);
         }
 
-        if (!compStatus.isOk()) {
-            device.close();
+        PooledBuffer(const PooledBuffer&) = delete;
+        PooledBuffer& operator=(const PooledBuffer&) = delete;
 
-            SKV_UNUSED(os::File::unlink(path));
+        static buffer_type& pool() noexcept {
+            thread_local buffer_type pooled;
 
-            return Status::IOError("Unable to compact device");
+            return pooled;
         }
 
-        logDevice_.close();
-        device.close();
+        buffer_type buffer;
+    };
 
-        if (!os::File::unlink(logDevicePath_)) {
-            SKV_UNUSED(os::File::unlink(path));
+    /* Serializes record in flat format after placeholder of its header, buffer is allocated once */
+    Status serialize(const Record& e, buffer_type& buffer) const {
+        try {
+            buffer.clear();
+            buffer.reserve(RecordHeader::SIZE + serializedSize(e));
+            buffer.resize(RecordHeader::SIZE); // placeholder, header is written when payload is known
 
-            return openDevice(logDevicePath_);
-        }
+            e.writeFlat(buffer);
 
-        if (!os::File::rename(path, logDevicePath_))
-            return Status::Fatal("Unable to rename device");
+            if (buffer.size() <= RecordHeader::SIZE)
+                return Status::Fatal("Unable to serialize entry!");
 
-        if (auto status = openDevice(logDevicePath_); status.isOk()) {
-            indexTable_ = std::move(idxtCompacted);
+            if (sizeof(bytes_count_type) < sizeof(std::uint64_t)) { // overflow check
+                constexpr std::uint64_t max_bytes_count = std::numeric_limits<bytes_count_type>::max();
 
-            return status;
+                if (buffer.size() > max_bytes_count)
+                    return  Status::IOError("Entry to big");
+            }
+        }
+        catch (const std::bad_alloc&) {
+            return BadAllocThrownStatus;
+        }
+        catch (const std::exception& e) {
+            Log::e("StoreEngine", "Exception when saving entry: ", e.what());
+
+            return ExceptionThrownStatus;
+        }
+        catch (...) {
+            Log::e("StoreEngine", "save(): Unknown exception");
+
+            return ExceptionThrownStatus;
+        }
+
+        return Status::Ok();
+    }
+
+    Status serializeBatch(const std::vector<const Record*>& records, std::vector<buffer_type>& buffers) {
+        std::mutex lock;
+        auto result = Status::Ok();
+
+        forEachRange(records.size(), SAVE_BATCH_RECORDS_PER_THREAD, [this, &records, &buffers, &lock, &result](std::size_t first, std::size_t last) {
+            for (auto i = first; i < last; ++i) {
+                if (auto status = serialize(*records[i], buffers[i]); !status.isOk()) {
+                    std::lock_guard locker(lock);
+
+                    result = status;
+
+                    return;
+                }
+            }
+        });
+
+        return result;
+    }
+
+    /* Splits [0, count) into contiguous ranges processed by f(first, last) on workers pool, at least "perThread"
+     * items per thread. Caller thread processes first range and ranges no worker took yet, so sleeping workers
+     * don't delay it and small counts don't use the pool at all. "f" shouldn't throw */
+    template <typename F>
+    void forEachRange(std::size_t count, std::size_t perThread, F&& f) {
+        const auto tasks = std::min<std::size_t>(count / std::max<std::size_t>(perThread, 1), std::thread::hardware_concurrency());
+
+        if (tasks <= 1) {
+            f(std::size_t{0}, count);
+
+            return;
+        }
+
+        std::vector<std::future<void>> futures;
+
+        auto range = [&f, count, tasks](std::size_t task) {
+            f(count * task / tasks, count * (task + 1) / tasks);
+        };
+
+        auto wait = [this, &futures] {
+            for (auto& future : futures) {
+                while (future.wait_for(std::chrono::seconds{0}) != std::future_status::ready)
+                    workers_->throttle(); // runs queued range (maybe of concurrent caller) or yields
+            }
+        };
+
+        try {
+            std::call_once(workersCreated_, [this] {
+                workers_ = std::make_unique<workers_type>(std::max<std::size_t>(std::thread::hardware_concurrency(), 2) - 1);
+            });
+
+            for (std::size_t task = 1; task < tasks; ++task)
+                futures.push_back(workers_->schedule(range, task));
+
+            range(0);
+
+            wait();
+        }
+        catch (...) { // unable to start threads, ranges which weren't scheduled are processed by caller
+            if (!futures.empty())
+                wait();
+
+            range(0);
+
+            for (auto task = futures.size() + 1; task < tasks; ++task)
+                range(task);
+        }
+    }
+
+    /* Appends serialized records and publishes their index records at once */
+    Status appendRecords(const std::vector<const Record*>& records, const std::vector<buffer_type>& buffers) {
+        std::shared_lock locker(xLock_);
+
+        if (!opened())
+            return DeviceNotOpenedStatus;
+
+        try {
+            const auto results = logDevice_.appendBatch(buffers.data(), buffers.size());
+
+            for (const auto& result : results) {
+                if (auto status = std::get<0>(result); !status.isOk())
+                    return status;
+            }
+
+            std::unique_lock ilocker(indexLock_);
+            BatchPublish publish{batchPublishes_};
+
+            for (std::size_t i = 0; i < records.size(); ++i) {
+                [[maybe_unused]] const auto& [status, segment, blockIndex, blockCount, blockOffset] = results[i];
+                const auto key = records[i]->handle();
+
+                assert(blockCount >= 1);
+
+                if (auto it = indexTable_.find(key); it != std::end(indexTable_) &&
+                        std::make_tuple(it->second.segment(), it->second.blockIndex(), it->second.blockOffset()) > std::make_tuple(segment, blockIndex, blockOffset))
+                    continue; // concurrent save of the same record was appended later and already published
+
+                if (auto istatus = insertIndexRecord(index_record_type{key, blockIndex, bytes_count_type(buffers[i].size()), blockOffset, segment}); !istatus.isOk())
+                    return istatus;
+            }
+        }
+        catch (const std::bad_alloc&) {
+            return BadAllocThrownStatus;
+        }
+        catch (...) {
+            return ExceptionThrownStatus;
+        }
+
+        return Status::Ok();
+    }
+
+    /* Deserializes record occupying "size" bytes at "data" */
+    std::tuple<Status, Record> deserialize(IEntry::Handle key, const char* data, std::size_t size) const {
+        try {
+            auto [hstatus, header] = RecordHeader::read(data, size);
+
+            if (hstatus.isCorruption()) {
+                Log::e("StoreEngine", "load(): Checksum mismatch, entry: ", key);
+
+                return {hstatus, {}};
+            }
+
+            // records written before headers were introduced are payload only
+            const auto skip = hstatus.isOk()? header.size() : 0;
+
+            if (hstatus.isOk() && (header.flags() & RecordHeader::Flat) != 0) {
+                auto result = Record::readFlat(data + skip, size - skip);
+
+                if (!std::get<0>(result).isOk())
+                    Log::e("StoreEngine", "load(): Malformed entry: ", key);
+
+                return result;
+            }
+
+            BufferReader reader{data + skip, size - skip};
+            Record e;
+
+            reader >> e;
+
+            if (!reader.good()) {
+                Log::e("StoreEngine", "load(): Malformed entry: ", key);
+
+                return {Status::Corruption("Malformed entry"), {}};
+            }
+
+            return {Status::Ok(), std::move(e)};
+        }
+        catch (const std::bad_alloc&) {
+            return {BadAllocThrownStatus, {}};
+        }
+        catch (const std::exception& e) {
+            Log::e("StoreEngine", "load(): Exception when loading entry: ", e.what());
+
+            return {ExceptionThrownStatus, {}};
+        }
+        catch (...) {
+            Log::e("StoreEngine", "load(): Unknown exception");
+
+            return {ExceptionThrownStatus, {}};
+        }
+    }
+
+    /* Appends serialized record and publishes its index record */
+    Status appendRecord(IEntry::Handle key, const buffer_type& buffer) {
+        std::shared_lock locker(xLock_); // appends don't block each other, so log device is able to group them
+
+        if (!opened())
+            return DeviceNotOpenedStatus;
+
+        [[maybe_unused]] auto [status, segment, blockIndex, blockCount, blockOffset] = logDevice_.append(buffer);
+
+        if (!status.isOk())
+            return status;
+
+        assert(blockCount >= 1);
+
+        std::unique_lock ilocker(indexLock_); // readers are blocked by index update only, not by append
+
+        if (auto it = indexTable_.find(key); it != std::end(indexTable_) &&
+                std::make_tuple(it->second.segment(), it->second.blockIndex(), it->second.blockOffset()) > std::make_tuple(segment, blockIndex, blockOffset))
+            return Status::Ok(); // concurrent save of the same record was appended later and already published
+
+        return insertIndexRecord(index_record_type{key, blockIndex, bytes_count_type(buffer.size()), blockOffset, segment});
+    }
+
+    std::tuple<Status, index_record_type> getIndexRecord(IEntry::Handle key) const {
+        std::shared_lock<std::shared_mutex> locker(indexLock_, std::defer_lock);
+        index_record_type index;
+
+        if constexpr (!index_table_type::ConcurrentReads)
+            locker.lock();
+
+        if (!indexTable_.lookup(key, index))
+            return {Status::InvalidArgument("Key doesnt exist"), {}};
+
+        return {Status::Ok(), index};
+    }
+
+    Status insertIndexRecord(const index_record_type& index) {
+        if (indexTable_.insert(index))
+            return Status::Ok();
+
+        return Status::Fatal("Unknown error");
+    }
+
+    Status openDevice(const os::path& path) {
+        typename log_device_type::OpenOption opts;
+        opts.BlockSize = openOptions_.LogDeviceBlockSize;
+        opts.CreateNewIfNotExist = openOptions_.LogDeviceCreateNewIfNotExist;
+        opts.GroupCommit = openOptions_.LogDeviceGroupCommit;
+        opts.DurabilityMode = openOptions_.LogDeviceDurability;
+        opts.SyncEveryN = openOptions_.LogDeviceSyncEveryN;
+        opts.SyncEveryMs = openOptions_.LogDeviceSyncEveryMs;
+        opts.Engine = openOptions_.LogDeviceIOEngine;
+        opts.IOQueueDepth = openOptions_.LogDeviceIOQueueDepth;
+        opts.MemoryMapped = openOptions_.LogDeviceMemoryMapped;
+        opts.DirectIO = openOptions_.LogDeviceDirectIO;
+        opts.BlockCacheSize = openOptions_.LogDeviceBlockCacheSize;
+        opts.PreallocationSize = openOptions_.LogDevicePreallocationSize;
+        opts.PackRecords = openOptions_.LogDevicePackRecords;
+        opts.SegmentSize = openOptions_.LogDeviceSegmentSize;
+
+        return logDevice_.open(path, opts);
+    }
+
+    Status closeDevice() {
+        return logDevice_.close();
+    }
+
+    /* Checkpoint of index table is full table followed by chain of deltas, keys changed since previous checkpoint.
+     * Delta of other generation is left by crash while chain was replaced by full table, it's removed.
+     * Returns false if full table or chain is broken: index table reflects some checkpoint (or none), but not the last one */
+    std::tuple<Status, bool> openIndexTable(const os::path& path) {
+        indexTable_ = index_table_type{};
+        indexTable_.setBlockSize(openOptions_.LogDeviceBlockSize);
+        indexTable_.setPacked(openOptions_.LogDevicePackRecords);
+        sequence_ = 0;
+        checkpointPosition_ = {0, 0};
+        generation_ = 0;
+        deltas_ = 0;
+        deltaRecords_ = 0;
+        freeKeys_.clear();
+        freeKeysChanged_ = false;
+
+        bool complete = true;
+
+        if (auto handle = os::File::open(path, "rb"); handle) {
+            std::uint64_t magic{0};
+
+            if (os::File::read(&magic, sizeof(magic), 1, handle) == 1 && magic == INDEX_TABLE_MAGIC)
+                complete = mapIndexTable(handle);
+            else {
+                handle.reset();
+
+                complete = readIndexTable(path);
+            }
+        }
+
+        complete = loadIndexDeltas() && complete; // deltas of broken table are of other generation and are removed
+
+        indexTable_.trackChanges(true);
+
+        return {Status::Ok(), complete};
+    }
+
+    /* Index table file is header followed by index records as they are laid out in memory, so records are loaded
+     * from mapped file without parsing */
+    bool mapIndexTable(const os::File::Handle& handle) {
+        IndexTableHeader header;
+
+        const auto size = os::File::seek(handle, 0, os::File::Seek::End)? os::File::tell(handle) : -1;
+        const auto data = (size >= std::int64_t(sizeof(header)))? os::File::map(handle, std::uint64_t(size)) : os::File::Mapping{};
+
+        if (data)
+            std::memcpy(&header, data.get(), sizeof(header));
+
+        if (!data || header.recordSize != sizeof(index_record_type) || header.keySize != sizeof(IEntry::Handle) ||
+            header.blockIndexSize != sizeof(block_index_type) || header.bytesCountSize != sizeof(bytes_count_type) ||
+            header.count > std::uint64_t(size) / sizeof(index_record_type) ||
+            std::uint64_t(size) < sizeof(header) + header.count * sizeof(index_record_type) ||
+            (std::uint64_t(size) - sizeof(header) - header.count * sizeof(index_record_type)) % sizeof(IEntry::Handle) != 0) {
+            Log::e("StoreEngine", "Broken index table: ", idxtPath_);
+
+            return false;
+        }
+
+        const auto records = data.get() + sizeof(header);
+        const auto keys = records + header.count * sizeof(index_record_type);
+
+        indexTable_.load(reinterpret_cast<const index_record_type*>(records), std::size_t(header.count));
+
+        for (auto p = keys; p < data.get() + size; p += sizeof(IEntry::Handle)) {
+            IEntry::Handle key;
+
+            std::memcpy(&key, p, sizeof(key));
+
+            freeKeys_.insert(std::end(freeKeys_), key);
+        }
+
+        keyCounter_ = header.keyCounter;
+        sequence_ = header.sequence;
+        checkpointPosition_ = {segment_index_type(header.segment), header.offset};
+        generation_ = header.generation;
+
+        return true;
+    }
+
+    /* Index table saved by Serializer, before binary index table files */
+    bool readIndexTable(const os::path& path) {
+        buffer_type buffer;
+
+        if (!readFile(path.string(), buffer))
+            return true;
+
+        BufferReader d{buffer};
+
+        d >> keyCounter_
+          >> indexTable_;
+
+        if (!d.eof()) // absent in index tables saved before record headers
+            d >> sequence_;
+
+        if (!d.eof()) { // absent in index tables saved before checkpoints
+            std::uint64_t segment{0};
+            std::uint64_t offset{0};
+
+            d >> segment
+              >> offset
+              >> generation_;
+
+            checkpointPosition_ = {segment_index_type(segment), offset};
+        }
+
+        if (!d.good()) {
+            Log::e("StoreEngine", "Broken index table: ", idxtPath_);
+
+            return false;
+        }
+
+        return true;
+    }
+
+    /* Reads whole file, returns false if file can't be opened or read */
+    static bool readFile(const std::string& path, buffer_type& buffer) {
+        auto handle = os::File::open(path, "rb");
+
+        if (!handle)
+            return false;
+
+        const auto size = os::File::seek(handle, 0, os::File::Seek::End)? os::File::tell(handle) : -1;
+
+        if (size < 0 || !os::File::seek(handle, 0, os::File::Seek::Set))
+            return false;
+
+        buffer.resize(std::size_t(size));
+
+        return size == 0 || os::File::read(buffer.data(), std::size_t(size), 1, handle) == 1;
+    }
+
+    bool loadIndexDeltas() {
+        buffer_type buffer;
+
+        for (std::uint64_t n = 1;; ++n) {
+            if (!readFile(deltaPath(n), buffer))
+                return true;
+
+            BufferReader d{buffer};
+            std::uint64_t magic{0};
+            std::uint64_t generation{0};
+            std::uint64_t number{0};
+
+            d >> magic;
+
+            const bool compact = magic == INDEX_DELTA_MAGIC;
+            auto readNumber = [&d, compact]() {
+                std::uint64_t x{0};
+
+                if (compact)
+                    x = d.readVarint();
+                else
+                    d >> x;
+
+                return x;
+            };
+            auto readKeys = [&d, &readNumber, compact](std::uint64_t count, std::vector<IEntry::Handle>& keys) {
+                std::uint64_t key{0};
+
+                for (std::uint64_t i = 0; i < count && d.good(); ++i) {
+                    key = compact? key + d.readVarint() : readNumber();
+                    keys.push_back(IEntry::Handle(key));
+                }
+            };
+
+            generation = readNumber();
+            number = readNumber();
+
+            if (d.good() && (compact || magic == INDEX_DELTA_MAGIC_V1) && (generation != generation_ || number != n)) {
+                removeIndexDeltas(n);
+
+                return true;
+            }
+
+            IEntry::Handle keyCounter{0};
+            std::uint64_t sequence{0};
+            std::uint64_t segment{0};
+            std::uint64_t offset{0};
+            std::uint64_t count{0};
+            std::vector<index_record_type> records;
+            std::vector<IEntry::Handle> erased;
+
+            keyCounter = IEntry::Handle(readNumber());
+            sequence = readNumber();
+            segment = readNumber();
+            offset = readNumber();
+            count = readNumber();
+
+            for (std::uint64_t i = 0, key = 0; i < count && d.good(); ++i) {
+                index_record_type index;
+
+                if (compact) {
+                    key += d.readVarint();
+
+                    const auto blockIndex = d.readVarint();
+                    const auto bytesCount = d.readVarint();
+                    const auto blockOffset = d.readVarint();
+                    const auto segmentIndex = d.readVarint();
+
+                    index = index_record_type{IEntry::Handle(key),
+                                              decltype(index.blockIndex())(blockIndex),
+                                              decltype(index.bytesCount())(bytesCount),
+                                              decltype(index.blockOffset())(blockOffset),
+                                              decltype(index.segment())(segmentIndex)};
+                }
+                else
+                    d >> index;
+
+                records.push_back(index);
+            }
+
+            readKeys(readNumber(), erased);
+
+            std::optional<std::vector<IEntry::Handle>> freeKeys;
+
+            count = readNumber();
+
+            if (count != FREE_KEYS_UNCHANGED) {
+                freeKeys.emplace();
+
+                readKeys(count, *freeKeys);
+            }
+
+            const auto expected = magic;
+
+            d >> magic; // trailing mark
+
+            if (!d.good() || magic != expected || (!compact && magic != INDEX_DELTA_MAGIC_V1)) {
+                Log::e("StoreEngine", "Broken index table checkpoint: ", deltaPath(n));
+
+                return false;
+            }
+
+            for (const auto& index : records)
+                SKV_UNUSED(insertIndexRecord(index));
+
+            for (auto key : erased)
+                indexTable_.erase(key);
+
+            if (freeKeys)
+                freeKeys_ = std::set<IEntry::Handle>(std::begin(*freeKeys), std::end(*freeKeys));
+
+            keyCounter_ = keyCounter;
+            sequence_ = sequence;
+            checkpointPosition_ = {segment_index_type(segment), offset};
+            deltas_ = n;
+            deltaRecords_ += records.size() + erased.size();
+        }
+    }
+
+    /* Persists index table as checkpoint: it reflects all records appended before checkpoint position, except ones
+     * with sequence number above checkpoint one, so recovery replays the rest of log only. Keys changed since
+     * previous checkpoint are written as delta, long chain of deltas is replaced by full index table.
+     * Checkpoint is written to temporary file renamed then, so crash never leaves it half-written.
+     * Caller holds xLock_ (removals and moves of records are appended and published under exclusive one) */
+    Status checkpointIndexTable(bool full) {
+        std::lock_guard clocker(checkpointLock_);
+        std::shared_lock ilocker(indexLock_);
+
+        const auto [keyCounter, sequence, position] = checkpoint();
+
+        const auto changed = indexTable_.changesCount();
+        const bool fullTable = full || generation_ == 0 || deltas_ >= INDEX_CHECKPOINT_MAX_DELTAS || (deltaRecords_ + changed) * 2 > indexTable_.size();
+        std::optional<std::vector<IEntry::Handle>> freeKeys;
+
+        try {
+            freeKeys = takeFreeKeys(fullTable); // key saved since free keys were taken is in index table already
+        }
+        catch (...) {
+            return BadAllocThrownStatus;
+        }
+
+        if (fullTable) { // records are copied under lock, so publishes don't wait for sync and write of whole table
+            std::vector<index_record_type> records;
+            typename index_table_type::changes_type changes;
+
+            try {
+                records.reserve(indexTable_.size());
+
+                for (const auto& [key, index] : indexTable_)
+                    records.push_back(index);
+
+                changes = indexTable_.takeChanges();
+            }
+            catch (...) {
+                restoreFreeKeys();
+
+                return BadAllocThrownStatus;
+            }
+
+            ilocker.unlock();
+
+            auto status = logDevice_.sync(); // records index table refers to are durable first
+
+            if (status.isOk())
+                status = writeIndexTable(keyCounter, sequence, position, records, *freeKeys);
+
+            if (!status.isOk()) { // changes are written by next checkpoint
+                std::unique_lock wlocker(indexLock_);
+
+                indexTable_.restoreChanges(changes);
+                restoreFreeKeys();
+
+                return status;
+            }
+
+            for (auto n = deltas_; n > 0; --n) // chain of deltas is removed from its end, so its rest is still a chain
+                SKV_UNUSED(os::File::unlink(deltaPath(n)));
+
+            ++generation_;
+            deltas_ = 0;
+            deltaRecords_ = 0;
+
+            return Status::Ok();
+        }
+
+        if (changed == 0 && !freeKeys) // previous checkpoint is still valid, log since it is longer to replay only
+            return Status::Ok();
+
+        auto changes = indexTable_.takeChanges();
+        std::vector<index_record_type> records;
+        std::vector<IEntry::Handle> erased;
+        auto status = Status::Ok();
+
+        try {
+            for (auto key : changes) {
+                index_record_type index;
+
+                if (indexTable_.lookup(key, index))
+                    records.push_back(index);
+                else
+                    erased.push_back(key);
+            }
+        }
+        catch (...) {
+            status = BadAllocThrownStatus;
+        }
+
+        ilocker.unlock();
+
+        // keys are delta-encoded in ascending order
+        std::sort(std::begin(records), std::end(records), [](const auto& a, const auto& b) { return a.key() < b.key(); });
+        std::sort(std::begin(erased), std::end(erased));
+
+        if (status.isOk())
+            status = logDevice_.sync();
+
+        if (status.isOk())
+            status = writeIndexDelta(deltas_ + 1, keyCounter, sequence, position, records, erased, freeKeys);
+
+        if (!status.isOk()) { // changes are written by next checkpoint
+            std::unique_lock wlocker(indexLock_);
+
+            indexTable_.restoreChanges(changes);
+            restoreFreeKeys();
+
+            return status;
+        }
+
+        ++deltas_;
+        deltaRecords_ += changes.size();
+
+        return Status::Ok();
+    }
+
+    /* Free keys if they were changed since previous checkpoint (or "all" is set) */
+    std::optional<std::vector<IEntry::Handle>> takeFreeKeys(bool all) {
+        std::lock_guard locker(spLock_);
+
+        if (!all && !freeKeysChanged_)
+            return std::nullopt;
+
+        std::vector<IEntry::Handle> keys(std::begin(freeKeys_), std::end(freeKeys_));
+
+        freeKeysChanged_ = false;
+
+        return keys;
+    }
+
+    void restoreFreeKeys() noexcept {
+        std::lock_guard locker(spLock_);
+
+        freeKeysChanged_ = true;
+    }
+
+    /* Free key issued and saved after checkpoint is live again after log replay */
+    void pruneFreeKeys() noexcept {
+        std::lock_guard locker(spLock_);
+
+        for (auto it = std::begin(freeKeys_); it != std::end(freeKeys_);) {
+            index_record_type index;
+
+            if (*it < keyCounter_ && !indexTable_.lookup(*it, index)) {
+                ++it;
+
+                continue;
+            }
+
+            it = freeKeys_.erase(it);
+            freeKeysChanged_ = true;
+        }
+    }
+
+    Status writeIndexTable(IEntry::Handle keyCounter, std::uint64_t sequence, const log_position_type& position,
+                           const std::vector<index_record_type>& records, const std::vector<IEntry::Handle>& freeKeys) {
+        const auto path = idxtPath_ + TEMPORARY_SUFFIX;
+
+        try {
+            auto handle = os::File::open(path, "wb");
+
+            if (!handle)
+                return Status::IOError("Unable to save index table");
+
+            const IndexTableHeader header{INDEX_TABLE_MAGIC, std::uint32_t(sizeof(index_record_type)), std::uint8_t(sizeof(IEntry::Handle)),
+                                          std::uint8_t(sizeof(block_index_type)), std::uint8_t(sizeof(bytes_count_type)), 0,
+                                          std::uint64_t(records.size()), keyCounter, sequence,
+                                          std::uint64_t(std::get<0>(position)), std::get<1>(position), generation_ + 1};
+            bool written = (os::File::write(&header, sizeof(header), 1, handle) == 1);
+
+            for (std::size_t first = 0; written && first < records.size(); first += INDEX_TABLE_WRITE_RECORDS) {
+                const auto count = std::min(records.size() - first, INDEX_TABLE_WRITE_RECORDS);
+
+                written = (os::File::write(records.data() + first, sizeof(index_record_type), count, handle) == count);
+            }
+
+            if (written && !freeKeys.empty())
+                written = (os::File::write(freeKeys.data(), sizeof(IEntry::Handle), freeKeys.size(), handle) == freeKeys.size());
+
+            os::File::flush(handle);
+
+            if (!written || std::ferror(handle.get()) != 0)
+                return Status::IOError("Unable to save index table");
+        }
+        catch (const std::bad_alloc&) {
+            return BadAllocThrownStatus;
+        }
+
+        return replaceFile(path, idxtPath_);
+    }
+
+    /* Delta is framed by magic, the rest are varints: header fields, count and records, count and erased keys,
+     * count of free keys (FREE_KEYS_UNCHANGED if they weren't changed) and free keys. Keys of every list are
+     * ascending and are stored as difference with previous key, records are stored field by field */
+    Status writeIndexDelta(std::uint64_t n, IEntry::Handle keyCounter, std::uint64_t sequence, const log_position_type& position,
+                           const std::vector<index_record_type>& records, const std::vector<IEntry::Handle>& erased,
+                           const std::optional<std::vector<IEntry::Handle>>& freeKeys) {
+        const auto path = idxtPath_ + TEMPORARY_SUFFIX;
+
+        try {
+            buffer_type buffer;
+            BufferWriter s{buffer};
+            auto writeKeys = [&s](const std::vector<IEntry::Handle>& keys) {
+                std::uint64_t previous{0};
+
+                for (auto key : keys) {
+                    s.writeVarint(std::uint64_t(key) - previous);
+                    previous = key;
+                }
+            };
+
+            buffer.reserve(2 * sizeof(std::uint64_t) + (8 + records.size() * 5 + erased.size() + (freeKeys? freeKeys->size() : 0)) * MaxVarintSize);
+
+            s << INDEX_DELTA_MAGIC;
+
+            s.writeVarint(generation_);
+            s.writeVarint(n);
+            s.writeVarint(keyCounter);
+            s.writeVarint(sequence);
+            s.writeVarint(std::get<0>(position));
+            s.writeVarint(std::get<1>(position));
+            s.writeVarint(records.size());
+
+            std::uint64_t previous{0};
+
+            for (const auto& index : records) {
+                s.writeVarint(std::uint64_t(index.key()) - previous);
+                s.writeVarint(index.blockIndex());
+                s.writeVarint(index.bytesCount());
+                s.writeVarint(index.blockOffset());
+                s.writeVarint(index.segment());
+
+                previous = index.key();
+            }
+
+            s.writeVarint(erased.size());
+
+            writeKeys(erased);
+
+            s.writeVarint(freeKeys? std::uint64_t(freeKeys->size()) : FREE_KEYS_UNCHANGED);
+
+            if (freeKeys)
+                writeKeys(*freeKeys);
+
+            s << INDEX_DELTA_MAGIC;
+
+            if (!writeFile(path, buffer))
+                return Status::IOError("Unable to save index delta");
+        }
+        catch (const std::bad_alloc&) {
+            return BadAllocThrownStatus;
+        }
+
+        return replaceFile(path, deltaPath(n));
+    }
+
+    /* Writes "buffer" to new file at "path" by one write */
+    static bool writeFile(const std::string& path, const buffer_type& buffer) {
+        auto handle = os::File::open(path, "wb");
+
+        if (!handle)
+            return false;
+
+        const bool written = buffer.empty() || os::File::write(buffer.data(), buffer.size(), 1, handle) == 1;
+
+        os::File::flush(handle);
+
+        return written && std::ferror(handle.get()) == 0;
+    }
+
+    /* Written file is made durable before it takes place of previous one, then the rename itself is, so files
+     * removed after replacement (e.g. deltas of previous chain) aren't gone while replacement isn't there */
+    Status replaceFile(const std::string& from, const std::string& to) {
+        const bool durable = openOptions_.LogDeviceDurability != Durability::None;
+
+        if (durable) {
+            auto handle = os::File::open(from, "rb");
+
+            if (!handle || !os::File::sync(handle))
+                return Status::IOError("Unable to sync checkpoint");
+        }
+
+        if (!os::File::rename(from, to))
+            return Status::IOError("Unable to rename checkpoint");
+
+        if (durable && !os::File::syncDirectory(os::path{to}.parent_path()))
+            return Status::IOError("Unable to sync checkpoint");
+
+        return Status::Ok();
+    }
+
+    void removeIndexDeltas(std::uint64_t first) {
+        for (auto n = first; os::File::unlink(deltaPath(n)); ++n)
+            ;
+    }
+
+    std::string deltaPath(std::uint64_t n) const {
+        return idxtPath_ + "." + std::to_string(n);
+    }
+
+    Status createRootIndex() {
+        resetKeyCounter();
+
+        Record root{newKey(), ""};
+
+        return save(root);
+    }
+
+
+    std::string createPath(const os::path& directory, std::string_view storageName, std::string_view suffix) {
+        std::stringstream stream;
+        stream << directory.string() << char(os::fs::path::separator) << storageName << suffix;
+
+        return stream.str();
+    }
+
+    /* Rebuilds index table by replaying log after unclean shutdown. Index table saved last (if any) is a checkpoint:
+     * it reflects all records with sequence number below the saved one, so only later records are applied to it.
+     * Such records are never placed before checkpoint position, so log is scanned from there. Segments are scanned
+     * in parallel */
+    Status recoverIndexTable() {
+        const auto checkpoint = sequence_;
+        const auto [firstSegment, firstOffset] = checkpointPosition_;
+        std::vector<typename log_device_type::SegmentInfo> segments;
+
+        for (const auto& segment : logDevice_.segments()) {
+            if (segment.index >= firstSegment)
+                segments.push_back(segment);
+        }
+
+        std::vector<std::vector<ReplayedRecord>> replayed(segments.size());
+        std::vector<Status> statuses(segments.size(), Status::Ok());
+
+        Log::i("StoreEngine", "recovering index table: ", storageName_, ", segments: ", segments.size());
+
+        try {
+            util::ThreadPool<> pool(std::min<std::size_t>(segments.size(), std::thread::hardware_concurrency()));
+            std::vector<std::future<void>> futures;
+
+            for (std::size_t i = 0; i < segments.size(); ++i)
+                futures.push_back(pool.schedule([this, &segments, &replayed, &statuses, checkpoint, i, from = (segments[i].index == firstSegment)? firstOffset : 0] {
+                    statuses[i] = replaySegment(segments[i], from, checkpoint, replayed[i]);
+                }));
+
+            for (auto& f : futures)
+                f.wait();
+        }
+        catch (const std::bad_alloc&) {
+            return BadAllocThrownStatus;
+        }
+        catch (...) {
+            return ExceptionThrownStatus;
+        }
+
+        for (const auto& status : statuses) {
+            if (!status.isOk())
+                return status;
+        }
+
+        std::unordered_map<IEntry::Handle, ReplayedRecord> latest; // latest record of every key wins
+
+        for (const auto& records : replayed) {
+            for (const auto& r : records) {
+                auto [it, inserted] = latest.try_emplace(r.index.key(), r);
+
+                if (!inserted && it->second.sequence < r.sequence)
+                    it->second = r;
+            }
+        }
+
+        for (const auto& [key, r] : latest) {
+            if (r.tombstone)
+                indexTable_.erase(key);
+            else
+                SKV_UNUSED(insertIndexRecord(r.index));
+
+            keyCounter_ = std::max(keyCounter_, key + 1);
+            sequence_ = std::max(sequence_, r.sequence + 1);
+        }
+
+        return Status::Ok();
+    }
+
+    /* Scans segment sequentially from "from" offset. Unpacked records start at block boundary, so scan resumes at
+     * next block after padding or damaged record. Packed records have no such boundaries, so scan of segment stops there */
+    Status replaySegment(const typename log_device_type::SegmentInfo& segment, std::uint64_t from, std::uint64_t checkpoint, std::vector<ReplayedRecord>& records) {
+        const auto blockSize = std::uint64_t(logDevice_.blockSize());
+        const bool packed = openOptions_.LogDevicePackRecords;
+
+        buffer_type buffer;
+        std::uint64_t windowStart = 0; // bytes of segment held by buffer
+        std::uint64_t windowSize = 0;
+        std::uint64_t position = from;
+
+        auto fetch = [&](std::uint64_t bytes) -> Status { // makes [position, position + bytes) available
+            if (position >= windowStart && position + bytes <= windowStart + windowSize)
+                return Status::Ok();
+
+            const auto count = std::min(segment.bytes - position, std::max(bytes, LOG_SCAN_CHUNK_SIZE));
+
+            if (auto status = logDevice_.read(segment.index, block_index_type(position / blockSize), buffer,
+                                              std::size_t(count), std::uint32_t(position % blockSize)); !status.isOk())
+                return status;
+
+            windowStart = position;
+            windowSize = count;
+
+            return Status::Ok();
+        };
+
+        while (position < segment.bytes) {
+            const auto available = std::min<std::uint64_t>(segment.bytes - position, RecordHeader::SIZE);
+
+            if (auto status = fetch(available); !status.isOk())
+                return status;
+
+            const auto size = RecordHeader::recordSize(buffer.data() + (position - windowStart), available);
+
+            Status status = Status::NotFound("No record header"); // padding, record without header or torn record
+            RecordHeader header;
+
+            if (size > 0 && size <= segment.bytes - position) {
+                if (auto fstatus = fetch(size); !fstatus.isOk())
+                    return fstatus;
+
+                std::tie(status, header) = RecordHeader::read(buffer.data() + (position - windowStart), size);
+            }
+
+            if (!status.isOk()) {
+                if (packed)
+                    break;
+
+                position = (position / blockSize + 1) * blockSize;
+
+                continue;
+            }
+
+            if (header.replayable() && header.sequence() >= checkpoint) {
+                records.push_back({header.sequence(), header.tombstone(),
+                                   index_record_type{header.key(), block_index_type(position / blockSize), bytes_count_type(size),
+                                                     std::uint32_t(position % blockSize), segment.index}});
+            }
+
+            position = packed? position + size : ((position + size + blockSize - 1) / blockSize) * blockSize;
+        }
+
+        return Status::Ok();
+    }
+
+    std::uint64_t nextSequence() noexcept {
+        std::lock_guard locker(spLock_);
+
+        return (sequence_++);
+    }
+
+    /* Sequence number of saved record, record is pending until its index record is published */
+    std::uint64_t beginSave(IEntry::Handle key) {
+        const log_position_type start = logDevice_.end();
+
+        std::lock_guard locker(spLock_);
+
+        pendingSaves_.emplace(key, PendingSave{sequence_, start});
+
+        return (sequence_++);
+    }
+
+    /* Sequence numbers of batch are consecutive, first one is returned */
+    std::uint64_t beginSaveBatch(const std::vector<const Record*>& records) {
+        const log_position_type start = logDevice_.end();
+
+        std::lock_guard locker(spLock_);
+
+        const auto first = sequence_;
+
+        for (std::size_t i = 0; i < records.size(); ++i) {
+            try {
+                pendingSaves_.emplace(records[i]->handle(), PendingSave{first + i, start});
+            }
+            catch (...) {
+                for (std::size_t j = 0; j < i; ++j)
+                    erasePendingSave(records[j]->handle(), first + j);
+
+                throw;
+            }
+        }
+
+        sequence_ += records.size();
+
+        return first;
+    }
+
+    void endSave(IEntry::Handle key, std::uint64_t sequence) noexcept {
+        std::lock_guard locker(spLock_);
+
+        erasePendingSave(key, sequence);
+    }
+
+    void erasePendingSave(IEntry::Handle key, std::uint64_t sequence) noexcept {
+        auto [first, last] = pendingSaves_.equal_range(key);
+
+        for (auto it = first; it != last; ++it) {
+            if (it->second.sequence == sequence) {
+                pendingSaves_.erase(it);
+
+                break;
+            }
+        }
+    }
+
+    bool savePending(IEntry::Handle key) const noexcept {
+        std::lock_guard locker(spLock_);
+
+        return pendingSaves_.count(key) > 0;
+    }
+
+    /* Key counter, sequence number and log position stored with index table: all records with lower sequence
+     * number are reflected in index table, except pending ones. Records with higher one are placed after position */
+    std::tuple<IEntry::Handle, std::uint64_t, log_position_type> checkpoint() const noexcept {
+        log_position_type position = logDevice_.end(); // saves started later are placed after it
+
+        std::lock_guard locker(spLock_);
+
+        auto sequence = sequence_;
+
+        for (const auto& p : pendingSaves_) {
+            sequence = std::min(sequence, p.second.sequence);
+            position = std::min(position, p.second.start);
+        }
+
+        return {keyCounter_, sequence, position};
+    }
+
+    void resetKeyCounter() noexcept {
+        std::lock_guard locker(spLock_);
+
+        keyCounter_ = RootEntryId;
+        freeKeys_.clear();
+    }
+
+    bool sparse(const typename log_device_type::SegmentInfo& segment) const noexcept {
+        if (segment.bytes == 0)
+            return false;
+
+        return double(indexTable_.segmentFootprint(segment.index)) / double(segment.bytes) <= openOptions_.CompactionRatio;
+    }
+
+    /* Tombstones are kept while older segment may still hold removed record, otherwise log replay resurrects it */
+    Status copyTombstones(const typename log_device_type::SegmentInfo& segment) {
+        std::vector<ReplayedRecord> records;
+
+        if (auto status = replaySegment(segment, 0, 0, records); !status.isOk())
+            return status;
+
+        buffer_type tombstone(RecordHeader::SIZE);
+
+        for (const auto& r : records) {
+            if (!r.tombstone)
+                continue;
+
+            if (std::get<0>(getIndexRecord(r.index.key())).isOk())
+                continue;
+
+            RecordHeader::write(tombstone.data(), r.sequence, r.index.key(), RecordHeader::Tombstone, tombstone.data() + RecordHeader::SIZE, 0);
+
+            if (auto status = std::get<0>(logDevice_.append(tombstone)); !status.isOk())
+                return status;
+        }
+
+        return Status::Ok();
+    }
+
+    static position_type positionOf(const index_record_type& index) noexcept {
+        return {index.segment(), index.blockIndex(), index.blockOffset()};
+    }
+
+    /* Selects sparse segments with most garbage for compaction job: segments are unlinked when job is finished,
+     * so smaller job releases space sooner. Active segment is compacted only when storage is opened, it's sealed
+     * then, so records of compacted segments never change place */
+    Status startCompactionJob(bool opening) {
+        std::vector<typename log_device_type::SegmentInfo> candidates;
+        std::vector<segment_index_type> selected;
+        std::uint64_t totalBytes = 0;
+        bool activeIsSparse = false;
+
+        {
+            std::shared_lock locker(xLock_);
+            std::shared_lock ilocker(indexLock_);
+
+            if (!opened() || logDevice_.sizeInBytes() < openOptions_.CompactionDeviceMinSize)
+                return Status::Ok();
+
+            for (const auto& segment : logDevice_.segments()) {
+                if ((!segment.active || opening) && sparse(segment))
+                    candidates.push_back(segment);
+            }
+
+            auto deadBytes = [this](const auto& segment) {
+                return segment.bytes - std::min(segment.bytes, indexTable_.segmentFootprint(segment.index));
+            };
+
+            std::sort(std::begin(candidates), std::end(candidates), [&deadBytes](const auto& a, const auto& b) {
+                return deadBytes(a) > deadBytes(b);
+            });
+
+            if (candidates.size() > COMPACTION_JOB_SEGMENTS)
+                candidates.resize(COMPACTION_JOB_SEGMENTS);
+
+            for (const auto& segment : candidates) {
+                selected.push_back(segment.index);
+                activeIsSparse = activeIsSparse || segment.active;
+                totalBytes += indexTable_.segmentFootprint(segment.index);
+            }
+        }
+
+        if (selected.empty())
+            return Status::Ok();
+
+        std::sort(std::begin(selected), std::end(selected));
+
+        if (activeIsSparse) { // live records are moved to new segment
+            if (auto status = logDevice_.roll(); !status.isOk())
+                return status;
+        }
+
+        CompactionJob job;
+        job.segments = std::move(selected);
+        job.cursor = {job.segments.front(), 0, 0};
+        job.totalBytes = totalBytes;
+
+        if (auto status = saveCompactionJob(job); !status.isOk())
+            return status;
+
+        job_ = std::move(job);
+
+        std::lock_guard locker(spLock_);
+
+        progress_.running = true;
+        progress_.totalBytes = job_->totalBytes;
+        progress_.movedBytes = 0;
+
+        return Status::Ok();
+    }
+
+    /* One increment of compaction: live records of job segments starting from cursor are moved to the end of log,
+     * up to CompactionStepSize bytes, within I/O budget. Index record is swapped only if record wasn't rewritten or
+     * removed meanwhile, otherwise copy is left as garbage. Index table and job are saved after every increment, so
+     * job resumes from cursor after restart. When job is finished, index table is saved and segments which no index
+     * record refers to are unlinked */
+    Status compactionStep(bool opening) {
+        if (!job_) {
+            if (auto status = startCompactionJob(opening); !status.isOk() || !job_)
+                return status;
+        }
+
+        auto& job = *job_;
+        const auto started = std::chrono::steady_clock::now();
+        std::vector<index_record_type> live;
+
+        {
+            std::shared_lock locker(xLock_);
+            std::shared_lock ilocker(indexLock_);
+
+            if (!opened())
+                return Status::Ok();
+
+            for (const auto& [key, index] : indexTable_) {
+                if (positionOf(index) >= job.cursor && std::binary_search(std::begin(job.segments), std::end(job.segments), index.segment()))
+                    live.push_back(index);
+            }
+        }
+
+        // sequential reads
+        std::sort(std::begin(live), std::end(live), [](const auto& a, const auto& b) {
+            return positionOf(a) < positionOf(b);
+        });
+
+        // records of step are split into chunks of single segment: chunks are read ahead by several threads
+        // and appended in order, every chunk with one write
+        std::vector<CompactionChunk> chunks;
+        std::size_t planned = 0;
+
+        for (std::uint64_t plannedBytes = 0; planned < live.size() && plannedBytes < openOptions_.CompactionStepSize;) {
+            CompactionChunk chunk{planned, planned, 0};
+
+            for (; chunk.last < live.size() && chunk.last - chunk.first < COMPACTION_CHUNK_RECORDS && chunk.bytes < COMPACTION_CHUNK_SIZE &&
+                   plannedBytes < openOptions_.CompactionStepSize && live[chunk.last].segment() == live[chunk.first].segment(); ++chunk.last) {
+                chunk.bytes += live[chunk.last].bytesCount();
+                plannedBytes += live[chunk.last].bytesCount();
+            }
+
+            planned = chunk.last;
+            chunks.push_back(chunk);
+        }
+
+        std::uint64_t stepBytes = 0;
+        std::size_t count = 0; // records moved
+        const std::size_t threads = std::max<std::uint32_t>(openOptions_.CompactionThreads, 1);
+        std::deque<std::future<std::tuple<Status, std::vector<buffer_type>>>> reads;
+        util::ThreadPool<FixedStepSleepBackoff<1024, 1>> pool(threads); // destroyed first, so reads in flight never outlive records
+        std::size_t submitted = 0;
+        bool stopped = false;
+
+        auto readAhead = [&]() {
+            for (; !stopped && submitted < chunks.size() && reads.size() < 2 * threads; ++submitted) {
+                const auto& chunk = chunks[submitted];
+
+                if (!throttle(chunk.bytes, chunk.last - chunk.first)) {
+                    stopped = true;
+
+                    break;
+                }
+
+                reads.push_back(pool.schedule([this, &live, chunk] { return readChunk(live, chunk); }));
+            }
+        };
+
+        readAhead();
+
+        for (std::size_t appended = 0; !reads.empty(); ++appended) {
+            auto [rstatus, buffers] = reads.front().get();
+
+            reads.pop_front();
+
+            if (!rstatus.isOk())
+                return Status::IOError("Unable to compact device");
+
+            const auto& chunk = chunks[appended];
+
+            if (!throttle(chunk.bytes, 1))
+                break;
+
+            const auto results = logDevice_.appendBatch(buffers.data(), buffers.size());
+            std::vector<std::pair<index_record_type, index_record_type>> moved; // {old, new}
+
+            for (std::size_t i = 0; i < results.size(); ++i) {
+                [[maybe_unused]] const auto& [status, segment, blockIndex, blockCount, blockOffset] = results[i];
+                const auto& index = live[chunk.first + i];
+
+                if (!status.isOk())
+                    return Status::IOError("Unable to compact device");
+
+                moved.emplace_back(index, index_record_type{index.key(), blockIndex, index.bytesCount(), blockOffset, segment});
+            }
+
+            publishMoved(moved);
+
+            count = chunk.last;
+            stepBytes += chunk.bytes;
+
+            readAhead();
+        }
+
+        if (count > 0) {
+            const auto& last = live[count - 1];
+
+            job.cursor = {last.segment(), last.blockIndex(), last.blockOffset() + 1};
+            job.movedBytes += stepBytes;
+        }
+
+        const bool finished = (count == live.size());
+
+        if (finished) {
+            const auto oldestKept = oldestKeptSegment(job);
+
+            for (const auto& segment : logDevice_.segments()) {
+                if (!std::binary_search(std::begin(job.segments), std::end(job.segments), segment.index) || segment.index < oldestKept)
+                    continue;
+
+                if (auto status = copyTombstones(segment); !status.isOk())
+                    return Status::IOError("Unable to compact device");
+            }
+        }
+
+        if (auto status = logDevice_.sync(); !status.isOk())
+            return status;
+
+        std::unordered_set<segment_index_type> unlinked(std::begin(job.segments), std::end(job.segments));
+
+        if (finished) { // exclusive lock waits for appends written to segments before they were sealed to publish index
+            std::unique_lock locker(xLock_);
+
+            if (!opened())
+                return Status::Ok();
+
+            std::shared_lock ilocker(indexLock_);
+
+            for (const auto& [key, index] : indexTable_) // record wasn't moved and is still live
+                unlinked.erase(index.segment());
+        }
+
+        {
+            std::shared_lock locker(xLock_);
+
+            if (!opened())
+                return Status::Ok();
+
+            if (auto status = checkpointIndexTable(false); !status.isOk())
+                return status;
+        }
+
+        updateProgress(job, stepBytes, std::chrono::steady_clock::now() - started, finished);
+
+        if (!finished)
+            return saveCompactionJob(job);
+
+        for (auto segment : unlinked) {
+            if (auto status = logDevice_.unlinkSegment(segment); !status.isOk())
+                return status;
+        }
+
+        job_.reset();
+
+        if (!os::File::unlink(compactionJobPath_))
+            return Status::IOError("Unable to remove job");
+
+        return Status::Ok();
+    }
+
+    /* Reads records of chunk. Records close to each other are read by one read together with garbage between them */
+    std::tuple<Status, std::vector<buffer_type>> readChunk(const std::vector<index_record_type>& live, const CompactionChunk& chunk) {
+        const auto blockSize = std::uint64_t(logDevice_.blockSize());
+        const auto& front = live[chunk.first];
+        const auto& back = live[chunk.last - 1];
+
+        auto offsetOf = [blockSize](const index_record_type& index) {
+            return std::uint64_t(index.blockIndex()) * blockSize + index.blockOffset();
+        };
+
+        const auto start = offsetOf(front);
+        const auto span = offsetOf(back) + back.bytesCount() - start;
+        std::vector<buffer_type> buffers;
+
+        try {
+            buffers.reserve(chunk.last - chunk.first);
+
+            if (span <= 2 * chunk.bytes) {
+                buffer_type buffer;
+
+                if (auto status = logDevice_.read(front.segment(), front.blockIndex(), buffer, bytes_count_type(span), front.blockOffset()); !status.isOk())
+                    return {status, {}};
+
+                for (auto i = chunk.first; i < chunk.last; ++i) {
+                    const auto begin = std::begin(buffer) + std::ptrdiff_t(offsetOf(live[i]) - start);
+
+                    buffers.emplace_back(begin, begin + std::ptrdiff_t(live[i].bytesCount()));
+                }
+            }
+            else {
+                for (auto i = chunk.first; i < chunk.last; ++i) {
+                    auto [status, buffer] = logDevice_.read(live[i].segment(), live[i].blockIndex(), live[i].bytesCount(), live[i].blockOffset());
+
+                    if (!status.isOk())
+                        return {status, {}};
+
+                    buffers.push_back(std::move(buffer));
+                }
+            }
+        }
+        catch (...) {
+            return {BadAllocThrownStatus, {}};
+        }
+
+        return {Status::Ok(), std::move(buffers)};
+    }
+
+    /* Oldest segment surviving compaction job */
+    segment_index_type oldestKeptSegment(const CompactionJob& job) const {
+        auto oldest = std::numeric_limits<segment_index_type>::max();
+
+        for (const auto& segment : logDevice_.segments()) {
+            if (!std::binary_search(std::begin(job.segments), std::end(job.segments), segment.index))
+                oldest = std::min(oldest, segment.index);
+        }
+
+        return oldest;
+    }
+
+    void publishMoved(const std::vector<std::pair<index_record_type, index_record_type>>& moved) {
+        if (moved.empty())
+            return;
+
+        std::unique_lock locker(xLock_);
+        std::unique_lock ilocker(indexLock_);
+
+        if (!opened())
+            return;
+
+        for (const auto& [from, to] : moved) {
+            // pending save may be appended before copy, so copy would hide it
+            if (savePending(from.key()))
+                continue;
+
+            if (auto it = indexTable_.find(from.key()); it != std::end(indexTable_) && it->second == from)
+                indexTable_.replace(it, to);
+        }
+    }
+
+    /* Waits for compaction I/O budget, false if compaction should stop */
+    bool throttle(std::uint64_t bytes, std::uint64_t ops) {
+        const auto delay = compactionLimiter_->reserve(bytes, ops);
+
+        if (delay.count() <= 0)
+            return !backgroundStop_;
+
+        std::unique_lock locker(backgroundLock_);
+
+        return !backgroundCv_.wait_for(locker, delay, [this] { return backgroundStop_.load(); });
+    }
+
+    void updateProgress(const CompactionJob& job, std::uint64_t bytes, std::chrono::steady_clock::duration elapsed, bool finished) noexcept {
+        std::lock_guard locker(spLock_);
+
+        compactionElapsed_ += elapsed;
+        compactionMoved_ += bytes;
+
+        progress_.running = !finished;
+        progress_.totalBytes = job.totalBytes;
+        progress_.movedBytes = std::min(job.movedBytes, job.totalBytes);
+
+        const auto seconds = std::chrono::duration<double>(compactionElapsed_).count();
+
+        progress_.bytesPerSec = (seconds > 0)? double(compactionMoved_) / seconds : 0;
+        progress_.eta = std::chrono::seconds{0};
+
+        if (!finished && progress_.bytesPerSec > 0)
+            progress_.eta = std::chrono::seconds{std::uint64_t(double(progress_.totalBytes - progress_.movedBytes) / progress_.bytesPerSec)};
+    }
+
+    /* Job is written to temporary file replacing previous one, so crash while saving keeps previous cursor */
+    Status saveCompactionJob(const CompactionJob& job) {
+        const auto path = compactionJobPath_ + TEMPORARY_SUFFIX;
+
+        try {
+            buffer_type buffer;
+            BufferWriter s{buffer};
+
+            s << std::uint64_t(job.segments.size());
+
+            for (auto segment : job.segments)
+                s << segment;
+
+            s << std::get<0>(job.cursor)
+              << std::get<1>(job.cursor)
+              << std::get<2>(job.cursor)
+              << job.totalBytes
+              << job.movedBytes;
+
+            if (!writeFile(path, buffer))
+                return Status::IOError("Unable to save job");
+        }
+        catch (const std::bad_alloc&) {
+            return BadAllocThrownStatus;
+        }
+
+        return replaceFile(path, compactionJobPath_);
+    }
+
+    /* Job interrupted by close or crash is resumed */
+    void loadCompactionJob() {
+        job_.reset();
+
+        buffer_type buffer;
+
+        if (!readFile(compactionJobPath_, buffer))
+            return;
+
+        BufferReader d{buffer};
+        CompactionJob job;
+        std::uint64_t count{0};
+
+        d >> count;
+
+        for (std::uint64_t i = 0; i < count && d.good(); ++i) {
+            segment_index_type segment{0};
+
+            d >> segment;
+
+            job.segments.push_back(segment);
+        }
+
+        d >> std::get<0>(job.cursor)
+          >> std::get<1>(job.cursor)
+          >> std::get<2>(job.cursor)
+          >> job.totalBytes
+          >> job.movedBytes;
+
+        if (!d.good() || job.segments.empty() || !std::is_sorted(std::begin(job.segments), std::end(job.segments))) {
+            Log::e("StoreEngine", "Broken compaction job is dropped: ", storageName_);
+
+            return;
+        }
+
+        Log::i("StoreEngine", "compaction job resumed: ", storageName_, ", moved: ", job.movedBytes, " of ", job.totalBytes, " bytes");
+
+        job_ = std::move(job);
+
+        std::lock_guard locker(spLock_);
+
+        progress_.running = true;
+        progress_.totalBytes = job_->totalBytes;
+        progress_.movedBytes = std::min(job_->movedBytes, job_->totalBytes);
+    }
+
+    void startCompactor() {
+        if (!openOptions_.CompactionOnline)
+            return;
+
+        backgroundStop_ = false;
+        compactor_ = std::thread(&StorageEngine::compactorRoutine, this);
+    }
+
+    void stopBackground() noexcept {
+        {
+            std::lock_guard locker(backgroundLock_);
+
+            backgroundStop_ = true;
+        }
+
+        backgroundCv_.notify_all();
+
+        if (compactor_.joinable())
+            compactor_.join();
+
+        if (checkpointer_.joinable())
+            checkpointer_.join();
+    }
+
+    /* Checks compaction thresholds every CompactionIntervalMs (live bytes are counted by index table, so the check
+     * is cheap). Increments of started job follow each other, their pace is limited by I/O budget only */
+    void compactorRoutine() {
+        std::unique_lock locker(backgroundLock_);
+
+        auto interval = [this] { return std::chrono::milliseconds(job_? 0 : openOptions_.CompactionIntervalMs); };
+
+        while (!backgroundCv_.wait_for(locker, interval(), [this] { return backgroundStop_.load(); })) {
+            locker.unlock();
+
+            if (job_ || logDevice_.sizeInBytes() >= openOptions_.CompactionDeviceMinSize) {
+                try {
+                    if (auto status = compactionStep(false); !status.isOk())
+                        Log::e("StoreEngine", "Online compaction failed: ", status.message());
+                }
+                catch (...) {
+                    Log::e("StoreEngine", "Online compaction: Unknown exception");
+                }
+            }
+
+            locker.lock();
+        }
+    }
+
+    void startCheckpointer() {
+        if (openOptions_.CheckpointIntervalMs == 0)
+            return;
+
+        backgroundStop_ = false;
+        checkpointer_ = std::thread(&StorageEngine::checkpointerRoutine, this);
+    }
+
+    /* Checkpoints index table every CheckpointIntervalMs, so shutdown writes and recovery replays changes of last
+     * interval only */
+    void checkpointerRoutine() {
+        std::unique_lock locker(backgroundLock_);
+
+        const auto interval = std::chrono::milliseconds(openOptions_.CheckpointIntervalMs);
+
+        while (!backgroundCv_.wait_for(locker, interval, [this] { return backgroundStop_.load(); })) {
+            locker.unlock();
+
+            try {
+                std::shared_lock xlocker(xLock_);
+
+                if (opened()) {
+                    if (auto status = checkpointIndexTable(false); !status.isOk())
+                        Log::e("StoreEngine", "Index table checkpoint failed: ", status.message());
+                }
+            }
+            catch (...) {
+                Log::e("StoreEngine", "Index table checkpoint: Unknown exception");
+            }
+
+            locker.lock();
         }
-
-        return Status::Fatal("Unable to compact device");
     }
 
     index_table_type indexTable_;
@@ -456,10 +2416,36 @@ private:
     std::string storageName_;
     os::path logDevicePath_;
     std::string idxtPath_;
+    std::string dirtyMarkPath_;
     std::shared_mutex xLock_;
-    SpinLock<> spLock_;
+    mutable SpinLock<> spLock_;
     IEntry::Handle keyCounter_{0};
-    bool opened_{false};
+    std::uint64_t sequence_{0}; // sequence number of next appended record
+    std::unordered_multimap<IEntry::Handle, PendingSave> pendingSaves_;
+    std::set<IEntry::Handle> freeKeys_; // handed back by reuseKey(), issued by newKey() lowest first
+    bool freeKeysChanged_{false}; // since previous checkpoint
+    mutable std::shared_mutex indexLock_; // index updates, and lookups unless layout allows concurrent reads
+    std::atomic<std::uint64_t> batchPublishes_{0}; // odd while batch of index records is published
+    mutable std::atomic<std::uint32_t> readers_{0}; // lookups in progress, see IndexReader
+    std::atomic<bool> opened_{false};
+    std::thread compactor_;
+    std::optional<CompactionJob> job_; // accessed by compactor thread only, or before it's started
+    std::unique_ptr<RateLimiter<>> compactionLimiter_;
+    std::string compactionJobPath_;
+    CompactionProgress progress_;
+    std::chrono::steady_clock::duration compactionElapsed_{0};
+    std::uint64_t compactionMoved_{0};
+    std::thread checkpointer_;
+    std::mutex checkpointLock_; // checkpoints are written one by one
+    log_position_type checkpointPosition_{0, 0};
+    std::uint64_t generation_{0}; // of full index table, its deltas are of the same generation
+    std::uint64_t deltas_{0};
+    std::uint64_t deltaRecords_{0};
+    std::mutex backgroundLock_;
+    std::condition_variable backgroundCv_;
+    std::atomic<bool> backgroundStop_{false};
+    std::once_flag workersCreated_;
+    std::unique_ptr<workers_type> workers_; // serve batches for the engine lifetime, see forEachRange()
 };
 
 }
@@ -95,6 +95,19 @@ Status Volume::link(IEntry &entry, const std::string& name) {
     return status.isOk()? ret : status;
 }
 
+Status Volume::link(IEntry &entry, const std::vector<std::string>& names) {
+    if (!initialized())
+        return VolumeNotOpenedStatus;
+
+    Status ret;
+    auto status = exceptionBoundary("Volume::link",
+                                    [&] {
+                                        ret = impl_->createChildren(entry, names);
+                                    });
+
+    return status.isOk()? ret : status;
+}
+
 Status Volume::unlink(IEntry& entry, const std::string& name) {
     if (!initialized())
         return VolumeNotOpenedStatus;
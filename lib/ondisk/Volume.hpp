@@ -6,7 +6,10 @@
 #include <set>
 #include <string>
 #include <tuple>
+#include <vector>
 
+#include "Durability.hpp"
+#include "os/AsyncIO.hpp"
 #include "os/File.hpp"
 #include "vfs/Property.hpp"
 #include "vfs/IVolume.hpp"
@@ -25,12 +28,40 @@ public:
     struct OpenOptions {
         static constexpr double         DefaultCompactionRatio{0.6}; // 60% of blocks used, 40% wasted
         static constexpr std::uint64_t  DefaultCompactionDeviceMinSize{std::uint64_t{1024 * 1024 * 1024} * 4}; // compaction starts only if device size exceeds this value. 4GB default
+        static constexpr std::uint32_t  DefaultCompactionIntervalMs{1000}; // how often online compaction checks thresholds
+        static constexpr std::uint64_t  DefaultCompactionStepSize{64 * 1024 * 1024}; // live bytes moved by one compaction increment
+        static constexpr std::uint32_t  DefaultCompactionThreads{4}; // threads reading records ahead of compaction appends
+        static constexpr std::uint32_t  DefaultCheckpointIntervalMs{30000}; // how often index table changes are persisted
         static constexpr std::uint32_t  DefaultLogDeviceBlockSize{2048}; // 2KB
 
+        static constexpr std::uint32_t  DefaultLogDeviceSyncEveryN{64}; // used with Durability::FsyncEveryN
+        static constexpr std::uint32_t  DefaultLogDeviceSyncEveryMs{100}; // used with Durability::FsyncEveryMs
+        static constexpr std::uint32_t  DefaultLogDeviceIOQueueDepth{32}; // max in-flight asynchronous reads/writes
+        static constexpr std::uint64_t  DefaultLogDeviceSegmentSize{std::uint64_t{256} * 1024 * 1024}; // 256MB
+
         double          CompactionRatio{DefaultCompactionRatio};
         std::uint64_t   CompactionDeviceMinSize{DefaultCompactionDeviceMinSize};
+        bool            CompactionOnline{true}; // sparse segments are compacted by background thread while volume is open
+        std::uint32_t   CompactionIntervalMs{DefaultCompactionIntervalMs};
+        std::uint64_t   CompactionStepSize{DefaultCompactionStepSize};
+        std::uint64_t   CompactionBytesPerSec{0}; // compaction I/O budget (reads and writes), 0 - unlimited
+        std::uint32_t   CompactionIOPS{0}; // 0 - unlimited
+        std::uint32_t   CompactionThreads{DefaultCompactionThreads};
+        std::uint32_t   CheckpointIntervalMs{DefaultCheckpointIntervalMs}; // 0 - on close and compaction only, recovery replays more of log
         std::uint32_t   LogDeviceBlockSize{DefaultLogDeviceBlockSize};
         bool            LogDeviceCreateNewIfNotExist{true};
+        bool            LogDeviceGroupCommit{false}; // concurrent flushes of entries are coalesced into one write
+        Durability      LogDeviceDurability{Durability::Flush};
+        std::uint32_t   LogDeviceSyncEveryN{DefaultLogDeviceSyncEveryN};
+        std::uint32_t   LogDeviceSyncEveryMs{DefaultLogDeviceSyncEveryMs};
+        os::AsyncIO::Engine LogDeviceIOEngine{os::AsyncIO::Engine::Blocking};
+        std::uint32_t   LogDeviceIOQueueDepth{DefaultLogDeviceIOQueueDepth};
+        bool            LogDeviceMemoryMapped{false}; // entries are loaded directly from memory mapped device file
+        bool            LogDeviceDirectIO{false}; // bypass OS page cache, LogDeviceBlockSize should be multiple of 4096
+        std::uint64_t   LogDeviceBlockCacheSize{0}; // bytes of user-space block cache shared by log segments, 0 - disabled
+        std::uint64_t   LogDevicePreallocationSize{0}; // device file grows by chunks of this size, 0 - disabled
+        bool            LogDevicePackRecords{false}; // records share blocks instead of being padded to block size
+        std::uint64_t   LogDeviceSegmentSize{DefaultLogDeviceSegmentSize}; // log is split into segment files of this size, compaction rewrites whole segments
     };
 
     Volume(Status &status) noexcept;
@@ -64,6 +95,14 @@ public:
      */
     [[nodiscard]] Status link(IEntry& entry, const std::string& name) override;
 
+    /**
+     * @brief Create several links at once, either all of them are created or none
+     * @param entry - entry in which links will be created
+     * @param names - names of created links
+     * @return Status::Ok() on success
+     */
+    [[nodiscard]] Status link(IEntry& entry, const std::vector<std::string>& names);
+
     /**
      * @brief Remove specified link
      * @param entry - parent entry
@@ -9,6 +9,8 @@
 #include <string>
 #include <thread>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "Entry.hpp"
 #include "Property.hpp"
@@ -34,7 +36,8 @@ struct Volume::Impl {
     using storage_type       = StorageEngine<std::uint32_t,            // block index type
                                              std::uint32_t,            // bytes count in one record (4GB now)
                                              IVolume::InvalidHandle,    // key value of invalid entry
-                                             IVolume::RootHandle>;      // key value of root entry
+                                             IVolume::RootHandle,       // key value of root entry
+                                             DenseIndexLayout<>>;       // handles are issued by counter
 
     Impl(Volume::OpenOptions opts):
         storage_{std::make_unique<storage_type>()},
@@ -56,8 +59,27 @@ struct Volume::Impl {
 
         storageOpts.CompactionRatio = opts_.CompactionRatio;
         storageOpts.CompactionDeviceMinSize = opts_.CompactionDeviceMinSize;
+        storageOpts.CompactionOnline = opts_.CompactionOnline;
+        storageOpts.CompactionIntervalMs = opts_.CompactionIntervalMs;
+        storageOpts.CompactionStepSize = opts_.CompactionStepSize;
+        storageOpts.CompactionBytesPerSec = opts_.CompactionBytesPerSec;
+        storageOpts.CompactionIOPS = opts_.CompactionIOPS;
+        storageOpts.CompactionThreads = opts_.CompactionThreads;
+        storageOpts.CheckpointIntervalMs = opts_.CheckpointIntervalMs;
         storageOpts.LogDeviceBlockSize = opts_.LogDeviceBlockSize;
         storageOpts.LogDeviceCreateNewIfNotExist = opts_.LogDeviceCreateNewIfNotExist;
+        storageOpts.LogDeviceGroupCommit = opts_.LogDeviceGroupCommit;
+        storageOpts.LogDeviceDurability = opts_.LogDeviceDurability;
+        storageOpts.LogDeviceSyncEveryN = opts_.LogDeviceSyncEveryN;
+        storageOpts.LogDeviceSyncEveryMs = opts_.LogDeviceSyncEveryMs;
+        storageOpts.LogDeviceIOEngine = opts_.LogDeviceIOEngine;
+        storageOpts.LogDeviceIOQueueDepth = opts_.LogDeviceIOQueueDepth;
+        storageOpts.LogDeviceMemoryMapped = opts_.LogDeviceMemoryMapped;
+        storageOpts.LogDeviceDirectIO = opts_.LogDeviceDirectIO;
+        storageOpts.LogDeviceBlockCacheSize = opts_.LogDeviceBlockCacheSize;
+        storageOpts.LogDevicePreallocationSize = opts_.LogDevicePreallocationSize;
+        storageOpts.LogDevicePackRecords = opts_.LogDevicePackRecords;
+        storageOpts.LogDeviceSegmentSize = opts_.LogDeviceSegmentSize;
 
         return storage_->open(directory, volumeName, storageOpts);
     }
@@ -77,16 +99,26 @@ struct Volume::Impl {
     }
 
     std::shared_ptr<IEntry> entry(const std::string& p) {
+        while (true) { // handle recycled meanwhile may lead to another entry
+            const auto epoch = recycleEpoch();
+            auto e = findEntry(p, epoch);
+
+            if (recycleEpoch() == epoch)
+                return e;
+        }
+    }
+
+    std::shared_ptr<IEntry> findEntry(const std::string& p, std::uint64_t epoch) {
         auto path = simplifyPath(p);
 
         auto [status, handle, foundPath] = searchCachedPathEntry(path);
 
         if (status.isOk() && foundPath == path)
-            return std::static_pointer_cast<vfs::IEntry>(createEntryForHandle(handle));
+            return std::static_pointer_cast<vfs::IEntry>(createEntryForHandle(handle, epoch));
 
         if (status.isNotFound()) {
             handle = Volume::RootHandle;
-            updatePathCacheEntry("/", handle);
+            updatePathCacheEntry("/", handle, epoch);
         }
         else
             path.erase(0, foundPath.size()); // removing found part from search path
@@ -96,37 +128,31 @@ struct Volume::Impl {
 
         for (const auto& t : tokens) {
             auto cb = getEntry(handle);
-            Record::Children children;
-
-            auto fetchChildren = [&children](auto&& e) {
-                children = e.children();
-            };
+            Status status;
 
             if (cb) {
-                fetchChildren(cb->record());
+                std::shared_lock locker(cb->xLock());
+
+                std::tie(status, handle) = cb->record().child(t);
             }
             else {
-                const auto& [status, handleEntry] = storage_->load(handle);
+                auto [lstatus, handleEntry] = storage_->load(handle);
 
-                if (!status.isOk())
+                if (!lstatus.isOk())
                     return {};
 
-                fetchChildren(handleEntry);
+                std::tie(status, handle) = handleEntry.child(t); // record isn't unpacked
             }
 
-            auto it = children.find(t);
-
-            if (it == std::cend(children))
+            if (!status.isOk())
                 return {};
 
-            handle = it->second;
-
             trackPath += ("/" + t);
 
-            updatePathCacheEntry(trackPath, handle);
+            updatePathCacheEntry(trackPath, handle, epoch);
         }
 
-        return std::static_pointer_cast<vfs::IEntry>(createEntryForHandle(handle));
+        return std::static_pointer_cast<vfs::IEntry>(createEntryForHandle(handle, epoch));
     }
 
     Status createChild(IEntry& e, const std::string& name) {
@@ -147,16 +173,8 @@ struct Volume::Impl {
         std::unique_lock locker(entry->xLock());
 
         auto& record = entry->record();
-        const auto& children = record.children();
-
-        auto cit = std::find_if(std::cbegin(children), std::cend(children),
-                                [&name](auto&& p) {
-                                    [[maybe_unused]] const auto& [cname, cid] = p;
 
-                                    return (cname == name);
-                                });
-
-        if (cit != std::cend(children))
+        if (std::get<0>(record.child(name)).isOk())
             return Status::InvalidArgument("Entry already exists");
 
         Record child{storage_->newKey(), name};
@@ -184,7 +202,16 @@ struct Volume::Impl {
         return Status::Ok();
     }
 
-    Status removeChild(IEntry& e, const std::string& name) {
+    /* All children are saved by one batch, none of them is created on failure */
+    Status createChildren(IEntry& e, const std::vector<std::string>& names) {
+        for (const auto& name : names) {
+            auto it = std::find(std::cbegin(name), std::cend(name),
+                                StringPathIterator::separator);
+
+            if (it != std::cend(name) || name.empty())
+                return Status::InvalidArgument("Invalid name");
+        }
+
         auto entry = getEntry(e.handle());
 
         if (!entry)
@@ -196,19 +223,60 @@ struct Volume::Impl {
         std::unique_lock locker(entry->xLock());
 
         auto& record = entry->record();
-        const auto& children = record.children();
+        std::vector<Record> children;
+
+        children.reserve(names.size());
+
+        auto rollback = [this, &record, &children] {
+            for (auto& child : children) {
+                if (child.parent() != IVolume::InvalidHandle) {
+                    [[maybe_unused]] auto r = record.removeChild(child);
+
+                    assert(r.isOk());
+                }
+
+                storage_->reuseKey(child.handle());
+            }
+        };
+
+        for (const auto& name : names) {
+            children.emplace_back(storage_->newKey(), name);
+
+            if (auto status = record.addChild(children.back()); !status.isOk()) {
+                rollback();
 
-        auto it = std::find_if(std::cbegin(children), std::cend(children),
-                               [&name](auto&& p) {
-                                    [[maybe_unused]] const auto& [cname, cid] = p;
+                return status;
+            }
+        }
 
-                                    return (cname == name);
-                               });
+        if (auto status = storage_->saveBatch(children); !status.isOk()) {
+            rollback();
 
-        if (it == std::cend(children))
+            return status;
+        }
+
+        if (!children.empty())
+            entry->setDirty(true);
+
+        return Status::Ok();
+    }
+
+    Status removeChild(IEntry& e, const std::string& name) {
+        auto entry = getEntry(e.handle());
+
+        if (!entry)
             return NoSuchEntryStatus;
 
-        auto cid = it->second;
+        if (&e != static_cast<IEntry*>(entry.get()))
+            return Status::InvalidArgument("Invalid entry");
+
+        std::unique_lock locker(entry->xLock());
+
+        auto& record = entry->record();
+        auto [cstatus, cid] = record.child(name);
+
+        if (!cstatus.isOk())
+            return NoSuchEntryStatus;
 
         if (getEntry(cid))
             return Status::InvalidOperation("Child entry opened");
@@ -219,7 +287,7 @@ struct Volume::Impl {
             if (!status.isOk())
                 return status;
 
-            if (!child.children().empty())
+            if (child.childrenCount() != 0)
                 return Status::InvalidArgument("Child entry not empty");
         }
 
@@ -231,7 +299,12 @@ struct Volume::Impl {
 
         entry->setDirty(true);
 
-        return storage_->remove(child);
+        status = storage_->remove(child);
+
+        if (status.isOk())
+            recycleHandle(record.handle(), cid);
+
+        return status;
     }
 
     std::tuple<Status, Volume::Handle, std::string> searchCachedPathEntry(const std::string& path) {
@@ -250,8 +323,12 @@ struct Volume::Impl {
         return {Status::NotFound("Cache miss"), {}, {}};
     }
 
-    void updatePathCacheEntry(const std::string& path, Volume::Handle h) {
-        pathCache_.insert(path, h);
+    /* Path resolved before handle was recycled isn't cached */
+    void updatePathCacheEntry(const std::string& path, Volume::Handle h, std::uint64_t epoch) {
+        std::shared_lock locker{openedEntriesLock_};
+
+        if (recycled_ == epoch)
+            pathCache_.insert(path, h);
     }
 
     bool invalidatePathCacheEntry(const std::string& path) {
@@ -262,7 +339,7 @@ struct Volume::Impl {
         pathCache_.clear();
     }
 
-    EntryPtr createEntryForHandle(Volume::Handle handle) {
+    EntryPtr createEntryForHandle(Volume::Handle handle, std::uint64_t epoch) {
         std::unique_lock locker{openedEntriesLock_};
 
         auto it = openedEntries_.find(handle);
@@ -277,10 +354,11 @@ struct Volume::Impl {
         if (!status.isOk())
             return {};
 
-        return createEntryForHandle(handle, std::move(entry));
+        return createEntryForHandle(handle, std::move(entry), epoch);
     }
 
-    EntryPtr createEntryForHandle(Volume::Handle handle, Record&& record) {
+    /* Record loaded before handle was recycled may be stale, such entry isn't created */
+    EntryPtr createEntryForHandle(Volume::Handle handle, Record&& record, std::uint64_t epoch) {
         std::unique_lock locker{openedEntriesLock_};
 
         auto it = openedEntries_.find(handle);
@@ -288,6 +366,9 @@ struct Volume::Impl {
         if (it != std::end(openedEntries_)) // ok, someone already opened this handle
             return it->second.lock();
 
+        if (recycled_ != epoch)
+            return {};
+
         auto ptr = std::make_unique<Entry>(std::move(record));
         auto deleter = [this](Entry *e) { releaseEntry(e); };
         auto entry = std::shared_ptr<Entry>{ptr.release(), deleter};
@@ -301,18 +382,93 @@ struct Volume::Impl {
         if (!entry)
             return;
 
+        bool removed = false;
+        std::vector<Volume::Handle> children;
+
         {
             std::unique_lock locker{openedEntriesLock_};
 
-            openedEntries_.erase(entry->record().handle());
+            const auto handle = entry->record().handle();
+
+            openedEntries_.erase(handle);
+
+            children = takeRemovedChildren(handle);
+
+            if (removedHandles_.erase(handle) > 0) { // record was removed while entry was open
+                recycle(handle);
+
+                removed = true;
+            }
         }
 
-        if (entry->dirty())
-            syncRecord(entry->record());
+        const bool saved = removed || !entry->dirty() || syncRecord(entry->record()).isOk();
+
+        if (saved && !children.empty()) {
+            std::unique_lock locker{openedEntriesLock_};
+
+            for (auto child : children)
+                recycleRemoved(child);
+        }
 
         delete entry;
     }
 
+    /* Handle of child removed from "parent" is recycled once parent record is saved without the child, otherwise
+     * parent record saved before would lead to record which reused the handle when log is replayed after crash */
+    void recycleHandle(Volume::Handle parent, Volume::Handle handle) {
+        std::unique_lock locker{openedEntriesLock_};
+
+        try {
+            removedChildren_[parent].push_back(handle);
+        }
+        catch (...) { // handle is left unused
+        }
+    }
+
+    /* Called with openedEntriesLock_ taken */
+    std::vector<Volume::Handle> takeRemovedChildren(Volume::Handle parent) noexcept {
+        auto it = removedChildren_.find(parent);
+
+        if (it == std::end(removedChildren_))
+            return {};
+
+        auto children = std::move(it->second);
+
+        removedChildren_.erase(it);
+
+        return children;
+    }
+
+    /* Handle of removed record is reused by newKey() only when no opened entry refers to it, otherwise once
+     * entry is released. Called with openedEntriesLock_ taken */
+    void recycleRemoved(Volume::Handle handle) {
+        if (openedEntries_.count(handle) > 0) {
+            try {
+                removedHandles_.insert(handle);
+            }
+            catch (...) { // handle is left unused
+            }
+
+            return;
+        }
+
+        recycle(handle);
+    }
+
+    /* Lookups started before handle is recycled are repeated, see recycleEpoch() */
+    void recycle(Volume::Handle handle) {
+        ++recycled_;
+
+        pathCache_.removeValue(handle);
+        storage_->reuseKey(handle);
+    }
+
+    std::uint64_t recycleEpoch() {
+        std::shared_lock locker{openedEntriesLock_};
+
+        return recycled_;
+    }
+
     EntryPtr getEntry(Volume::Handle handle) {
         std::shared_lock locker{openedEntriesLock_};
 
@@ -329,16 +485,35 @@ struct Volume::Impl {
     }
 
     void flushEntries() {
+        std::vector<EntryPtr> dirty; // released after lock, releaseEntry() takes it
+        std::vector<const Record*> records;
+
         std::unique_lock locker{openedEntriesLock_};
 
         for (const auto& [handle, ewptr] : openedEntries_) {
-            SKV_UNUSED(handle);
+            if (removedHandles_.count(handle) > 0)
+                continue;
 
-            if (auto e = ewptr.lock(); e && e->dirty())
-                syncRecord(e->record());
+            if (auto e = ewptr.lock(); e && e->dirty()) {
+                records.push_back(&e->record());
+                dirty.push_back(std::move(e));
+            }
         }
 
         openedEntries_.clear();
+
+        if (auto status = storage_->saveBatch(records); !status.isOk()) {
+            Log::e("Volume", "Unable to flush entries: ", status.message());
+
+            return;
+        }
+
+        for (auto& e : dirty) {
+            e->setDirty(false);
+
+            for (auto child : takeRemovedChildren(e->record().handle()))
+                recycleRemoved(child);
+        }
     }
 
     Status claim(Volume::Token token) noexcept {
@@ -386,6 +561,9 @@ struct Volume::Impl {
     Volume::OpenOptions opts_;
     std::shared_mutex openedEntriesLock_;
     std::unordered_map<Volume::Handle, EntryWPtr> openedEntries_;
+    std::unordered_set<Volume::Handle> removedHandles_; // removed while opened, recycled when entry is released
+    std::unordered_map<Volume::Handle, std::vector<Volume::Handle>> removedChildren_; // recycled when parent is saved
+    std::uint64_t recycled_{0}; // count of handles recycled, guarded by openedEntriesLock_
     MRUCache<std::string, Volume::Handle, PATH_MRU_CACHE_SIZE> pathCache_;
     mutable SpinLock<> claimLock_;
     Volume::Token claimToken_{};
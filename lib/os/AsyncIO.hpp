@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "File.hpp"
+#include "util/Status.hpp"
+
+namespace skv::os {
+
+/**
+ * @brief Completion-driven positional file I/O
+ */
+class AsyncIO final {
+    struct Impl;
+
+public:
+    enum class Engine: std::uint8_t {
+        Blocking,   // operation executed by submitting thread, callback invoked before submit returns
+        IoUring     // Linux io_uring, callbacks invoked by completion thread. Falls back to Blocking if unsupported
+    };
+
+    using Callback = std::function<void(std::int64_t)>; // bytes transferred or negative error code. Shouldn't submit new operations
+
+    AsyncIO() noexcept;
+    ~AsyncIO() noexcept;
+
+    AsyncIO(const AsyncIO&) = delete;
+    AsyncIO& operator=(const AsyncIO&) = delete;
+
+    AsyncIO(AsyncIO&&) = delete;
+    AsyncIO& operator=(AsyncIO&&) = delete;
+
+    /**
+     * @brief Starts I/O engine
+     * @param engine - requested engine
+     * @param queueDepth - max count of in-flight operations, submit blocks when exceeded
+     * @return Status::Ok() on success (even if engine fell back to Engine::Blocking)
+     */
+    [[nodiscard]] util::Status open(Engine engine, std::uint32_t queueDepth);
+
+    /**
+     * @brief Waits for all in-flight operations and stops I/O engine
+     */
+    void close() noexcept;
+
+    /**
+     * @brief Engine actually used
+     */
+    [[nodiscard]] Engine engine() const noexcept;
+
+    /**
+     * @brief Reads "n" bytes at "offset" to "ptr". Buffer should be valid until callback invoked
+     */
+    [[nodiscard]] util::Status read(const File::Handle& handle, void* ptr, std::uint64_t n, std::int64_t offset, Callback callback);
+
+    /**
+     * @brief Gather write of "count" buffers at "offset". Buffers should be valid until callback invoked
+     */
+    [[nodiscard]] util::Status write(const File::Handle& handle, const File::IoVec* iov, std::size_t count, std::int64_t offset, Callback callback);
+
+private:
+    std::unique_ptr<Impl> impl_;
+};
+
+}
@@ -0,0 +1,387 @@
+#include "AsyncIO.hpp"
+
+#ifdef BUILDING_UNIX
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace skv::os {
+
+using util::Status;
+
+namespace {
+
+struct Request {
+    File::Handle handle;
+    std::vector<::iovec> iov;
+    AsyncIO::Callback callback;
+};
+
+void invokeCallback(const AsyncIO::Callback& callback, std::int64_t result) noexcept {
+    try {
+        if (callback)
+            callback(result);
+    }
+    catch (...) {} // callbacks shouldn't throw, ignoring as ThreadPool does
+}
+
+}
+
+struct AsyncIO::Impl {
+    Engine engine{Engine::Blocking};
+
+#ifdef __linux__
+    ~Impl() noexcept {
+        stop();
+    }
+
+    bool setup(std::uint32_t queueDepth) {
+        ::io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+
+        ringFd = int(::syscall(__NR_io_uring_setup, std::max<std::uint32_t>(queueDepth, 1), &params));
+
+        if (ringFd < 0)
+            return false;
+
+        entries = params.sq_entries;
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(::io_uring_cqe);
+
+        const bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+
+        if (singleMmap)
+            sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+
+        sqRing = ::mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+
+        if (sqRing == MAP_FAILED) {
+            sqRing = nullptr;
+
+            return release(), false;
+        }
+
+        if (singleMmap)
+            cqRing = sqRing;
+        else {
+            cqRing = ::mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+
+            if (cqRing == MAP_FAILED) {
+                cqRing = nullptr;
+
+                return release(), false;
+            }
+        }
+
+        sqesSize = params.sq_entries * sizeof(::io_uring_sqe);
+        auto sqesPtr = ::mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+
+        if (sqesPtr == MAP_FAILED)
+            return release(), false;
+
+        sqes = static_cast<::io_uring_sqe*>(sqesPtr);
+
+        auto sq = static_cast<char*>(sqRing);
+        auto cq = static_cast<char*>(cqRing);
+
+        sqTail  = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask  = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cqHead  = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail  = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask  = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes    = reinterpret_cast<::io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        inflight = 0;
+        reaper = std::thread(&Impl::reap, this);
+
+        return true;
+    }
+
+    void release() noexcept {
+        if (sqes)
+            ::munmap(sqes, sqesSize);
+        if (cqRing && cqRing != sqRing)
+            ::munmap(cqRing, cqRingSize);
+        if (sqRing)
+            ::munmap(sqRing, sqRingSize);
+        if (ringFd >= 0)
+            ::close(ringFd);
+
+        sqes = nullptr;
+        cqRing = sqRing = nullptr;
+        ringFd = -1;
+    }
+
+    void stop() noexcept {
+        if (ringFd < 0)
+            return;
+
+        if (reaper.joinable()) {
+            // NOP with zero user data wakes up completion thread, it exits when all in-flight operations completed
+            while (!submit(IORING_OP_NOP, -1, nullptr, 0, 0, 0))
+                std::this_thread::yield();
+
+            reaper.join();
+        }
+
+        release();
+    }
+
+    bool submit(std::uint8_t opcode, int fd, const ::iovec* iov, unsigned iovcnt, std::int64_t offset, std::uint64_t userData) {
+        std::unique_lock lock(submitLock);
+
+        slotFree.wait(lock, [this] { return inflight < entries; });
+
+        const auto tail = *sqTail;
+        const auto index = tail & *sqMask;
+        auto sqe = &sqes[index];
+
+        std::memset(sqe, 0, sizeof(*sqe));
+
+        sqe->opcode = opcode;
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<std::uint64_t>(iov);
+        sqe->len = iovcnt;
+        sqe->off = std::uint64_t(offset);
+        sqe->user_data = userData;
+
+        sqArray[index] = index;
+
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+
+        while (true) {
+            auto r = ::syscall(__NR_io_uring_enter, ringFd, 1, 0, 0, nullptr, 0);
+
+            if (r >= 0)
+                break;
+
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+                continue;
+
+            __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE); // kernel didn't consume entry
+
+            return false;
+        }
+
+        ++inflight;
+
+        return true;
+    }
+
+    void reap() noexcept {
+        std::vector<std::pair<Request*, std::int64_t>> completed;
+        bool stopRequested = false;
+
+        while (true) {
+            auto r = ::syscall(__NR_io_uring_enter, ringFd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+
+            if (r < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                std::this_thread::yield();
+
+            auto head = *cqHead;
+            const auto tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+            std::size_t reaped = 0;
+
+            completed.clear();
+
+            while (head != tail) {
+                const auto& cqe = cqes[head & *cqMask];
+
+                if (cqe.user_data == 0)
+                    stopRequested = true;
+                else
+                    completed.emplace_back(reinterpret_cast<Request*>(cqe.user_data), std::int64_t(cqe.res));
+
+                ++head;
+                ++reaped;
+            }
+
+            __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+
+            {   // free slots before invoking callbacks, so they are able to submit new operations
+                std::unique_lock lock(submitLock);
+
+                inflight -= std::min<std::size_t>(reaped, inflight);
+            }
+
+            slotFree.notify_all();
+
+            for (auto& [request, result] : completed) {
+                invokeCallback(request->callback, result);
+
+                delete request;
+            }
+
+            if (stopRequested) {
+                std::unique_lock lock(submitLock);
+
+                if (inflight == 0)
+                    break;
+            }
+        }
+    }
+
+    int ringFd{-1};
+    unsigned entries{0};
+    void* sqRing{nullptr};
+    void* cqRing{nullptr};
+    std::size_t sqRingSize{0};
+    std::size_t cqRingSize{0};
+    std::size_t sqesSize{0};
+    ::io_uring_sqe* sqes{nullptr};
+    ::io_uring_cqe* cqes{nullptr};
+    unsigned* sqTail{nullptr};
+    unsigned* sqMask{nullptr};
+    unsigned* sqArray{nullptr};
+    unsigned* cqHead{nullptr};
+    unsigned* cqTail{nullptr};
+    unsigned* cqMask{nullptr};
+
+    std::mutex submitLock;
+    std::condition_variable slotFree;
+    std::size_t inflight{0};
+    std::thread reaper;
+#endif
+};
+
+AsyncIO::AsyncIO() noexcept = default;
+
+AsyncIO::~AsyncIO() noexcept {
+    close();
+}
+
+Status AsyncIO::open(Engine engine, std::uint32_t queueDepth) {
+    close();
+
+    try {
+        impl_ = std::make_unique<Impl>();
+    }
+    catch (...) {
+        return Status::Fatal("bad_alloc");
+    }
+
+#ifdef __linux__
+    if (engine == Engine::IoUring && impl_->setup(queueDepth))
+        impl_->engine = Engine::IoUring;
+#else
+    (void)engine;
+    (void)queueDepth;
+#endif
+
+    return Status::Ok();
+}
+
+void AsyncIO::close() noexcept {
+    impl_.reset(); // in-flight operations completed in Impl destructor
+}
+
+AsyncIO::Engine AsyncIO::engine() const noexcept {
+    return impl_? impl_->engine : Engine::Blocking;
+}
+
+Status AsyncIO::read(const File::Handle& handle, void* ptr, std::uint64_t n, std::int64_t offset, Callback callback) {
+    if (!handle)
+        return Status::InvalidArgument("Invalid handle");
+
+    if (engine() == Engine::Blocking) {
+        invokeCallback(callback, std::int64_t(File::pread(handle, ptr, n, offset)));
+
+        return Status::Ok();
+    }
+
+#ifdef __linux__
+    auto request = new (std::nothrow) Request;
+
+    if (!request)
+        return Status::Fatal("bad_alloc");
+
+    try {
+        request->handle = handle;
+        request->iov.push_back(::iovec{ptr, std::size_t(n)});
+        request->callback = std::move(callback);
+    }
+    catch (...) {
+        delete request;
+
+        return Status::Fatal("bad_alloc");
+    }
+
+    if (!impl_->submit(IORING_OP_READV, ::fileno(handle.get()), request->iov.data(), 1, offset, reinterpret_cast<std::uint64_t>(request))) {
+        delete request;
+
+        return Status::IOError("Unable to submit");
+    }
+#endif
+
+    return Status::Ok();
+}
+
+Status AsyncIO::write(const File::Handle& handle, const File::IoVec* iov, std::size_t count, std::int64_t offset, Callback callback) {
+    if (!handle)
+        return Status::InvalidArgument("Invalid handle");
+
+    if (engine() == Engine::Blocking) {
+        invokeCallback(callback, std::int64_t(File::pwritev(handle, iov, count, offset)));
+
+        return Status::Ok();
+    }
+
+#ifdef __linux__
+    auto request = new (std::nothrow) Request;
+
+    if (!request)
+        return Status::Fatal("bad_alloc");
+
+    try {
+        request->handle = handle;
+
+        for (std::size_t i = 0; i < count; ++i) {
+            if (iov[i].size > 0)
+                request->iov.push_back(::iovec{const_cast<void*>(iov[i].data), std::size_t(iov[i].size)});
+        }
+
+        request->callback = std::move(callback);
+    }
+    catch (...) {
+        delete request;
+
+        return Status::Fatal("bad_alloc");
+    }
+
+    if (request->iov.size() > IOV_MAX) {
+        delete request;
+
+        return Status::InvalidArgument("Too many buffers");
+    }
+
+    if (!impl_->submit(IORING_OP_WRITEV, ::fileno(handle.get()), request->iov.data(), unsigned(request->iov.size()), offset, reinterpret_cast<std::uint64_t>(request))) {
+        delete request;
+
+        return Status::IOError("Unable to submit");
+    }
+#endif
+
+    return Status::Ok();
+}
+
+}
+
+#endif
@@ -0,0 +1,68 @@
+#include "AsyncIO.hpp"
+
+#ifdef BUILDING_WINDOWS
+
+namespace skv::os {
+
+    using util::Status;
+
+    struct AsyncIO::Impl {
+        Engine engine{Engine::Blocking};
+    };
+
+    namespace {
+
+    void invokeCallback(const AsyncIO::Callback& callback, std::int64_t result) noexcept {
+        try {
+            if (callback)
+                callback(result);
+        }
+        catch (...) {} // callbacks shouldn't throw, ignoring as ThreadPool does
+    }
+
+    }
+
+    AsyncIO::AsyncIO() noexcept = default;
+
+    AsyncIO::~AsyncIO() noexcept = default;
+
+    Status AsyncIO::open([[maybe_unused]] Engine engine, [[maybe_unused]] std::uint32_t queueDepth) {
+        try {
+            impl_ = std::make_unique<Impl>(); // only blocking engine available
+        }
+        catch (...) {
+            return Status::Fatal("bad_alloc");
+        }
+
+        return Status::Ok();
+    }
+
+    void AsyncIO::close() noexcept {
+        impl_.reset();
+    }
+
+    AsyncIO::Engine AsyncIO::engine() const noexcept {
+        return Engine::Blocking;
+    }
+
+    Status AsyncIO::read(const File::Handle& handle, void* ptr, std::uint64_t n, std::int64_t offset, Callback callback) {
+        if (!handle)
+            return Status::InvalidArgument("Invalid handle");
+
+        invokeCallback(callback, std::int64_t(File::pread(handle, ptr, n, offset)));
+
+        return Status::Ok();
+    }
+
+    Status AsyncIO::write(const File::Handle& handle, const File::IoVec* iov, std::size_t count, std::int64_t offset, Callback callback) {
+        if (!handle)
+            return Status::InvalidArgument("Invalid handle");
+
+        invokeCallback(callback, std::int64_t(File::pwritev(handle, iov, count, offset)));
+
+        return Status::Ok();
+    }
+
+}
+
+#endif
@@ -25,12 +25,73 @@ struct File {
     };
 
     using Handle = std::shared_ptr<std::FILE>;
+    using Mapping = std::shared_ptr<const char>; // unmapped when last reference released
+
+    static constexpr std::uint32_t DirectIOAlignment = 4096; // buffer address, offset and size alignment of unbuffered I/O
+
+    struct IoVec {
+        const void*     data;
+        std::uint64_t   size;
+    };
 
     [[nodiscard]] static Handle open(const path& path, std::string_view mode) noexcept;
 
+    /**
+     * @brief Opens existing file bypassing OS page cache (O_DIRECT, F_NOCACHE on macOS). Positional reads and writes
+     * on such handle should use buffers, offsets and sizes aligned to DirectIOAlignment
+     * @param mode - "rb" or "rb+"
+     * @return empty handle on error
+     */
+    [[nodiscard]] static Handle openDirect(const path& path, std::string_view mode) noexcept;
+
     [[nodiscard]] static std::uint64_t write(const void* __restrict ptr, std::uint64_t size, std::uint64_t n, const Handle& handle) noexcept;
     [[nodiscard]] static std::uint64_t read(void* __restrict ptr, std::uint64_t size, std::uint64_t n, const Handle& handle) noexcept;
 
+    /**
+     * @brief Positional read. Doesn't use or change file position so can be called concurrently on the same handle
+     * @return count of bytes read (less than "n" only on EOF or error)
+     */
+    [[nodiscard]] static std::uint64_t pread(const Handle& handle, void* __restrict ptr, std::uint64_t n, std::int64_t offset) noexcept;
+
+    /**
+     * @brief Positional write. Bypasses stdio buffering of the handle
+     * @return count of bytes written (less than "n" only on error)
+     */
+    [[nodiscard]] static std::uint64_t pwrite(const Handle& handle, const void* __restrict ptr, std::uint64_t n, std::int64_t offset) noexcept;
+
+    /**
+     * @brief Positional gather write of "count" buffers in one system call (where supported)
+     * @return count of bytes written (less than sum of buffer sizes only on error)
+     */
+    [[nodiscard]] static std::uint64_t pwritev(const Handle& handle, const IoVec* iov, std::size_t count, std::int64_t offset) noexcept;
+
+    /**
+     * @brief Flushes file data (but not necessarily metadata) to the storage device
+     * @return true on success
+     */
+    [[nodiscard]] static bool sync(const Handle& handle) noexcept;
+
+    /**
+     * @brief Flushes directory entries (e.g. file created or renamed in directory) to the storage device
+     * @return true on success
+     */
+    [[nodiscard]] static bool syncDirectory(const path& dirPath) noexcept;
+
+    /**
+     * @brief Reserves disk space for "length" bytes starting from "offset"
+     * @param keepSize - if true file size isn't changed (fails if not supported by file system),
+     * otherwise file is extended and reserved range reads as zeros
+     * @return true on success
+     */
+    [[nodiscard]] static bool allocate(const Handle& handle, std::uint64_t offset, std::uint64_t length, bool keepSize) noexcept;
+
+    /**
+     * @brief Maps first "length" bytes of file read-only. On unix "length" may exceed file size, but pages beyond
+     * end of file shouldn't be accessed
+     * @return empty mapping on error
+     */
+    [[nodiscard]] static Mapping map(const Handle& handle, std::uint64_t length) noexcept;
+
     [[nodiscard]] static bool seek(const Handle& handle, std::int64_t offset, Seek s) noexcept;
     [[nodiscard]] static std::int64_t tell(const Handle& fhandle) noexcept;
 
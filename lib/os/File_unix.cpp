@@ -2,6 +2,13 @@
 
 #ifdef BUILDING_UNIX
 
+#include <array>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 namespace skv::os {
@@ -15,6 +22,40 @@ File::Handle File::open(const path &path, std::string_view mode) noexcept {
                         }};
 }
 
+File::Handle File::openDirect(const path& path, std::string_view mode) noexcept {
+#ifdef O_DIRECT
+    const auto flags = (mode.find('+') != std::string_view::npos)? O_RDWR : O_RDONLY;
+    const auto fd = ::open(path.c_str(), flags | O_DIRECT | O_CLOEXEC);
+
+    if (fd < 0)
+        return {};
+
+    auto f = ::fdopen(fd, mode.data());
+
+    if (!f) {
+        ::close(fd);
+
+        return {};
+    }
+
+    return File::Handle{f,
+                        [](FILE* f) -> int {
+                            if (f)
+                                return ::fclose(f);
+                            return -1;
+                        }};
+#else
+    auto handle = open(path, mode);
+
+#ifdef F_NOCACHE
+    if (handle && ::fcntl(::fileno(handle.get()), F_NOCACHE, 1) != 0)
+        return {};
+#endif
+
+    return handle;
+#endif
+}
+
 std::int64_t File::tell(const Handle& fhandle) noexcept {
     if (!fhandle)
         return -1;
@@ -36,6 +77,178 @@ std::uint64_t File::read(void* __restrict ptr, std::uint64_t size, std::uint64_t
     return ::fread(ptr, size, n, handle.get());
 }
 
+std::uint64_t File::pread(const Handle& handle, void* __restrict ptr, std::uint64_t n, std::int64_t offset) noexcept {
+    if (!handle)
+        return 0;
+
+    const auto fd = ::fileno(handle.get());
+    auto data = static_cast<char*>(ptr);
+    std::uint64_t total = 0;
+
+    while (total < n) {
+        auto r = ::pread(fd, data + total, n - total, off_t(offset + std::int64_t(total)));
+
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0)
+            break;
+
+        total += std::uint64_t(r);
+    }
+
+    return total;
+}
+
+std::uint64_t File::pwrite(const Handle& handle, const void* __restrict ptr, std::uint64_t n, std::int64_t offset) noexcept {
+    if (!handle)
+        return 0;
+
+    const auto fd = ::fileno(handle.get());
+    auto data = static_cast<const char*>(ptr);
+    std::uint64_t total = 0;
+
+    while (total < n) {
+        auto r = ::pwrite(fd, data + total, n - total, off_t(offset + std::int64_t(total)));
+
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0)
+            break;
+
+        total += std::uint64_t(r);
+    }
+
+    return total;
+}
+
+std::uint64_t File::pwritev(const Handle& handle, const IoVec* iov, std::size_t count, std::int64_t offset) noexcept {
+    if (!handle)
+        return 0;
+
+    const auto fd = ::fileno(handle.get());
+    std::array<::iovec, 256> vec; // IOV_MAX is at least 1024 on all supported systems
+    std::uint64_t total = 0;
+    std::size_t i = 0;
+    std::uint64_t skip = 0; // bytes of iov[i] already written
+
+    while (i < count) {
+        std::size_t n = 0;
+
+        for (auto j = i; j < count && n < vec.size(); ++j) {
+            const auto s = (j == i)? skip : 0;
+
+            if (iov[j].size > s)
+                vec[n++] = ::iovec{const_cast<char*>(static_cast<const char*>(iov[j].data)) + s, std::size_t(iov[j].size - s)};
+        }
+
+        if (n == 0)
+            break;
+
+        auto r = ::pwritev(fd, vec.data(), int(n), off_t(offset + std::int64_t(total)));
+
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0)
+            break;
+
+        total += std::uint64_t(r);
+
+        auto left = std::uint64_t(r);
+
+        while (i < count && left >= iov[i].size - skip) {
+            left -= iov[i].size - skip;
+            skip = 0;
+            ++i;
+        }
+
+        skip += left;
+    }
+
+    return total;
+}
+
+bool File::sync(const Handle& handle) noexcept {
+    if (!handle)
+        return false;
+
+#ifdef __APPLE__
+    return ::fsync(::fileno(handle.get())) == 0;
+#else
+    return ::fdatasync(::fileno(handle.get())) == 0;
+#endif
+}
+
+bool File::syncDirectory(const path& dirPath) noexcept {
+    const auto fd = ::open(dirPath.empty()? "." : dirPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (fd < 0)
+        return false;
+
+    const bool synced = ::fsync(fd) == 0;
+
+    ::close(fd);
+
+    return synced;
+}
+
+bool File::allocate(const Handle& handle, std::uint64_t offset, std::uint64_t length, bool keepSize) noexcept {
+    if (!handle)
+        return false;
+
+    const auto fd = ::fileno(handle.get());
+
+    if (keepSize) {
+#if defined(__linux__) && defined(FALLOC_FL_KEEP_SIZE)
+        int r;
+
+        do {
+            r = ::fallocate(fd, FALLOC_FL_KEEP_SIZE, off_t(offset), off_t(length));
+        } while (r != 0 && errno == EINTR);
+
+        return r == 0;
+#elif defined(F_PREALLOCATE)
+        ::fstore_t store{F_ALLOCATEALL, F_PEOFPOSMODE, 0, off_t(offset + length), 0};
+
+        return ::fcntl(fd, F_PREALLOCATE, &store) != -1;
+#else
+        return false;
+#endif
+    }
+
+#ifdef __APPLE__
+    struct ::stat st;
+
+    if (::fstat(fd, &st) != 0)
+        return false;
+
+    return off_t(offset + length) <= st.st_size || ::ftruncate(fd, off_t(offset + length)) == 0;
+#else
+    return ::posix_fallocate(fd, off_t(offset), off_t(length)) == 0;
+#endif
+}
+
+File::Mapping File::map(const Handle& handle, std::uint64_t length) noexcept {
+    if (!handle || length == 0)
+        return {};
+
+    auto ptr = ::mmap(nullptr, std::size_t(length), PROT_READ, MAP_SHARED, ::fileno(handle.get()), 0);
+
+    if (ptr == MAP_FAILED)
+        return {};
+
+    try {
+        return Mapping{static_cast<const char*>(ptr),
+                       [length](const char* p) {
+                           ::munmap(const_cast<char*>(p), std::size_t(length));
+                       }};
+    }
+    catch (...) {
+        ::munmap(ptr, std::size_t(length));
+    }
+
+    return {};
+}
+
 bool File::seek(const Handle &handle, std::int64_t offset, Seek s) noexcept {
     if (!handle)
         return false;
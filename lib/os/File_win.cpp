@@ -2,6 +2,9 @@
 
 #ifdef BUILDING_WINDOWS
 
+#include <algorithm>
+
+#include <io.h>
 #include <windows.h>
 
 namespace skv::os {
@@ -17,6 +20,11 @@ namespace skv::os {
                             }};
     }
 
+    File::Handle File::openDirect(const path& path, std::string_view mode) noexcept {
+        // FILE_FLAG_NO_BUFFERING can't be requested through CRT streams, so handle is buffered by the OS
+        return open(path, mode);
+    }
+
     std::int64_t File::tell(const Handle& fhandle) noexcept {
         if (!fhandle)
             return -1;
@@ -38,6 +46,139 @@ namespace skv::os {
         return ::fread(ptr,  std::size_t(size),  std::size_t(n), handle.get());
     }
 
+    std::uint64_t File::pread(const Handle& handle, void* __restrict ptr, std::uint64_t n, std::int64_t offset) noexcept {
+        if (!handle)
+            return 0;
+
+        auto fh = reinterpret_cast<HANDLE>(::_get_osfhandle(::_fileno(handle.get())));
+        auto data = static_cast<char*>(ptr);
+        std::uint64_t total = 0;
+
+        while (total < n) {
+            OVERLAPPED ov{};
+            const auto pos = std::uint64_t(offset) + total;
+            DWORD r = 0;
+
+            ov.Offset = DWORD(pos & 0xFFFFFFFF);
+            ov.OffsetHigh = DWORD(pos >> 32);
+
+            if (!::ReadFile(fh, data + total, DWORD(std::min<std::uint64_t>(n - total, 0x40000000)), &r, &ov) || r == 0)
+                break;
+
+            total += r;
+        }
+
+        return total;
+    }
+
+    std::uint64_t File::pwrite(const Handle& handle, const void* __restrict ptr, std::uint64_t n, std::int64_t offset) noexcept {
+        if (!handle)
+            return 0;
+
+        auto fh = reinterpret_cast<HANDLE>(::_get_osfhandle(::_fileno(handle.get())));
+        auto data = static_cast<const char*>(ptr);
+        std::uint64_t total = 0;
+
+        while (total < n) {
+            OVERLAPPED ov{};
+            const auto pos = std::uint64_t(offset) + total;
+            DWORD r = 0;
+
+            ov.Offset = DWORD(pos & 0xFFFFFFFF);
+            ov.OffsetHigh = DWORD(pos >> 32);
+
+            if (!::WriteFile(fh, data + total, DWORD(std::min<std::uint64_t>(n - total, 0x40000000)), &r, &ov) || r == 0)
+                break;
+
+            total += r;
+        }
+
+        return total;
+    }
+
+    std::uint64_t File::pwritev(const Handle& handle, const IoVec* iov, std::size_t count, std::int64_t offset) noexcept {
+        std::uint64_t total = 0;
+
+        for (std::size_t i = 0; i < count; ++i) {
+            auto r = pwrite(handle, iov[i].data, iov[i].size, offset + std::int64_t(total));
+
+            total += r;
+
+            if (r != iov[i].size)
+                break;
+        }
+
+        return total;
+    }
+
+    bool File::sync(const Handle& handle) noexcept {
+        if (!handle)
+            return false;
+
+        return ::FlushFileBuffers(reinterpret_cast<HANDLE>(::_get_osfhandle(::_fileno(handle.get())))) != 0;
+    }
+
+    bool File::syncDirectory(const path&) noexcept {
+        return true; // NTFS journals directory entries, they can't be flushed by handle of directory opened for reading
+    }
+
+    bool File::allocate(const Handle& handle, std::uint64_t offset, std::uint64_t length, bool keepSize) noexcept {
+        if (!handle)
+            return false;
+
+        auto h = reinterpret_cast<HANDLE>(::_get_osfhandle(::_fileno(handle.get())));
+
+        if (keepSize) {
+            FILE_ALLOCATION_INFO info;
+            info.AllocationSize.QuadPart = LONGLONG(offset + length);
+
+            return ::SetFileInformationByHandle(h, FileAllocationInfo, &info, sizeof(info)) != 0;
+        }
+
+        LARGE_INTEGER size;
+
+        if (!::GetFileSizeEx(h, &size))
+            return false;
+
+        if (std::uint64_t(size.QuadPart) >= offset + length)
+            return true;
+
+        return ::_chsize_s(::_fileno(handle.get()), std::int64_t(offset + length)) == 0;
+    }
+
+    File::Mapping File::map(const Handle& handle, std::uint64_t length) noexcept {
+        if (!handle || length == 0)
+            return {};
+
+        auto fh = reinterpret_cast<HANDLE>(::_get_osfhandle(::_fileno(handle.get())));
+        auto mh = ::CreateFileMapping(fh, nullptr, PAGE_READONLY, DWORD(length >> 32), DWORD(length & 0xFFFFFFFF), nullptr);
+
+        if (!mh)
+            return {};
+
+        auto ptr = ::MapViewOfFile(mh, FILE_MAP_READ, 0, 0, SIZE_T(length));
+
+        if (!ptr) {
+            ::CloseHandle(mh);
+
+            return {};
+        }
+
+        try {
+            return Mapping{static_cast<const char*>(ptr),
+                           [mh](const char* p) {
+                               ::UnmapViewOfFile(p);
+                               ::CloseHandle(mh);
+                           }};
+        }
+        catch (...) {
+            ::UnmapViewOfFile(ptr);
+            ::CloseHandle(mh);
+        }
+
+        return {};
+    }
+
     bool File::seek(const Handle &handle, std::int64_t offset, Seek s) noexcept {
         if (!handle)
             return false;
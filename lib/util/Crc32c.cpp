@@ -0,0 +1,144 @@
+#include "Crc32c.hpp"
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SKV_CRC32C_SSE42
+#include <nmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+namespace skv::util {
+
+namespace {
+
+constexpr std::uint32_t POLYNOMIAL = 0x82F63B78; // reflected Castagnoli polynomial
+
+using Tables = std::array<std::array<std::uint32_t, 256>, 8>;
+
+constexpr Tables makeTables() noexcept {
+    Tables t{};
+
+    for (std::uint32_t i = 0; i < 256; ++i) {
+        auto crc = i;
+
+        for (int bit = 0; bit < 8; ++bit)
+            crc = (crc & 1)? (crc >> 1) ^ POLYNOMIAL : (crc >> 1);
+
+        t[0][i] = crc;
+    }
+
+    // t[k][i] is checksum of byte i followed by k zero bytes
+    for (std::size_t k = 1; k < t.size(); ++k) {
+        for (std::uint32_t i = 0; i < 256; ++i)
+            t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xFF];
+    }
+
+    return t;
+}
+
+constexpr Tables TABLES = makeTables();
+
+inline bool littleEndian() noexcept {
+    const std::uint16_t probe = 1;
+    std::uint8_t first;
+
+    std::memcpy(&first, &probe, 1);
+
+    return first == 1;
+}
+
+std::uint32_t slicingBy8(const std::uint8_t* p, std::size_t size, std::uint32_t crc) noexcept {
+    crc = ~crc;
+
+    if (littleEndian()) {
+        for (; size >= 8; size -= 8, p += 8) {
+            std::uint32_t lo;
+            std::uint32_t hi;
+
+            std::memcpy(&lo, p, 4);
+            std::memcpy(&hi, p + 4, 4);
+
+            lo ^= crc;
+
+            crc = TABLES[7][lo & 0xFF] ^ TABLES[6][(lo >> 8) & 0xFF] ^
+                  TABLES[5][(lo >> 16) & 0xFF] ^ TABLES[4][lo >> 24] ^
+                  TABLES[3][hi & 0xFF] ^ TABLES[2][(hi >> 8) & 0xFF] ^
+                  TABLES[1][(hi >> 16) & 0xFF] ^ TABLES[0][hi >> 24];
+        }
+    }
+
+    for (; size > 0; --size, ++p)
+        crc = TABLES[0][(crc ^ *p) & 0xFF] ^ (crc >> 8);
+
+    return ~crc;
+}
+
+#ifdef SKV_CRC32C_SSE42
+
+#ifndef _MSC_VER
+__attribute__((target("sse4.2")))
+#endif
+std::uint32_t sse42(const std::uint8_t* p, std::size_t size, std::uint32_t crc) noexcept {
+    std::uint64_t crc64 = ~crc;
+
+    for (; size >= 8; size -= 8, p += 8) {
+        std::uint64_t word;
+
+        std::memcpy(&word, p, 8);
+
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+
+    auto crc32 = std::uint32_t(crc64);
+
+    for (; size > 0; --size, ++p)
+        crc32 = _mm_crc32_u8(crc32, *p);
+
+    return ~crc32;
+}
+
+bool sse42Supported() noexcept {
+#ifdef _MSC_VER
+    int info[4];
+
+    __cpuid(info, 1);
+
+    return (info[2] & (1 << 20)) != 0;
+#else
+    return __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+#endif
+
+using Implementation = std::uint32_t (*)(const std::uint8_t*, std::size_t, std::uint32_t) noexcept;
+
+Implementation implementation() noexcept {
+#ifdef SKV_CRC32C_SSE42
+    static const Implementation impl = sse42Supported()? &sse42 : &slicingBy8;
+#else
+    static const Implementation impl = &slicingBy8;
+#endif
+
+    return impl;
+}
+
+}
+
+std::uint32_t crc32c(const void* data, std::size_t size, std::uint32_t crc) noexcept {
+    return implementation()(static_cast<const std::uint8_t*>(data), size, crc);
+}
+
+std::uint32_t crc32cPortable(const void* data, std::size_t size, std::uint32_t crc) noexcept {
+    return slicingBy8(static_cast<const std::uint8_t*>(data), size, crc);
+}
+
+bool crc32cHardwareAccelerated() noexcept {
+    return implementation() != &slicingBy8;
+}
+
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace skv::util {
+
+/**
+ * @brief CRC32C (Castagnoli) checksum. Uses SSE4.2 crc32 instruction if CPU supports it, slicing-by-8 otherwise
+ * @param data
+ * @param size - bytes count
+ * @param crc - checksum of preceding data when checksum is calculated by parts (0 for first part)
+ * @return
+ */
+[[nodiscard]] std::uint32_t crc32c(const void* data, std::size_t size, std::uint32_t crc = 0) noexcept;
+
+/**
+ * @brief CRC32C calculated by slicing-by-8 regardless of CPU capabilities
+ */
+[[nodiscard]] std::uint32_t crc32cPortable(const void* data, std::size_t size, std::uint32_t crc = 0) noexcept;
+
+/**
+ * @brief crc32c() uses CPU instructions
+ */
+[[nodiscard]] bool crc32cHardwareAccelerated() noexcept;
+
+}
@@ -95,6 +95,27 @@ public:
         return true;
     }
 
+    /**
+     * @brief Removes all items with "value", scans whole cache
+     * @return count of removed items
+     */
+    std::size_t removeValue(const value_type& value) {
+        std::lock_guard locker(xLock_);
+
+        std::size_t removed = 0;
+
+        for (auto it = std::begin(cache_); it != std::end(cache_);) {
+            if (it->second == value) {
+                it = cache_.erase(it);
+                ++removed;
+            }
+            else
+                ++it;
+        }
+
+        return removed;
+    }
+
     std::size_t size() const noexcept {
         std::lock_guard locker(xLock_);
 
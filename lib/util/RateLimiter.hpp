@@ -0,0 +1,90 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace skv::util {
+
+/**
+ * @brief Token bucket. Tokens are refilled at "rate" per second up to "burst". Request larger than available tokens
+ * is granted anyway and puts bucket in debt, so caller waits until debt is repaid
+ */
+template <typename Clock = std::chrono::steady_clock>
+class TokenBucket final {
+public:
+    using clock_type = Clock;
+    using duration_type = std::chrono::nanoseconds;
+
+    /**
+     * @param rate - tokens per second, 0 - unlimited
+     * @param burst - max tokens accumulated while idle (0 - one second of rate)
+     */
+    explicit TokenBucket(std::uint64_t rate = 0, std::uint64_t burst = 0) noexcept:
+        rate_{rate},
+        burst_{burst == 0? rate : burst},
+        tokens_{double(burst_)},
+        updated_{clock_type::now()}
+    {}
+
+    [[nodiscard]] bool unlimited() const noexcept { return rate_ == 0; }
+
+    /**
+     * @brief Takes "tokens" from bucket
+     * @return time to wait before tokens are actually available
+     */
+    [[nodiscard]] duration_type reserve(std::uint64_t tokens, typename clock_type::time_point now = clock_type::now()) noexcept {
+        if (unlimited())
+            return duration_type::zero();
+
+        const auto elapsed = std::chrono::duration<double>(now - updated_).count();
+
+        updated_ = std::max(updated_, now);
+        tokens_ = std::min(double(burst_), tokens_ + std::max(elapsed, 0.0) * double(rate_)) - double(tokens);
+
+        if (tokens_ >= 0)
+            return duration_type::zero();
+
+        return std::chrono::duration_cast<duration_type>(std::chrono::duration<double>(-tokens_ / double(rate_)));
+    }
+
+private:
+    std::uint64_t rate_;
+    std::uint64_t burst_;
+    double tokens_;
+    typename clock_type::time_point updated_;
+};
+
+/**
+ * @brief I/O budget: both bytes per second and operations per second are limited (0 - unlimited)
+ */
+template <typename Clock = std::chrono::steady_clock>
+class RateLimiter final {
+public:
+    using duration_type = typename TokenBucket<Clock>::duration_type;
+
+    RateLimiter(std::uint64_t bytesPerSec = 0, std::uint64_t opsPerSec = 0) noexcept:
+        bytes_{bytesPerSec},
+        ops_{opsPerSec}
+    {}
+
+    [[nodiscard]] bool unlimited() const noexcept { return bytes_.unlimited() && ops_.unlimited(); }
+
+    /**
+     * @brief Accounts "ops" operations transferring "bytes" in total
+     * @return time to wait before operations may be issued
+     */
+    [[nodiscard]] duration_type reserve(std::uint64_t bytes, std::uint64_t ops = 1, typename Clock::time_point now = Clock::now()) noexcept {
+        std::lock_guard locker(lock_);
+
+        return std::max(bytes_.reserve(bytes, now), ops_.reserve(ops, now));
+    }
+
+private:
+    std::mutex lock_;
+    TokenBucket<Clock> bytes_;
+    TokenBucket<Clock> ops_;
+};
+
+}
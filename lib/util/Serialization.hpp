@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <string>
 #include <string_view>
@@ -9,6 +10,8 @@
 
 #include <boost/endian/conversion.hpp>
 
+#include "Varint.hpp"
+
 namespace skv::util {
 
 struct Serializer final {
@@ -113,8 +116,207 @@ struct Deserializer final {
         return *this;
     }
 
+    [[nodiscard]] bool good() const noexcept {
+        return is.good();
+    }
+
 private:
     std::istream& is;
 };
 
+/* Types encoded by BufferWriter and BufferReader themselves, others provide their own operator<< and operator>> */
+template <typename T>
+inline constexpr bool is_buffer_primitive_v = std::is_arithmetic_v<T> ||
+                                              std::is_same_v<T, std::string> ||
+                                              std::is_same_v<T, std::string_view> ||
+                                              std::is_same_v<T, std::vector<char>>;
+
+/**
+ * @brief Serializer appending to growable buffer, encoding is the same as Serializer's. Values are copied by bulk
+ * inserts instead of stream calls
+ */
+class BufferWriter final {
+public:
+    explicit BufferWriter(std::vector<char>& buffer) noexcept:
+        buffer_{buffer}
+    {}
+
+    ~BufferWriter() noexcept  = default;
+
+    BufferWriter(const BufferWriter&) = delete;
+    BufferWriter& operator=(const BufferWriter&) = delete;
+
+    BufferWriter(BufferWriter&&) = delete;
+    BufferWriter& operator=(BufferWriter&&) = delete;
+
+    template <typename T, typename = std::enable_if_t<is_buffer_primitive_v<T>>>
+    inline BufferWriter& operator<<(const T& p)
+    {
+        namespace be = boost::endian;
+
+        if constexpr (std::is_floating_point_v<T>) {
+            std::uint64_t x{0};
+
+            std::memcpy(&x, &p, sizeof(p));
+            be::native_to_little_inplace(x);
+
+            write(&x, sizeof(x));
+        }
+        else if constexpr (std::is_integral_v<T>) {
+            auto x = be::native_to_little(p);
+
+            write(&x,  sizeof(x));
+        }
+        else {
+            auto x = be::native_to_little(std::uint64_t(p.size()));
+
+            write(&x, sizeof(x));
+            write(p.data(), p.size());
+        }
+
+        return *this;
+    }
+
+    void write(const void* data, std::size_t size) {
+        const auto bytes = static_cast<const char*>(data);
+
+        buffer_.insert(std::end(buffer_), bytes, bytes + size);
+    }
+
+    /* Appends "value" as LEB128 varint (see Varint.hpp) */
+    void writeVarint(std::uint64_t value) {
+        char bytes[MaxVarintSize];
+
+        write(bytes, encodeVarint(bytes, value));
+    }
+
+private:
+    std::vector<char>& buffer_;
+};
+
+/**
+ * @brief Deserializer reading from contiguous buffer. Reads are bounds checked: read past end of buffer yields
+ * zero value and reader isn't good() anymore. Strings may be read as std::string_view referring to buffer
+ */
+class BufferReader final {
+public:
+    BufferReader(const char* data, std::size_t size) noexcept:
+        data_{data},
+        size_{size}
+    {}
+
+    explicit BufferReader(const std::vector<char>& buffer) noexcept:
+        BufferReader(buffer.data(), buffer.size())
+    {}
+
+    ~BufferReader() noexcept  = default;
+
+    BufferReader(const BufferReader&) = delete;
+    BufferReader& operator=(const BufferReader&) = delete;
+
+    BufferReader(BufferReader&&) = delete;
+    BufferReader& operator=(BufferReader&&) = delete;
+
+    template <typename T, typename = std::enable_if_t<is_buffer_primitive_v<T>>>
+    inline BufferReader& operator>>(T& p)
+    {
+        namespace be = boost::endian;
+
+        if constexpr (std::is_floating_point_v<T>) {
+            std::uint64_t x{0};
+
+            read(&x, sizeof(x));
+            be::little_to_native_inplace(x);
+
+            std::memcpy(&p, &x, sizeof(p));
+        }
+        else if constexpr (std::is_integral_v<T>) {
+            read(&p, sizeof(p));
+            be::little_to_native_inplace(p);
+        }
+        else {
+            std::uint64_t pLen{0};
+
+            *this >> pLen;
+
+            if (!good_ || pLen > remaining()) {
+                fail();
+
+                p = T{};
+            }
+            else {
+                const auto first = data_ + position_;
+
+                if constexpr (std::is_same_v<T, std::string_view>)
+                    p = T{first, std::size_t(pLen)};
+                else
+                    p = T(first, first + pLen);
+
+                position_ += std::size_t(pLen);
+            }
+        }
+
+        return *this;
+    }
+
+    bool read(void* dst, std::size_t size) noexcept {
+        if (!good_ || size > remaining()) {
+            fail();
+
+            std::memset(dst, 0, size);
+
+            return false;
+        }
+
+        std::memcpy(dst, data_ + position_, size);
+        position_ += size;
+
+        return true;
+    }
+
+    /* Reads LEB128 varint (see Varint.hpp), 0 if it's malformed */
+    std::uint64_t readVarint() noexcept {
+        std::uint64_t value{0};
+
+        if (!good_)
+            return 0;
+
+        const auto next = decodeVarint(data_ + position_, data_ + size_, value);
+
+        if (!next) {
+            fail();
+
+            return 0;
+        }
+
+        position_ = std::size_t(next - data_);
+
+        return value;
+    }
+
+    /* Value read is malformed, reader isn't good() anymore */
+    void fail() noexcept {
+        good_ = false;
+    }
+
+    [[nodiscard]] bool good() const noexcept {
+        return good_;
+    }
+
+    /* Whole buffer is read */
+    [[nodiscard]] bool eof() const noexcept {
+        return position_ == size_;
+    }
+
+    [[nodiscard]] std::size_t remaining() const noexcept {
+        return size_ - position_;
+    }
+
+private:
+    const char* data_;
+    std::size_t size_;
+    std::size_t position_{0};
+    bool good_{true};
+};
+
 }
@@ -5,8 +5,23 @@
 #include <chrono>
 #include <thread>
 
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
 namespace skv::util {
 
+/* Tells CPU that thread spins, so sibling hardware thread (maybe the one waited for) isn't slowed down */
+inline void cpuRelax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
 struct NoBackoff {
     static void backoff([[maybe_unused]] std::size_t step) {}
 };
@@ -19,6 +34,17 @@ struct FixedStepBackoff {
     }
 };
 
+/* Short waits for writer: CPU is paused every step, thread yields every "Steps" steps in case writer is preempted */
+template <std::size_t Steps = 64>
+struct PauseBackoff {
+    static void backoff(std::size_t step) {
+        if (step % Steps == 0)
+            std::this_thread::yield();
+        else
+            cpuRelax();
+    }
+};
+
 template <typename BackoffStrategy = FixedStepBackoff<>>
 class SpinLock final {
 public:
@@ -34,4 +34,8 @@ bool Status::isInvalidOperation() const noexcept {
     return code_ == Code::InvalidOp;
 }
 
+bool Status::isCorruption() const noexcept {
+    return code_ == Code::Corruption;
+}
+
 }
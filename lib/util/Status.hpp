@@ -16,6 +16,7 @@ class Status final {
         NotFound,
         Fatal,
         InvalidOp,
+        Corruption,
         Undefined
     };
 
@@ -73,6 +74,11 @@ public:
         return create(Code::InvalidOp, std::forward<T>(m));
     }
 
+    template<typename T>
+    [[nodiscard]] static constexpr Status Corruption(T&& m) noexcept {
+        return create(Code::Corruption, std::forward<T>(m));
+    }
+
     constexpr Status() noexcept = default;
     ~Status() noexcept = default;
 
@@ -92,6 +98,7 @@ public:
     [[nodiscard]] bool isNotFound() const noexcept;
     [[nodiscard]] bool isFatal() const noexcept;
     [[nodiscard]] bool isInvalidOperation() const noexcept;
+    [[nodiscard]] bool isCorruption() const noexcept;
 };
 
 }
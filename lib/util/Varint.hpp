@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace skv::util {
+
+/* LEB128 encoding of unsigned integer: 7 bits per byte starting from low ones, high bit set in all bytes but last */
+inline constexpr std::size_t MaxVarintSize = 10;
+
+/**
+ * @brief Bytes taken by "value" encoded as varint
+ */
+[[nodiscard]] constexpr std::size_t varintSize(std::uint64_t value) noexcept {
+    std::size_t size = 1;
+
+    while (value >= 0x80) {
+        value >>= 7;
+        ++size;
+    }
+
+    return size;
+}
+
+/**
+ * @brief Writes "value" as varint at "dst"
+ * @param dst - at least varintSize(value) bytes
+ * @return bytes written
+ */
+inline std::size_t encodeVarint(char* dst, std::uint64_t value) noexcept {
+    std::size_t size = 0;
+
+    while (value >= 0x80) {
+        dst[size++] = char(std::uint8_t(value) | 0x80);
+        value >>= 7;
+    }
+
+    dst[size++] = char(value);
+
+    return size;
+}
+
+/**
+ * @brief Reads varint starting at "data"
+ * @param end - end of readable bytes
+ * @return position following varint, nullptr if varint is truncated or doesn't fit 64 bits
+ */
+[[nodiscard]] inline const char* decodeVarint(const char* data, const char* end, std::uint64_t& value) noexcept {
+    std::uint64_t result = 0;
+
+    for (unsigned shift = 0; data != end && shift < 64; shift += 7) {
+        const auto byte = std::uint8_t(*data++);
+
+        if (shift == 63 && byte > 1)
+            return nullptr;
+
+        result |= std::uint64_t(byte & 0x7F) << shift;
+
+        if ((byte & 0x80) == 0) {
+            value = result;
+
+            return data;
+        }
+    }
+
+    return nullptr;
+}
+
+/* Signed integer mapped to unsigned one so that values of small magnitude make short varints */
+[[nodiscard]] constexpr std::uint64_t zigzagEncode(std::int64_t value) noexcept {
+    return (std::uint64_t(value) << 1) ^ std::uint64_t(value >> 63);
+}
+
+[[nodiscard]] constexpr std::int64_t zigzagDecode(std::uint64_t value) noexcept {
+    return std::int64_t((value >> 1) ^ (~(value & 1) + 1));
+}
+
+}
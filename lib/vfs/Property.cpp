@@ -21,31 +21,38 @@ constexpr std::size_t variantTypeIndex() {
     }
 }
 
-template <typename T>
-void readProperty(std::istream& _is, uint16_t idx, Property& p) {
-    util::Deserializer ds{_is};
-
+template <typename T, typename Reader>
+bool readProperty(Reader& ds, uint16_t idx, Property& p) {
     if (variantTypeIndex<Property, T>() == idx) {
         T ret;
 
         ds >> ret;
 
-        p = Property{ret};
+        p = Property{std::move(ret)};
+
+        return true;
     }
-}
 
-template <typename ... Ts>
-void readProperty(std::istream& is, uint16_t idx, std::variant<Ts...> &p) {
-    (readProperty<Ts>(is, idx, p), ...);
+    return false;
 }
 
-std::ostream& operator<<(std::ostream& _os, const Property& p) {
-    util::Serializer s{_os};
+template <typename Reader, typename ... Ts>
+bool readProperty(Reader& ds, uint16_t idx, std::variant<Ts...> &p) {
+    return (readProperty<Ts>(ds, idx, p) || ...);
+}
 
+template <typename Writer>
+void writeProperty(Writer& s, const Property& p) {
     std::uint16_t idx = p.index() & PropertyIndexMask;
     s << idx;
 
     std::visit([&s](auto&& v) { s << v; }, p);
+}
+
+std::ostream& operator<<(std::ostream& _os, const Property& p) {
+    util::Serializer s{_os};
+
+    writeProperty(s, p);
 
     return _os;
 }
@@ -56,10 +63,26 @@ std::istream& operator>>(std::istream& _is, Property& p) {
     std::uint16_t idx;
     ds >> idx;
 
-    readProperty(_is, idx, p);
+    readProperty(ds, idx, p);
 
     return _is;
 }
 
+util::BufferWriter& operator<<(util::BufferWriter& w, const Property& p) {
+    writeProperty(w, p);
+
+    return w;
+}
+
+util::BufferReader& operator>>(util::BufferReader& r, Property& p) {
+    std::uint16_t idx{0};
+    r >> idx;
+
+    if (!readProperty(r, idx, p))
+        r.fail(); // unknown type, value can't be skipped
+
+    return r;
+}
+
 }
 
@@ -6,6 +6,11 @@
 #include <variant>
 #include <vector>
 
+namespace skv::util {
+    class BufferWriter;
+    class BufferReader;
+}
+
 namespace skv::vfs {
 
 using Property = std::variant<std::uint8_t, std::int8_t,
@@ -24,4 +29,6 @@ static_assert (std::variant_size_v<Property> <= PropertyIndexMask, "Property typ
 namespace std {
     std::ostream& operator<<(std::ostream& os, const skv::vfs::Property& p);
     std::istream& operator>>(std::istream& is, skv::vfs::Property& p);
+    skv::util::BufferWriter& operator<<(skv::util::BufferWriter& w, const skv::vfs::Property& p);
+    skv::util::BufferReader& operator>>(skv::util::BufferReader& r, skv::vfs::Property& p);
 }
@@ -0,0 +1,88 @@
+#include <cstdint>
+
+#include <gtest/gtest.h>
+
+#include <ondisk/BlockCache.hpp>
+
+using namespace skv::ondisk;
+
+TEST(BlockCacheTest, Basic) {
+    BlockCache<std::uint32_t, std::uint64_t> cache(4, 1);
+
+    ASSERT_EQ(cache.size(), 0);
+    ASSERT_EQ(cache.capacity(), 4);
+
+    std::uint64_t value;
+
+    ASSERT_FALSE(cache.lookup(1, value));
+
+    cache.insert(1, 1);
+    cache.insert(2, 2);
+
+    ASSERT_TRUE(cache.lookup(1, value));
+    ASSERT_EQ(value, 1);
+
+    cache.insert(2, 20);
+
+    ASSERT_TRUE(cache.lookup(2, value));
+    ASSERT_EQ(value, 20);
+
+    auto stats = cache.stats();
+
+    EXPECT_EQ(stats.hits, 2);
+    EXPECT_EQ(stats.misses, 1);
+    EXPECT_EQ(stats.evictions, 0);
+    EXPECT_EQ(stats.size, 2);
+
+    cache.clear();
+
+    ASSERT_EQ(cache.size(), 0);
+    ASSERT_FALSE(cache.lookup(1, value));
+}
+
+TEST(BlockCacheTest, ScanResistance) {
+    BlockCache<std::uint32_t, std::uint64_t> cache(10, 1);
+    std::uint64_t value;
+
+    // hot blocks: admitted and hit again, so protected
+    for (std::uint32_t i = 0; i < 4; ++i) {
+        cache.insert(i, i);
+
+        ASSERT_TRUE(cache.lookup(i, value));
+    }
+
+    // one-time scan much larger than cache
+    for (std::uint32_t i = 1000; i < 2000; ++i)
+        cache.insert(i, i);
+
+    for (std::uint32_t i = 0; i < 4; ++i) {
+        ASSERT_TRUE(cache.lookup(i, value));
+        EXPECT_EQ(value, i);
+    }
+
+    auto stats = cache.stats();
+
+    EXPECT_EQ(stats.size, 10);
+    EXPECT_EQ(stats.evictions, 1000 + 4 - 10);
+}
+
+TEST(BlockCacheTest, Sharded) {
+    BlockCache<std::uint32_t, std::uint64_t> cache(1024, 16);
+    std::uint64_t value;
+
+    for (std::uint32_t i = 0; i < 1024; ++i)
+        cache.insert(i, i);
+
+    for (std::uint32_t i = 0; i < 1024; ++i) {
+        ASSERT_TRUE(cache.lookup(i, value));
+        ASSERT_EQ(value, i);
+    }
+
+    EXPECT_EQ(cache.stats().hits, 1024);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,62 @@
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <util/Crc32c.hpp>
+
+using namespace skv::util;
+
+TEST(Crc32cTest, KnownValues) {
+    const std::string check = "123456789";
+
+    EXPECT_EQ(crc32c(check.data(), check.size()), 0xE3069283u);
+    EXPECT_EQ(crc32cPortable(check.data(), check.size()), 0xE3069283u);
+
+    const std::vector<char> zeros(32, 0);
+    const std::vector<char> ones(32, char(0xFF));
+
+    EXPECT_EQ(crc32c(zeros.data(), zeros.size()), 0x8A9136AAu); // RFC 3720, B.4
+    EXPECT_EQ(crc32c(ones.data(), ones.size()), 0x62A8AB43u);
+
+    EXPECT_EQ(crc32c(nullptr, 0), 0u);
+}
+
+TEST(Crc32cTest, HardwareMatchesPortable) {
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> dist(0, 255);
+    std::vector<char> data(4096 + 7);
+
+    for (auto& c : data)
+        c = char(dist(gen));
+
+    for (std::size_t offset = 0; offset < 8; ++offset) {
+        for (std::size_t size : {0, 1, 7, 8, 9, 63, 64, 1000, 4096}) {
+            EXPECT_EQ(crc32c(data.data() + offset, size), crc32cPortable(data.data() + offset, size));
+        }
+    }
+}
+
+TEST(Crc32cTest, Incremental) {
+    std::vector<char> data(1000);
+
+    for (std::size_t i = 0; i < data.size(); ++i)
+        data[i] = char(i * 31);
+
+    const auto whole = crc32c(data.data(), data.size());
+
+    for (std::size_t split : {0, 1, 13, 500, 999, 1000}) {
+        const auto first = crc32c(data.data(), split);
+
+        EXPECT_EQ(crc32c(data.data() + split, data.size() - split, first), whole);
+        EXPECT_EQ(crc32cPortable(data.data() + split, data.size() - split, crc32cPortable(data.data(), split)), whole);
+    }
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+
+    return RUN_ALL_TESTS();
+}
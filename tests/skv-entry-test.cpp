@@ -229,6 +229,198 @@ TEST(EntryTest, PropertyTest) {
     ASSERT_FALSE(root.hasProperty("not_exist"));
 }
 
+TEST(EntryTest, FlatReadWriteTest) {
+    using namespace std::literals;
+
+    E root{1, "root"};
+    E dev{root.handle() + 1, "dev"};
+    E proc{dev.handle() + 1, "proc"};
+
+    ASSERT_TRUE(root.addChild(proc).isOk());
+    ASSERT_TRUE(root.addChild(dev).isOk());
+
+    root.setProperty("test_str_prop", Property{"some text"});
+    root.setProperty("test_int_prop", Property{123});
+    root.setProperty("test_double_prop", Property{8090.0});
+    root.setProperty("test_blob_prop", Property{std::vector<char>{'a', '\0', 'b'}});
+    root.setProperty("test_expired_prop", Property{std::uint8_t{1}});
+
+    ASSERT_TRUE(root.expireProperty("test_int_prop", 1h).isOk());
+    ASSERT_TRUE(root.expireProperty("test_expired_prop", 0ms).isOk());
+
+    std::vector<char> buffer;
+
+    root.writeFlat(buffer);
+
+    EXPECT_EQ(serializedSize(root), buffer.size());
+
+    auto [status, flat] = E::readFlat(buffer.data(), buffer.size());
+
+    ASSERT_TRUE(status.isOk());
+    EXPECT_EQ(serializedSize(flat), buffer.size());
+
+    // fields are read from buffer
+    EXPECT_EQ(flat.handle(), root.handle());
+    EXPECT_EQ(flat.name(), "root");
+    EXPECT_EQ(flat, root);
+    EXPECT_EQ(flat.childrenCount(), 2);
+    EXPECT_FALSE(flat.hasProperty("test_expired_prop"));
+    EXPECT_FALSE(flat.hasProperty("not_exist"));
+
+    {
+        const auto& [pstatus, value] = flat.property("test_blob_prop");
+
+        ASSERT_TRUE(pstatus.isOk());
+        EXPECT_EQ(value, (Property{std::vector<char>{'a', '\0', 'b'}}));
+    }
+
+    {
+        const auto& [cstatus, handle] = flat.child("proc");
+
+        ASSERT_TRUE(cstatus.isOk());
+        EXPECT_EQ(handle, proc.handle());
+        EXPECT_FALSE(std::get<0>(flat.child("sys")).isOk());
+    }
+
+    // copy of flat record is flat as well, writing it reproduces same bytes
+    E copy = flat;
+    std::vector<char> copyBuffer;
+
+    copy.writeFlat(copyBuffer);
+
+    EXPECT_EQ(copyBuffer, buffer);
+
+    // modification unpacks record, expiration is kept
+    ASSERT_TRUE(flat.setProperty("test_str_prop", Property{"other text"}).isOk());
+    ASSERT_TRUE(flat.removeChild(dev).isOk());
+
+    EXPECT_EQ(std::get<1>(flat.property("test_str_prop")), Property{"other text"});
+    EXPECT_EQ(flat.childrenCount(), 1);
+    EXPECT_EQ(flat.properties().size(), 4);
+
+    std::vector<char> unpacked;
+
+    flat.writeFlat(unpacked);
+
+    EXPECT_EQ(serializedSize(flat), unpacked.size());
+    EXPECT_TRUE(flat.cancelPropertyExpiration("test_int_prop").isOk());
+
+    EXPECT_EQ(copy, root);
+    EXPECT_NE(copy, flat);
+
+    // malformed records aren't read
+    EXPECT_TRUE(std::get<0>(E::readFlat(buffer.data(), buffer.size() - 1)).isCorruption());
+
+    buffer.back() = char(0x80); // handle of last child is truncated
+
+    EXPECT_TRUE(std::get<0>(E::readFlat(buffer.data(), buffer.size())).isCorruption());
+}
+
+TEST(EntryTest, FlatChildrenTest) {
+    E root{1000, "root"};
+    std::vector<E> children;
+
+    // names share prefixes, handles go both up and down
+    for (int i = 0; i < 100; ++i)
+        children.emplace_back((i % 2 == 0)? 2000 + i : 10 + i, "child_" + std::to_string(i * 7 % 100));
+
+    for (auto& c : children)
+        ASSERT_TRUE(root.addChild(c).isOk());
+
+    std::vector<char> buffer;
+
+    root.writeFlat(buffer);
+
+    EXPECT_EQ(serializedSize(root), buffer.size());
+
+    auto [status, flat] = E::readFlat(buffer.data(), buffer.size());
+
+    ASSERT_TRUE(status.isOk());
+    EXPECT_EQ(flat.childrenCount(), children.size());
+    EXPECT_EQ(flat.children(), root.children());
+
+    for (const auto& c : children) {
+        const auto& [cstatus, handle] = flat.child(c.name());
+
+        ASSERT_TRUE(cstatus.isOk()) << c.name();
+        EXPECT_EQ(handle, c.handle());
+    }
+
+    for (const auto& name : {"", "a", "child", "child_", "child_1x", "child_100", "child_99_", "z"})
+        EXPECT_TRUE(std::get<0>(flat.child(name)).isNotFound()) << name;
+
+    // any truncated record is malformed
+    for (std::size_t size = 0; size < buffer.size(); ++size) {
+        auto copy = buffer;
+
+        copy.resize(size);
+
+        if (size >= 8)
+            std::memcpy(copy.data() + 4, &size, 4);
+
+        EXPECT_FALSE(std::get<0>(E::readFlat(copy.data(), copy.size())).isOk());
+    }
+}
+
+TEST(EntryTest, FlatVersion1ReadTest) {
+    // record written in version 1 of flat format: fixed-width fields, no varints
+    std::vector<char> buffer(100);
+    auto put = [&buffer](std::size_t offset, auto value) {
+        std::memcpy(buffer.data() + offset, &value, sizeof(value));
+    };
+
+    put(0, std::uint32_t{0x31464B53});
+    put(4, std::uint32_t{100});
+    put(8, std::uint64_t{7});                   // handle
+    put(16, std::uint64_t{3});                  // parent
+    put(24, std::uint32_t{88});                 // name
+    put(28, std::uint32_t{4});
+    put(32, std::uint32_t{1});                  // properties count
+    put(36, std::uint32_t{1});                  // children count
+    put(40, std::uint32_t{92});                 // property name
+    put(44, std::uint32_t{1});
+    put(48, std::uint32_t{93});                 // property value
+    put(52, std::uint32_t{4});
+    put(56, std::uint16_t{5});                  // int32_t
+    put(64, RecordView::NeverExpires);
+    put(72, std::uint32_t{97});                 // child name
+    put(76, std::uint32_t{3});
+    put(80, std::uint64_t{8});                  // child handle
+    std::memcpy(buffer.data() + 88, "rootp", 5);
+    put(93, std::int32_t{-42});
+    std::memcpy(buffer.data() + 97, "dev", 3);
+
+    auto [status, flat] = E::readFlat(buffer.data(), buffer.size());
+
+    ASSERT_TRUE(status.isOk());
+    EXPECT_EQ(flat.handle(), 7);
+    EXPECT_EQ(flat.parent(), 3);
+    EXPECT_EQ(flat.name(), "root");
+    EXPECT_EQ(std::get<1>(flat.property("p")), Property{std::int32_t{-42}});
+    EXPECT_EQ(std::get<1>(flat.child("dev")), 8);
+    EXPECT_EQ(flat.children().size(), 1);
+
+    // unchanged record is written as is, changed one is written in current version
+    std::vector<char> same;
+
+    flat.writeFlat(same);
+
+    EXPECT_EQ(same, buffer);
+
+    ASSERT_TRUE(flat.setProperty("q", Property{std::uint8_t{1}}).isOk());
+
+    std::vector<char> current;
+
+    flat.writeFlat(current);
+
+    EXPECT_LT(current.size(), buffer.size());
+
+    auto [cstatus, reread] = E::readFlat(current.data(), current.size());
+
+    ASSERT_TRUE(cstatus.isOk());
+    EXPECT_EQ(reread, flat);
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
 
@@ -16,7 +16,7 @@ TEST(IndexRecordTest, Basic) {
 
 
 TEST(IndexRecordTest, ReadWrite) {
-    IndexRecord<> idx1{1, 2, 3};
+    IndexRecord<> idx1{1, 2, 3, 4};
     std::stringstream stream;
 
     stream << idx1;
@@ -1,7 +1,11 @@
+#include <atomic>
 #include <sstream>
+#include <thread>
+#include <vector>
 
 #include <gtest/gtest.h>
 
+#include <ondisk/DenseIndexMap.hpp>
 #include <ondisk/IndexTable.hpp>
 
 using namespace skv::ondisk;
@@ -44,6 +48,237 @@ TEST(IndexTableTest, ReadWrite) {
     ASSERT_EQ(table, rtable);
 }
 
+TEST(IndexTableTest, PackedFootprint) {
+    IndexTable<> table;
+    std::stringstream stream;
+
+    ASSERT_TRUE(table.insert(IndexTable<>::index_record_type(0, 0, 100, 0)));
+    ASSERT_TRUE(table.insert(IndexTable<>::index_record_type(1, 0, 100, 100)));
+    ASSERT_TRUE(table.insert(IndexTable<>::index_record_type(2, 0, 3000, 200)));
+
+    stream << table;
+
+    IndexTable<> padded;
+    padded.setBlockSize(2048);
+
+    stream.seekg(0);
+    stream >> padded;
+
+    EXPECT_EQ(padded.size(), table.size());
+    EXPECT_EQ(padded.diskFootprint(), 3200u);
+    EXPECT_EQ(padded.blockFootprint(), 4u);
+
+    IndexTable<> packed;
+    packed.setBlockSize(2048);
+    packed.setPacked(true);
+
+    stream.seekg(0);
+    stream >> packed;
+
+    EXPECT_EQ(packed.blockFootprint(), 2u);
+    EXPECT_EQ(packed.find(1)->second.blockOffset(), 100u);
+}
+
+TEST(IndexTableTest, LiveFootprint) {
+    using record_type = IndexTable<>::index_record_type;
+
+    IndexTable<> table;
+    table.setBlockSize(1024);
+
+    ASSERT_TRUE(table.insert(record_type(0, 0, 100, 0, 1)));
+    ASSERT_TRUE(table.insert(record_type(1, 1, 2000, 0, 1)));
+    ASSERT_TRUE(table.insert(record_type(2, 0, 500, 0, 2)));
+
+    EXPECT_EQ(table.diskFootprint(), 2600u);
+    EXPECT_EQ(table.blockFootprint(), 4u);
+    EXPECT_EQ(table.segmentFootprint(1), 3072u);
+    EXPECT_EQ(table.segmentFootprint(2), 1024u);
+
+    // overwrite moves record to another segment
+    ASSERT_TRUE(table.insert(record_type(0, 1, 300, 0, 2)));
+
+    EXPECT_EQ(table.diskFootprint(), 2800u);
+    EXPECT_EQ(table.segmentFootprint(1), 2048u);
+    EXPECT_EQ(table.segmentFootprint(2), 2048u);
+
+    table.replace(table.find(2), record_type(2, 3, 500, 0, 3));
+
+    EXPECT_EQ(table.segmentFootprint(2), 1024u);
+    EXPECT_EQ(table.segmentFootprint(3), 1024u);
+
+    ASSERT_NE(table.find(1), std::end(table));
+
+    table.erase(1);
+
+    ASSERT_EQ(table.find(1), std::end(table));
+    EXPECT_EQ(table.diskFootprint(), 800u);
+    EXPECT_EQ(table.segmentFootprint(1), 0u);
+    EXPECT_EQ(table.segmentFootprints().count(1), 0u);
+
+    table.setPacked(true);
+
+    EXPECT_EQ(table.segmentFootprint(2), 300u);
+    EXPECT_EQ(table.segmentFootprint(3), 500u);
+}
+
+TEST(IndexTableTest, DenseLayout) {
+    using dense_table_type = IndexTable<std::uint64_t, std::uint32_t, std::uint32_t, DenseIndexLayout<8>>;
+    using record_type = dense_table_type::index_record_type;
+
+    dense_table_type table;
+    table.setBlockSize(1024);
+
+    EXPECT_TRUE(table.empty());
+    EXPECT_EQ(table.find(0), std::end(table));
+
+    for (std::uint64_t k : {9, 0, 3, 4, 1, 17})
+        ASSERT_TRUE(table.insert(record_type(k, std::uint32_t(k), 100, 0, 1)));
+
+    ASSERT_EQ(table.size(), 6u);
+    EXPECT_EQ(table.diskFootprint(), 600u);
+    EXPECT_EQ(table.segmentFootprint(1), 6u * 1024);
+
+    std::vector<std::uint64_t> keys;
+
+    for (const auto& [key, index] : table) {
+        EXPECT_EQ(key, index.key());
+
+        keys.push_back(key);
+    }
+
+    EXPECT_EQ(keys, (std::vector<std::uint64_t>{0, 1, 3, 4, 9, 17})); // in order of keys
+
+    ASSERT_TRUE(table.insert(record_type(4, 40, 200, 0, 2)));
+    EXPECT_EQ(table.size(), 6u);
+    EXPECT_EQ(table.find(4)->second, record_type(4, 40, 200, 0, 2));
+    EXPECT_EQ(table.diskFootprint(), 700u);
+
+    EXPECT_EQ(table.find(2), std::end(table));
+    EXPECT_EQ(table.find(1000), std::end(table));
+
+    auto next = table.erase(9);
+
+    ASSERT_NE(next, std::end(table));
+    EXPECT_EQ(next->first, 17u);
+    EXPECT_EQ(table.find(9), std::end(table));
+    EXPECT_EQ(table.size(), 5u);
+
+    ASSERT_EQ(table.erase(17), std::end(table));
+    EXPECT_EQ(table.erase(17), std::end(table));
+    EXPECT_EQ(table.diskFootprint(), 500u);
+
+    // same records as hash layout, both layouts read each other's output
+    std::stringstream stream;
+    stream << table;
+
+    IndexTable<> hashed;
+    stream >> hashed;
+
+    ASSERT_EQ(hashed.size(), table.size());
+
+    for (const auto& [key, index] : table)
+        EXPECT_EQ(hashed.find(key)->second, index);
+
+    dense_table_type copy{table};
+
+    EXPECT_EQ(copy, table);
+
+    copy.erase(0);
+
+    EXPECT_FALSE(copy == table);
+}
+
+TEST(IndexTableTest, DenseChunksKept) {
+    using record_type = IndexRecord<std::uint64_t, std::uint32_t, std::uint32_t>;
+
+    DenseIndexMap<std::uint64_t, record_type, 8> map;
+
+    for (std::uint64_t k = 0; k < 64; ++k)
+        ASSERT_TRUE(map.try_emplace(k, record_type(k, 1, 1, 0, 0)).second);
+
+    const auto usage = map.memoryUsage();
+
+    ASSERT_GT(usage, 0u);
+
+    // lock-free readers may hold chunks, so empty chunks aren't released while map is alive
+    for (std::uint64_t k = 0; k < 64; ++k)
+        EXPECT_EQ(map.erase(k), 1u);
+
+    EXPECT_TRUE(map.empty());
+    EXPECT_EQ(map.memoryUsage(), usage);
+
+    record_type index;
+
+    EXPECT_FALSE(map.lookup(3, index));
+
+    ASSERT_TRUE(map.try_emplace(3, record_type(3, 1, 1, 0, 0)).second);
+    EXPECT_EQ(map.memoryUsage(), usage); // slot of kept chunk is reused
+
+    map.clear();
+
+    EXPECT_EQ(map.memoryUsage(), 0u);
+}
+
+TEST(IndexTableTest, DenseConcurrentLookup) {
+    using dense_table_type = IndexTable<std::uint64_t, std::uint32_t, std::uint32_t, DenseIndexLayout<64>>;
+    using record_type = dense_table_type::index_record_type;
+
+    static_assert(dense_table_type::ConcurrentReads);
+
+    constexpr std::uint64_t N = 1000;
+
+    dense_table_type table;
+    std::atomic<bool> stop{false};
+    std::atomic<std::size_t> torn{0};
+    std::vector<std::thread> readers;
+
+    for (std::size_t t = 0; t < 4; ++t) {
+        readers.emplace_back([&] {
+            while (!stop.load()) {
+                for (std::uint64_t k = 0; k < N; ++k) {
+                    record_type index;
+
+                    // every field of record holds the same value, torn copy would mix values
+                    if (table.lookup(k, index) && (index.key() != k || index.blockIndex() != index.bytesCount() ||
+                                                   index.bytesCount() != index.blockOffset() || index.blockOffset() != index.segment()))
+                        ++torn;
+                }
+            }
+        });
+    }
+
+    for (std::uint32_t v = 1; v < 200; ++v) {
+        for (std::uint64_t k = v % 2; k < N; k += 2) // inserts, overwrites and erases
+            ASSERT_TRUE(table.insert(record_type(k, v, v, v, v)));
+
+        for (std::uint64_t k = (v + 1) % 2; k < N; k += 4)
+            table.erase(k);
+    }
+
+    stop = true;
+
+    for (auto& reader : readers)
+        reader.join();
+
+    EXPECT_EQ(torn.load(), 0u);
+}
+
+TEST(IndexTableTest, ReadLegacyFormat) {
+    std::stringstream stream;
+    skv::util::Serializer s{stream};
+
+    s << std::int64_t{2}
+      << std::uint64_t{1} << std::uint32_t{2} << std::uint32_t{3}
+      << std::uint64_t{4} << std::uint32_t{5} << std::uint32_t{6};
+
+    IndexTable<> table;
+    stream >> table;
+
+    ASSERT_EQ(table.size(), 2u);
+    EXPECT_EQ(table.find(1)->second, IndexTable<>::index_record_type(1, 2, 3));
+    EXPECT_EQ(table.find(4)->second, IndexTable<>::index_record_type(4, 5, 6));
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
 
@@ -1,7 +1,12 @@
 #include <algorithm>
 #include <atomic>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <tuple>
 #include <unordered_map>
 #include <thread>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -26,7 +31,7 @@ using namespace skv::ondisk;
 class LogDeviceTest: public ::testing::Test {
 protected:
     void SetUp() override {
-        SKV_UNUSED(os::File::unlink(BLOCK_DEVICE_TMP_FILE));
+        SKV_UNUSED(LogDevice<>::unlink(BLOCK_DEVICE_TMP_FILE));
 
         auto status = device_.open(BLOCK_DEVICE_TMP_FILE, ondisk::LogDevice<>::OpenOption());
 
@@ -38,7 +43,7 @@ protected:
 
         ASSERT_TRUE(status.isOk() && !device_.opened());
 
-        SKV_UNUSED(os::File::unlink(BLOCK_DEVICE_TMP_FILE));
+        SKV_UNUSED(LogDevice<>::unlink(BLOCK_DEVICE_TMP_FILE));
     }
 
     struct IndexRecord {
@@ -156,6 +161,604 @@ TEST_F(LogDeviceTest, ReadWriteTestMTOversubscribtion) {
                   [](auto&& t) { t.join(); });
 }
 
+TEST_F(LogDeviceTest, GroupCommitMT) {
+    ASSERT_TRUE(device_.close().isOk());
+
+    LogDevice<>::OpenOption opts;
+    opts.GroupCommit = true;
+    opts.DurabilityMode = Durability::FsyncEveryN;
+    opts.SyncEveryN = 16;
+
+    ASSERT_TRUE(device_.open(BLOCK_DEVICE_TMP_FILE, opts).isOk());
+
+    const std::size_t nThreads = 2 * std::thread::hardware_concurrency();
+    const std::size_t nAppends = 64;
+    std::vector<std::vector<std::tuple<LogDevice<>::block_index_type, std::size_t, char>>> written(nThreads);
+    std::vector<std::thread> threads;
+
+    for (std::size_t t = 0; t < nThreads; ++t) {
+        threads.emplace_back([this, t, nAppends, &written] {
+            for (std::size_t i = 0; i < nAppends; ++i) {
+                const auto size = (i + 1) * RECORD_GROW_FACTOR;
+                const auto fill = char((t * nAppends + i) % 127);
+                auto [status, blockIdx, blockCnt, blockOff] = device_.append(LogDevice<>::buffer_type(size, fill));
+
+                ASSERT_TRUE(status.isOk());
+                EXPECT_GT(blockCnt, 0u);
+
+                written[t].emplace_back(blockIdx, size, fill);
+            }
+        });
+    }
+
+    std::for_each(std::begin(threads), std::end(threads),
+                  [](auto&& t) { t.join(); });
+
+    std::size_t totalBlocks = 0;
+
+    for (const auto& records : written) {
+        for (const auto& [blockIdx, size, fill] : records) {
+            auto [status, buffer] = device_.read(blockIdx, size);
+
+            ASSERT_TRUE(status.isOk());
+            EXPECT_EQ(buffer, LogDevice<>::buffer_type(size, fill));
+
+            totalBlocks += (size / device_.blockSize()) + (size % device_.blockSize()? 1 : 0);
+        }
+    }
+
+    EXPECT_EQ(totalBlocks, device_.sizeInBlocks()); // no block was written twice
+}
+
+TEST_F(LogDeviceTest, GroupCommitMixedMT) {
+    ASSERT_TRUE(device_.close().isOk());
+
+    LogDevice<>::OpenOption opts;
+    opts.GroupCommit = true;
+
+    ASSERT_TRUE(device_.open(BLOCK_DEVICE_TMP_FILE, opts).isOk());
+
+    // callers which don't wait leave their requests to leader, waiting ones take leadership over
+    const std::size_t nThreads = 2 * std::thread::hardware_concurrency();
+    const std::size_t nAppends = 256;
+    std::vector<std::vector<std::tuple<std::future<LogDevice<>::append_result_type>, std::size_t, char>>> written(nThreads);
+    std::vector<std::thread> threads;
+
+    for (std::size_t t = 0; t < nThreads; ++t) {
+        threads.emplace_back([this, t, nAppends, &written] {
+            for (std::size_t i = 0; i < nAppends; ++i) {
+                const auto size = (i % 16 + 1) * RECORD_GROW_FACTOR;
+                const auto fill = char((t * nAppends + i) % 127);
+
+                if (t % 2 == 0) {
+                    written[t].emplace_back(device_.appendAsync(LogDevice<>::buffer_type(size, fill)), size, fill);
+                }
+                else {
+                    std::promise<LogDevice<>::append_result_type> result;
+
+                    result.set_value(device_.append(LogDevice<>::buffer_type(size, fill)));
+                    written[t].emplace_back(result.get_future(), size, fill);
+                }
+            }
+        });
+    }
+
+    std::for_each(std::begin(threads), std::end(threads),
+                  [](auto&& t) { t.join(); });
+
+    for (auto& records : written) {
+        for (auto& [future, size, fill] : records) {
+            auto [status, blockIdx, blockCnt, blockOff] = future.get();
+
+            ASSERT_TRUE(status.isOk());
+
+            auto [rstatus, buffer] = device_.read(blockIdx, size, blockOff);
+
+            ASSERT_TRUE(rstatus.isOk());
+            EXPECT_EQ(buffer, LogDevice<>::buffer_type(size, fill));
+        }
+    }
+}
+
+TEST_F(LogDeviceTest, AppendAsync) {
+    ASSERT_TRUE(device_.close().isOk());
+
+    LogDevice<>::OpenOption opts;
+    opts.GroupCommit = true;
+    opts.DurabilityMode = Durability::Fsync;
+
+    ASSERT_TRUE(device_.open(BLOCK_DEVICE_TMP_FILE, opts).isOk());
+
+    std::vector<std::future<LogDevice<>::append_result_type>> futures;
+
+    for (std::size_t i = 0; i < N_RECORDS; ++i)
+        futures.push_back(device_.appendAsync(LogDevice<>::buffer_type((i + 1) * RECORD_GROW_FACTOR, char(i + 1))));
+
+    for (std::size_t i = 0; i < N_RECORDS; ++i) {
+        auto [status, blockIdx, blockCnt, blockOff] = futures[i].get();
+
+        ASSERT_TRUE(status.isOk());
+        EXPECT_GT(blockCnt, 0u);
+
+        auto [rstatus, buffer] = device_.read(blockIdx, (i + 1) * RECORD_GROW_FACTOR);
+
+        ASSERT_TRUE(rstatus.isOk());
+        EXPECT_EQ(buffer, LogDevice<>::buffer_type((i + 1) * RECORD_GROW_FACTOR, char(i + 1)));
+    }
+}
+
+TEST_F(LogDeviceTest, DurabilityReopen) {
+    for (auto mode : {Durability::None, Durability::Flush, Durability::Fsync, Durability::FsyncEveryN, Durability::FsyncEveryMs}) {
+        ASSERT_TRUE(device_.close().isOk());
+
+        LogDevice<>::OpenOption opts;
+        opts.DurabilityMode = mode;
+
+        ASSERT_TRUE(device_.open(BLOCK_DEVICE_TMP_FILE, opts).isOk());
+
+        indexTable_.clear();
+        fill();
+
+        ASSERT_TRUE(device_.close().isOk());
+        ASSERT_TRUE(device_.open(BLOCK_DEVICE_TMP_FILE, opts).isOk());
+
+        for (const auto& [key, value] : indexTable_) {
+            auto [status, buffer] = device_.read(value.blockIndex, value.bytesLength);
+
+            ASSERT_TRUE(status.isOk());
+            EXPECT_EQ(buffer, LogDevice<>::buffer_type(value.bytesLength, (key + 1) % 64));
+        }
+    }
+}
+
+TEST_F(LogDeviceTest, AsyncEngines) {
+    for (auto engine : {LogDevice<>::IOEngine::Blocking, LogDevice<>::IOEngine::IoUring}) {
+        ASSERT_TRUE(device_.close().isOk());
+        SKV_UNUSED(LogDevice<>::unlink(BLOCK_DEVICE_TMP_FILE));
+
+        LogDevice<>::OpenOption opts;
+        opts.Engine = engine;
+        opts.IOQueueDepth = 8;
+
+        ASSERT_TRUE(device_.open(BLOCK_DEVICE_TMP_FILE, opts).isOk());
+
+        const std::size_t nRecords = 64;
+        std::vector<std::future<LogDevice<>::append_result_type>> futures;
+
+        for (std::size_t i = 0; i < nRecords; ++i)
+            futures.push_back(device_.appendAsync(LogDevice<>::buffer_type((i + 1) * RECORD_GROW_FACTOR, char(i % 127))));
+
+        std::vector<LogDevice<>::block_index_type> blocks;
+
+        for (auto& f : futures) {
+            auto [status, blockIdx, blockCnt, blockOff] = f.get();
+
+            ASSERT_TRUE(status.isOk());
+            EXPECT_GT(blockCnt, 0u);
+
+            blocks.push_back(blockIdx);
+        }
+
+        std::mutex lock;
+        std::condition_variable cv;
+        std::size_t completed = 0;
+        std::vector<LogDevice<>::buffer_type> buffers(nRecords);
+
+        for (std::size_t i = 0; i < nRecords; ++i) {
+            auto status = device_.readAsync(blocks[i], (i + 1) * RECORD_GROW_FACTOR,
+                                            [&, i](Status status, LogDevice<>::buffer_type buffer) {
+                                                EXPECT_TRUE(status.isOk());
+
+                                                std::unique_lock locker(lock);
+
+                                                buffers[i] = std::move(buffer);
+                                                ++completed;
+
+                                                cv.notify_one();
+                                            });
+
+            ASSERT_TRUE(status.isOk());
+        }
+
+        {
+            std::unique_lock locker(lock);
+
+            cv.wait(locker, [&] { return completed == nRecords; });
+        }
+
+        for (std::size_t i = 0; i < nRecords; ++i)
+            EXPECT_EQ(buffers[i], LogDevice<>::buffer_type((i + 1) * RECORD_GROW_FACTOR, char(i % 127)));
+    }
+}
+
+TEST_F(LogDeviceTest, MemoryMappedView) {
+    for (auto mapped : {false, true}) {
+        ASSERT_TRUE(device_.close().isOk());
+        SKV_UNUSED(LogDevice<>::unlink(BLOCK_DEVICE_TMP_FILE));
+
+        LogDevice<>::OpenOption opts;
+        opts.MemoryMapped = mapped;
+        opts.MappingChunkSize = 4 * opts.BlockSize; // forces remapping while device grows
+
+        ASSERT_TRUE(device_.open(BLOCK_DEVICE_TMP_FILE, opts).isOk());
+
+        std::vector<LogDevice<>::View> views;
+        std::vector<LogDevice<>::block_index_type> blocks;
+        const std::size_t nRecords = 32;
+
+        for (std::size_t i = 0; i < nRecords; ++i) {
+            auto [status, blockIdx, blockCnt, blockOff] = device_.append(LogDevice<>::buffer_type((i + 1) * RECORD_GROW_FACTOR, char(i + 1)));
+
+            ASSERT_TRUE(status.isOk());
+            EXPECT_GT(blockCnt, 0u);
+
+            blocks.push_back(blockIdx);
+
+            auto [vstatus, view] = device_.view(blockIdx, (i + 1) * RECORD_GROW_FACTOR);
+
+            ASSERT_TRUE(vstatus.isOk());
+            ASSERT_EQ(view.size(), (i + 1) * RECORD_GROW_FACTOR);
+
+            views.push_back(std::move(view));
+        }
+
+        for (std::size_t i = 0; i < nRecords; ++i) {
+            auto [status, buffer] = device_.read(blocks[i], (i + 1) * RECORD_GROW_FACTOR);
+
+            ASSERT_TRUE(status.isOk());
+            EXPECT_EQ(buffer, LogDevice<>::buffer_type((i + 1) * RECORD_GROW_FACTOR, char(i + 1)));
+        }
+
+        EXPECT_FALSE(std::get<0>(device_.view(blocks.back() + 64, 1)).isOk());
+
+        ASSERT_TRUE(device_.close().isOk());
+
+        // views stay valid after device closed
+        for (std::size_t i = 0; i < nRecords; ++i)
+            EXPECT_EQ(LogDevice<>::buffer_type(views[i].begin(), views[i].end()), LogDevice<>::buffer_type((i + 1) * RECORD_GROW_FACTOR, char(i + 1)));
+
+        ASSERT_TRUE(device_.open(BLOCK_DEVICE_TMP_FILE, opts).isOk());
+    }
+}
+
+TEST_F(LogDeviceTest, DirectIOBlockCache) {
+    for (auto direct : {false, true}) {
+        ASSERT_TRUE(device_.close().isOk());
+        SKV_UNUSED(LogDevice<>::unlink(BLOCK_DEVICE_TMP_FILE));
+
+        LogDevice<>::OpenOption opts;
+        opts.BlockSize = 4096;
+        opts.DirectIO = direct;
+        opts.BlockCacheSize = 8 * opts.BlockSize;
+        opts.BlockCacheShards = 2;
+
+        ASSERT_TRUE(device_.open(BLOCK_DEVICE_TMP_FILE, opts).isOk());
+
+        indexTable_.clear();
+        fill();
+
+        for (auto pass = 0; pass < 2; ++pass) {
+            for (const auto& [key, value] : indexTable_) {
+                auto [status, buffer] = device_.read(value.blockIndex, value.bytesLength);
+
+                ASSERT_TRUE(status.isOk());
+                EXPECT_EQ(buffer, LogDevice<>::buffer_type(value.bytesLength, (key + 1) % 64));
+            }
+        }
+
+        auto stats = device_.cacheStats();
+
+        EXPECT_EQ(stats.misses, N_RECORDS);
+        EXPECT_EQ(stats.hits, N_RECORDS);
+        EXPECT_EQ(stats.evictions, 0u);
+
+        // records larger than block and than cache itself
+        const std::size_t nRecords = 16;
+        std::vector<LogDevice<>::block_index_type> blocks;
+
+        for (std::size_t i = 0; i < nRecords; ++i) {
+            auto [status, blockIdx, blockCnt, blockOff] = device_.append(LogDevice<>::buffer_type((i + 1) * 1000, char(i + 1)));
+
+            ASSERT_TRUE(status.isOk());
+
+            blocks.push_back(blockIdx);
+        }
+
+        for (std::size_t i = 0; i < nRecords; ++i) {
+            auto [status, buffer] = device_.read(blocks[i], (i + 1) * 1000);
+
+            ASSERT_TRUE(status.isOk());
+            EXPECT_EQ(buffer, LogDevice<>::buffer_type((i + 1) * 1000, char(i + 1)));
+        }
+
+        EXPECT_GT(device_.cacheStats().evictions, 0u);
+        EXPECT_LE(device_.cacheStats().size, device_.cacheStats().capacity);
+
+        ASSERT_TRUE(device_.close().isOk());
+        ASSERT_TRUE(device_.open(BLOCK_DEVICE_TMP_FILE, opts).isOk());
+
+        auto [status, buffer] = device_.read(blocks.back(), nRecords * 1000);
+
+        ASSERT_TRUE(status.isOk());
+        EXPECT_EQ(buffer, LogDevice<>::buffer_type(nRecords * 1000, char(nRecords)));
+    }
+
+    LogDevice<> device;
+    LogDevice<>::OpenOption opts;
+    opts.DirectIO = true; // default block size isn't aligned for direct I/O
+
+    EXPECT_FALSE(device.open(BLOCK_DEVICE_TMP_FILE, opts).isOk());
+}
+
+TEST_F(LogDeviceTest, Preallocation) {
+    ASSERT_TRUE(device_.close().isOk());
+    ASSERT_TRUE(LogDevice<>::unlink(BLOCK_DEVICE_TMP_FILE));
+
+    LogDevice<>::OpenOption opts;
+    opts.PreallocationSize = 1024 * 1024;
+
+    ASSERT_TRUE(device_.open(BLOCK_DEVICE_TMP_FILE, opts).isOk());
+    EXPECT_EQ(device_.sizeInBlocks(), 0u);
+    EXPECT_TRUE(os::fs::exists(BLOCK_DEVICE_TMP_FILE + ".eol"));
+
+    fill();
+
+    const auto blocks = device_.sizeInBlocks();
+
+    for (auto preallocate : {true, false}) {
+        ASSERT_TRUE(device_.close().isOk());
+
+        opts.PreallocationSize = preallocate? 1024 * 1024 : 0;
+
+        ASSERT_TRUE(device_.open(BLOCK_DEVICE_TMP_FILE, opts).isOk());
+        EXPECT_EQ(device_.sizeInBlocks(), blocks);
+
+        for (const auto& [key, value] : indexTable_) {
+            auto [status, buffer] = device_.read(value.blockIndex, value.bytesLength);
+
+            ASSERT_TRUE(status.isOk());
+            EXPECT_EQ(buffer, LogDevice<>::buffer_type(value.bytesLength, (key + 1) % 64));
+        }
+    }
+
+    auto [status, blockIdx, blockCnt, blockOff] = device_.append(LogDevice<>::buffer_type(100, 1));
+
+    ASSERT_TRUE(status.isOk());
+    EXPECT_EQ(blockIdx, blocks);
+    EXPECT_EQ(device_.sizeInBlocks(), blocks + blockCnt);
+
+    ASSERT_TRUE(device_.close().isOk());
+    ASSERT_TRUE(LogDevice<>::unlink(BLOCK_DEVICE_TMP_FILE));
+    EXPECT_FALSE(os::fs::exists(BLOCK_DEVICE_TMP_FILE + ".eol"));
+    ASSERT_TRUE(device_.open(BLOCK_DEVICE_TMP_FILE, LogDevice<>::OpenOption()).isOk());
+}
+
+TEST_F(LogDeviceTest, PackedRecords) {
+    struct Mode {
+        bool memoryMapped;
+        bool directIO;
+        std::uint64_t blockCacheSize;
+    };
+
+    for (auto mode : {Mode{false, false, 0}, Mode{true, false, 0}, Mode{false, false, 64 * 1024}, Mode{false, true, 0}, Mode{false, true, 64 * 1024}}) {
+        ASSERT_TRUE(device_.close().isOk());
+        ASSERT_TRUE(LogDevice<>::unlink(BLOCK_DEVICE_TMP_FILE));
+
+        LogDevice<>::OpenOption opts;
+        opts.BlockSize = 4096;
+        opts.PackRecords = true;
+        opts.MemoryMapped = mode.memoryMapped;
+        opts.DirectIO = mode.directIO;
+        opts.BlockCacheSize = mode.blockCacheSize;
+
+        ASSERT_TRUE(device_.open(BLOCK_DEVICE_TMP_FILE, opts).isOk());
+
+        struct Packed {
+            LogDevice<>::block_index_type blockIndex;
+            LogDevice<>::block_offset_type blockOffset;
+            std::size_t size;
+        };
+
+        std::vector<Packed> records;
+        std::uint64_t bytes = 0;
+
+        for (std::size_t i = 0; i < 64; ++i) {
+            const auto size = (i % 8 == 7)? 5000 : 100 + i * 3; // some records span several blocks
+            auto [status, blockIdx, blockCnt, blockOff] = device_.append(LogDevice<>::buffer_type(size, char(i + 1)));
+
+            ASSERT_TRUE(status.isOk());
+            EXPECT_EQ(blockIdx * 4096 + blockOff, bytes);
+            EXPECT_EQ(blockCnt, (blockOff + size + 4095) / 4096);
+
+            records.push_back({blockIdx, blockOff, size});
+            bytes += size;
+
+            // record sharing block with previous one is readable right after append
+            auto [rstatus, buffer] = device_.read(blockIdx, size, blockOff);
+
+            ASSERT_TRUE(rstatus.isOk());
+            EXPECT_EQ(buffer, LogDevice<>::buffer_type(size, char(i + 1)));
+        }
+
+        EXPECT_EQ(device_.sizeInBytes(), bytes);
+        EXPECT_EQ(device_.sizeInBlocks(), (bytes + 4095) / 4096);
+        EXPECT_EQ(records[1].blockIndex, records[0].blockIndex);
+        EXPECT_GT(records[1].blockOffset, 0u);
+
+        // reading beyond end of log
+        EXPECT_FALSE(std::get<0>(device_.read(records.back().blockIndex, records.back().size + 1, records.back().blockOffset)).isOk());
+
+        ASSERT_TRUE(device_.close().isOk());
+        ASSERT_TRUE(device_.open(BLOCK_DEVICE_TMP_FILE, opts).isOk());
+        EXPECT_EQ(device_.sizeInBytes(), bytes);
+
+        auto [status, blockIdx, blockCnt, blockOff] = device_.append(LogDevice<>::buffer_type(10, char(100)));
+
+        ASSERT_TRUE(status.isOk());
+        EXPECT_EQ(blockIdx * 4096 + blockOff, bytes);
+
+        records.push_back({blockIdx, blockOff, 10});
+
+        for (std::size_t i = 0; i < records.size(); ++i) {
+            auto [vstatus, view] = device_.view(records[i].blockIndex, records[i].size, records[i].blockOffset);
+
+            ASSERT_TRUE(vstatus.isOk());
+            EXPECT_TRUE(std::all_of(view.begin(), view.end(), [c = char(i < 64? i + 1 : 100)](char v) { return v == c; }));
+        }
+    }
+
+    ASSERT_TRUE(device_.close().isOk());
+    ASSERT_TRUE(device_.open(BLOCK_DEVICE_TMP_FILE, LogDevice<>::OpenOption()).isOk());
+}
+
+TEST_F(LogDeviceTest, EndOfLogAfterCrash) {
+    const auto copyPath = BLOCK_DEVICE_TMP_FILE + ".copy";
+
+    ASSERT_TRUE(device_.close().isOk());
+    ASSERT_TRUE(LogDevice<>::unlink(BLOCK_DEVICE_TMP_FILE));
+
+    // direct writes of packed records extend file beyond data, so end of log file is authoritative
+    LogDevice<>::OpenOption opts;
+    opts.BlockSize = 4096;
+    opts.PackRecords = true;
+    opts.DirectIO = true;
+    opts.DurabilityMode = Durability::Flush;
+
+    ASSERT_TRUE(device_.open(BLOCK_DEVICE_TMP_FILE, opts).isOk());
+
+    std::uint64_t bytes = 0;
+
+    for (std::size_t i = 0; i < 16; ++i) {
+        const auto size = 100 + i * 7;
+
+        ASSERT_TRUE(std::get<0>(device_.append(LogDevice<>::buffer_type(size, char(i + 1)))).isOk());
+
+        bytes += size;
+    }
+
+    // process crashes: files are left as they are, device isn't closed
+    os::fs::copy_file(BLOCK_DEVICE_TMP_FILE, copyPath, os::fs::copy_options::overwrite_existing);
+    os::fs::copy_file(BLOCK_DEVICE_TMP_FILE + ".eol", copyPath + ".eol", os::fs::copy_options::overwrite_existing);
+
+    {
+        LogDevice<> recovered;
+
+        ASSERT_TRUE(recovered.open(copyPath, opts).isOk());
+        EXPECT_EQ(recovered.sizeInBytes(), bytes);
+        ASSERT_TRUE(recovered.close().isOk());
+    }
+
+    ASSERT_TRUE(LogDevice<>::unlink(copyPath));
+    ASSERT_TRUE(device_.close().isOk());
+    ASSERT_TRUE(device_.open(BLOCK_DEVICE_TMP_FILE, LogDevice<>::OpenOption()).isOk());
+}
+
+TEST_F(LogDeviceTest, AsyncEndOfLogAfterCrash) {
+    const auto copyPath = BLOCK_DEVICE_TMP_FILE + ".copy";
+
+    ASSERT_TRUE(device_.close().isOk());
+    ASSERT_TRUE(LogDevice<>::unlink(BLOCK_DEVICE_TMP_FILE));
+
+    // async writes complete out of order: end of log and cache see completed ones only
+    LogDevice<>::OpenOption opts;
+    opts.Engine = LogDevice<>::IOEngine::IoUring;
+    opts.IOQueueDepth = 8;
+    opts.PreallocationSize = 64 * 1024;
+    opts.BlockCacheSize = 64 * 1024;
+    opts.DurabilityMode = Durability::Flush;
+
+    ASSERT_TRUE(device_.open(BLOCK_DEVICE_TMP_FILE, opts).isOk());
+
+    const std::size_t nRecords = 64;
+    std::vector<std::future<LogDevice<>::append_result_type>> futures;
+    std::vector<LogDevice<>::block_index_type> blocks;
+
+    for (std::size_t i = 0; i < nRecords; ++i)
+        futures.push_back(device_.appendAsync(LogDevice<>::buffer_type((i + 1) * RECORD_GROW_FACTOR, char(i % 127))));
+
+    for (std::size_t i = 0; i < nRecords; ++i) {
+        auto [status, blockIdx, blockCnt, blockOff] = futures[i].get();
+
+        ASSERT_TRUE(status.isOk());
+
+        auto [rstatus, buffer] = device_.read(blockIdx, (i + 1) * RECORD_GROW_FACTOR);
+
+        ASSERT_TRUE(rstatus.isOk());
+        EXPECT_EQ(buffer, LogDevice<>::buffer_type((i + 1) * RECORD_GROW_FACTOR, char(i % 127)));
+
+        blocks.push_back(blockIdx);
+    }
+
+    // process crashes: files are left as they are, device isn't closed
+    os::fs::copy_file(BLOCK_DEVICE_TMP_FILE, copyPath, os::fs::copy_options::overwrite_existing);
+    os::fs::copy_file(BLOCK_DEVICE_TMP_FILE + ".eol", copyPath + ".eol", os::fs::copy_options::overwrite_existing);
+
+    {
+        LogDevice<> recovered;
+
+        ASSERT_TRUE(recovered.open(copyPath, opts).isOk());
+        EXPECT_EQ(recovered.sizeInBytes(), device_.sizeInBytes());
+
+        for (std::size_t i = 0; i < nRecords; ++i) {
+            auto [status, buffer] = recovered.read(blocks[i], (i + 1) * RECORD_GROW_FACTOR);
+
+            ASSERT_TRUE(status.isOk());
+            EXPECT_EQ(buffer, LogDevice<>::buffer_type((i + 1) * RECORD_GROW_FACTOR, char(i % 127)));
+        }
+
+        ASSERT_TRUE(recovered.close().isOk());
+    }
+
+    ASSERT_TRUE(LogDevice<>::unlink(copyPath));
+    ASSERT_TRUE(device_.close().isOk());
+    ASSERT_TRUE(device_.open(BLOCK_DEVICE_TMP_FILE, LogDevice<>::OpenOption()).isOk());
+}
+
+TEST_F(LogDeviceTest, AppendBatch) {
+    for (bool packed : {false, true}) {
+        ASSERT_TRUE(device_.close().isOk());
+        ASSERT_TRUE(LogDevice<>::unlink(BLOCK_DEVICE_TMP_FILE));
+
+        LogDevice<>::OpenOption opts;
+        opts.PackRecords = packed;
+
+        ASSERT_TRUE(device_.open(BLOCK_DEVICE_TMP_FILE, opts).isOk());
+
+        auto [status, blockIdx, blockCnt, blockOff] = device_.append(LogDevice<>::buffer_type(10, char(1)));
+
+        ASSERT_TRUE(status.isOk());
+
+        std::vector<LogDevice<>::buffer_type> buffers;
+
+        for (std::size_t i = 0; i < 16; ++i)
+            buffers.emplace_back(100 + i * 300, char(i + 2));
+
+        const auto results = device_.appendBatch(buffers.data(), buffers.size());
+
+        ASSERT_EQ(results.size(), buffers.size());
+
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const auto& [bstatus, bblockIdx, bblockCnt, bblockOff] = results[i];
+
+            ASSERT_TRUE(bstatus.isOk());
+
+            auto [rstatus, buffer] = device_.read(bblockIdx, buffers[i].size(), bblockOff);
+
+            ASSERT_TRUE(rstatus.isOk());
+            EXPECT_EQ(buffer, buffers[i]);
+
+            if (i > 0) { // records are placed in order
+                EXPECT_GT(std::make_tuple(bblockIdx, bblockOff), std::make_tuple(std::get<1>(results[i - 1]), std::get<3>(results[i - 1])));
+            }
+        }
+
+        buffers.emplace_back();
+
+        for (const auto& [bstatus, bblockIdx, bblockCnt, bblockOff] : device_.appendBatch(buffers.data(), buffers.size()))
+            EXPECT_FALSE(bstatus.isOk()); // empty buffer fails whole batch
+    }
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
 
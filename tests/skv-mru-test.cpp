@@ -34,6 +34,24 @@ TEST(MRUTest, Basic) {
     ASSERT_FALSE(cache.lookup("2", value));
 }
 
+TEST(MRUTest, RemoveValue) {
+    MRUCache<std::string, std::uint64_t, 4> cache;
+
+    cache.insert("1", 1);
+    cache.insert("2", 2);
+    cache.insert("3", 1);
+
+    ASSERT_EQ(cache.removeValue(1), 2);
+    ASSERT_EQ(cache.removeValue(1), 0);
+    ASSERT_EQ(cache.size(), 1);
+
+    std::uint64_t value;
+
+    ASSERT_FALSE(cache.lookup("1", value));
+    ASSERT_TRUE(cache.lookup("2", value));
+    ASSERT_EQ(value, 2);
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
 
@@ -1,16 +1,29 @@
 #include <array>
 #include <atomic>
 #include <chrono>
+#include <cstdlib>
+#include <random>
+#include <sstream>
 #include <thread>
 
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/stream.hpp>
+
 #include <gtest/gtest.h>
 
+#include <ondisk/ContainerStreamDevice.hpp>
+#include <ondisk/IndexRecord.hpp>
+#include <ondisk/LogDevice.hpp>
+#include <ondisk/Record.hpp>
+#include <ondisk/SegmentedLogDevice.hpp>
+#include <ondisk/StorageEngine.hpp>
 #include <ondisk/Volume.hpp>
 #include <os/File.hpp>
 #include <vfs/Storage.hpp>
 #include <util/String.hpp>
 #include <util/StringPath.hpp>
 #include <util/Log.hpp>
+#include <util/Serialization.hpp>
 #include <util/Unused.hpp>
 
 using namespace skv;
@@ -80,11 +93,11 @@ protected:
     }
 
     void removeFiles() {
-        SKV_UNUSED(os::File::unlink(VOLUME_DIR + char(os::path::separator) + VOLUME_N1_NAME + ".logd"));
+        SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(VOLUME_DIR + char(os::path::separator) + VOLUME_N1_NAME + ".logd"));
         SKV_UNUSED(os::File::unlink(VOLUME_DIR + char(os::path::separator) + VOLUME_N1_NAME+ ".index"));
-        SKV_UNUSED(os::File::unlink(VOLUME_DIR + char(os::path::separator) + VOLUME_N2_NAME + ".logd"));
+        SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(VOLUME_DIR + char(os::path::separator) + VOLUME_N2_NAME + ".logd"));
         SKV_UNUSED(os::File::unlink(VOLUME_DIR + char(os::path::separator) + VOLUME_N2_NAME+ ".index"));
-        SKV_UNUSED(os::File::unlink(VOLUME_DIR + char(os::path::separator) + VOLUME_N3_NAME + ".logd"));
+        SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(VOLUME_DIR + char(os::path::separator) + VOLUME_N3_NAME + ".logd"));
         SKV_UNUSED(os::File::unlink(VOLUME_DIR + char(os::path::separator) + VOLUME_N3_NAME+ ".index"));
     }
 
@@ -520,6 +533,420 @@ TEST_F(VFSStoragePerfomanceTest, LinkUnlinkRecordTest) {
     doUnmounts();
 }
 
+TEST(LogDevicePerfomanceTest, ReadQueueDepth) {
+    using namespace std::chrono;
+    using device_type = ondisk::LogDevice<>;
+
+#ifdef BUILDING_UNIX
+    const std::string DEVICE_PATH = "/tmp/perfdevice.logd";
+#else
+    const std::string DEVICE_PATH = "perfdevice.logd";
+#endif
+    static constexpr std::size_t RECORDS_COUNT = 20000;
+
+    device_type::buffer_type payload;
+
+    {   // record with properties used by VFSStoragePerfomanceTest
+        ondisk::Record record{1, "proc"};
+        std::stringstream stream;
+
+        SKV_UNUSED(record.setProperty("flt_prop",     Property{123.0f}));
+        SKV_UNUSED(record.setProperty("double_prop",  Property{956.0}));
+        SKV_UNUSED(record.setProperty("uint8t_prop",  Property{std::uint8_t{20}}));
+        SKV_UNUSED(record.setProperty("uint32t_prop", Property{std::uint32_t{1024 * 1024 * 1024}}));
+        SKV_UNUSED(record.setProperty("uint64t_prop", Property{std::uint64_t{1024} * 1024 * 1024 * 1024 * 1024}));
+        SKV_UNUSED(record.setProperty("string_prop",  Property{std::string(256, 'a')}));
+        SKV_UNUSED(record.setProperty("blob_prop",    Property{std::vector<char>(1024, 'Z')}));
+
+        stream << record;
+
+        const auto& str = stream.str();
+        payload.assign(std::begin(str), std::end(str));
+    }
+
+    SKV_UNUSED(os::File::unlink(DEVICE_PATH));
+
+    std::vector<device_type::block_index_type> blocks;
+
+    {
+        device_type device;
+
+        ASSERT_TRUE(device.open(DEVICE_PATH, device_type::OpenOption{}).isOk());
+
+        for (std::size_t i = 0; i < RECORDS_COUNT; ++i) {
+            auto [status, blockIdx, blockCnt, blockOff] = device.append(payload);
+
+            ASSERT_TRUE(status.isOk());
+            SKV_UNUSED(blockCnt);
+
+            blocks.push_back(blockIdx);
+        }
+
+        ASSERT_TRUE(device.close().isOk());
+    }
+
+    std::shuffle(std::begin(blocks), std::end(blocks), std::mt19937{42});
+
+    for (auto engine : {device_type::IOEngine::Blocking, device_type::IOEngine::IoUring}) {
+        for (std::uint32_t queueDepth : {1u, 32u}) {
+            device_type device;
+            device_type::OpenOption opts;
+
+            opts.Engine = engine;
+            opts.IOQueueDepth = queueDepth;
+
+            ASSERT_TRUE(device.open(DEVICE_PATH, opts).isOk());
+
+            std::atomic<std::size_t> inflight{0}, completed{0}, failed{0};
+
+            auto startTime = steady_clock::now();
+
+            for (auto blockIdx : blocks) { // one thread keeps up to "queueDepth" reads in flight
+                while (inflight.load(std::memory_order_acquire) >= queueDepth)
+                    std::this_thread::yield();
+
+                inflight.fetch_add(1, std::memory_order_acq_rel);
+
+                auto status = device.readAsync(blockIdx, device_type::bytes_count_type(payload.size()),
+                                               [&](Status status, device_type::buffer_type) {
+                                                   if (!status.isOk())
+                                                       failed.fetch_add(1);
+
+                                                   completed.fetch_add(1, std::memory_order_acq_rel);
+                                                   inflight.fetch_sub(1, std::memory_order_acq_rel);
+                                               });
+
+                ASSERT_TRUE(status.isOk());
+            }
+
+            while (completed.load(std::memory_order_acquire) < blocks.size())
+                std::this_thread::yield();
+
+            auto stopTime = steady_clock::now();
+
+            ASSERT_EQ(failed.load(), 0u);
+
+            auto usElapsed = duration_cast<microseconds>(stopTime - startTime).count();
+            auto tag = std::string("LogDeviceReadQueueDepth [engine: ") +
+                       (device.ioEngine() == device_type::IOEngine::IoUring? "io_uring" : "blocking") +
+                       ", qd: " + std::to_string(queueDepth) + "]";
+
+            Log::i(tag, "readAsync() elapsed time: ", usElapsed / 1000.0, " ms.");
+            Log::i(tag, "readAsync() speed: ", (1000000.0 / std::max<decltype(usElapsed)>(usElapsed, 1)) * RECORDS_COUNT, " read/s");
+
+            ASSERT_TRUE(device.close().isOk());
+        }
+    }
+
+    SKV_UNUSED(os::File::unlink(DEVICE_PATH));
+}
+
+/* Volume size may be set by SKV_RECOVERY_BENCHMARK_SIZE (MiB), e.g. 4096 for multi-GB volume */
+TEST(StorageEnginePerfomanceTest, Recovery) {
+    using namespace std::chrono;
+    using storage_type = ondisk::StorageEngine<>;
+
+#ifdef BUILDING_UNIX
+    const std::string STORAGE_DIR = "/tmp";
+#else
+    const std::string STORAGE_DIR = ".";
+#endif
+    const std::string STORAGE_NAME = "perfrecovery";
+    const auto storagePath = STORAGE_DIR + char(os::path::separator) + STORAGE_NAME;
+
+    std::uint64_t volumeSize = 256 * 1024 * 1024;
+
+    if (const char* size = std::getenv("SKV_RECOVERY_BENCHMARK_SIZE"))
+        volumeSize = std::strtoull(size, nullptr, 10) * 1024 * 1024;
+
+    auto removeFiles = [&storagePath] {
+        SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(storagePath + ".logd"));
+        SKV_UNUSED(os::File::unlink(storagePath + ".index"));
+        SKV_UNUSED(os::File::unlink(storagePath + ".dirty"));
+    };
+
+    removeFiles();
+
+    storage_type storage;
+    storage_type::OpenOptions opts;
+    opts.LogDeviceSegmentSize = 64 * 1024 * 1024;
+
+    static constexpr std::size_t BLOB_SIZE = 64 * 1024;
+    const auto recordsCount = std::max<std::uint64_t>(volumeSize / BLOB_SIZE, 1);
+
+    ondisk::IEntry::Handle lastHandle{0};
+
+    ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+    for (std::uint64_t i = 0; i < recordsCount; ++i) {
+        ondisk::Record record{lastHandle = storage.newKey(), "record"};
+
+        SKV_UNUSED(record.setProperty("blob_prop", Property{std::vector<char>(BLOB_SIZE, char(i))}));
+
+        ASSERT_TRUE(storage.save(record).isOk());
+    }
+
+    ASSERT_TRUE(storage.close().isOk());
+
+    std::uint64_t logSize = 0;
+
+    for (const auto& entry : os::fs::directory_iterator(STORAGE_DIR)) {
+        if (entry.path().filename().string().rfind(STORAGE_NAME + ".logd.", 0) == 0)
+            logSize += os::fs::file_size(entry.path());
+    }
+
+    // crash: index table is lost, storage is left marked
+    ASSERT_TRUE(os::File::unlink(storagePath + ".index"));
+    ASSERT_TRUE(os::File::open(storagePath + ".dirty", "w"));
+
+    const auto startTime = steady_clock::now();
+
+    ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+    const auto usElapsed = std::max<std::int64_t>(duration_cast<microseconds>(steady_clock::now() - startTime).count(), 1);
+
+    EXPECT_TRUE(std::get<0>(storage.load(lastHandle)).isOk());
+
+    ASSERT_TRUE(storage.close().isOk());
+
+    Log::i("StorageEngineRecovery", "log size: ", logSize / (1024 * 1024), " MiB, recovered records: ", recordsCount);
+    Log::i("StorageEngineRecovery", "open() elapsed time: ", usElapsed / 1000.0, " ms.");
+    Log::i("StorageEngineRecovery", "recovery speed: ", (double(logSize) / (1024.0 * 1024 * 1024)) / (usElapsed / 1000000.0), " GB/s");
+
+    removeFiles();
+}
+
+/* Volume size may be set by SKV_COMPACTION_BENCHMARK_SIZE (MiB), e.g. 4096 for 4GB volume */
+TEST(StorageEnginePerfomanceTest, Compaction) {
+    using namespace std::chrono;
+    using storage_type = ondisk::StorageEngine<>;
+
+#ifdef BUILDING_UNIX
+    const std::string STORAGE_DIR = "/tmp";
+#else
+    const std::string STORAGE_DIR = ".";
+#endif
+    const std::string STORAGE_NAME = "perfcompaction";
+    const auto storagePath = STORAGE_DIR + char(os::path::separator) + STORAGE_NAME;
+
+    std::uint64_t volumeSize = 128 * 1024 * 1024;
+
+    if (const char* size = std::getenv("SKV_COMPACTION_BENCHMARK_SIZE"))
+        volumeSize = std::strtoull(size, nullptr, 10) * 1024 * 1024;
+
+    auto removeFiles = [&storagePath] {
+        SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(storagePath + ".logd"));
+        SKV_UNUSED(os::File::unlink(storagePath + ".index"));
+        SKV_UNUSED(os::File::unlink(storagePath + ".compaction"));
+    };
+
+    static constexpr std::size_t BLOB_SIZE = 16 * 1024;
+    const auto recordsCount = std::max<std::uint64_t>(volumeSize / BLOB_SIZE, 2);
+
+    for (std::uint32_t threads : {1u, storage_type::OpenOptions::DefaultCompactionThreads}) {
+        removeFiles();
+
+        storage_type storage;
+        storage_type::OpenOptions opts;
+        opts.CompactionRatio = 0.5;
+        opts.CompactionDeviceMinSize = 0;
+        opts.CompactionOnline = false;
+        opts.CompactionStepSize = std::numeric_limits<std::uint64_t>::max();
+        opts.CompactionThreads = threads;
+        opts.LogDeviceSegmentSize = 64 * 1024 * 1024;
+
+        std::vector<ondisk::IEntry::Handle> handles;
+
+        ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+        for (std::uint64_t i = 0; i < recordsCount; ++i) {
+            ondisk::Record record{storage.newKey(), "record"};
+
+            SKV_UNUSED(record.setProperty("blob_prop", Property{std::vector<char>(BLOB_SIZE, char(i))}));
+
+            ASSERT_TRUE(storage.save(record).isOk());
+
+            handles.push_back(record.handle());
+        }
+
+        // every other record is rewritten, so every segment but last is half garbage
+        for (std::uint64_t i = 0; i < recordsCount; i += 2) {
+            ondisk::Record record{handles[i], "record"};
+
+            SKV_UNUSED(record.setProperty("blob_prop", Property{std::vector<char>(BLOB_SIZE, char(i + 1))}));
+
+            ASSERT_TRUE(storage.save(record).isOk());
+        }
+
+        ASSERT_TRUE(storage.close().isOk());
+
+        const auto startTime = steady_clock::now();
+
+        ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+        const auto usElapsed = std::max<std::int64_t>(duration_cast<microseconds>(steady_clock::now() - startTime).count(), 1);
+        const auto progress = storage.compactionProgress();
+
+        EXPECT_FALSE(progress.running);
+        EXPECT_TRUE(std::get<0>(storage.load(handles.front())).isOk());
+        EXPECT_TRUE(std::get<0>(storage.load(handles.back())).isOk());
+
+        ASSERT_TRUE(storage.close().isOk());
+
+        const auto tag = "StorageEngineCompaction [threads: " + std::to_string(threads) + "]";
+
+        Log::i(tag, "moved: ", progress.totalBytes / (1024 * 1024), " MiB");
+        Log::i(tag, "open() elapsed time: ", usElapsed / 1000.0, " ms.");
+        Log::i(tag, "compaction speed: ", (double(progress.totalBytes) / (1024.0 * 1024)) / (usElapsed / 1000000.0), " MiB/s");
+    }
+
+    removeFiles();
+}
+
+/* Stream format of record: Serializer/Deserializer over iostreams against BufferWriter/BufferReader */
+TEST(SerializationPerfomanceTest, RecordCodecs) {
+    using namespace std::chrono;
+    namespace io = boost::iostreams;
+
+    static constexpr std::size_t ITERATIONS = 5000;
+
+    ondisk::Record record{1, "record"};
+
+    for (std::size_t i = 0; i < 20; ++i)
+        SKV_UNUSED(record.setProperty("property" + std::to_string(i), (i % 2 == 0)? Property{std::uint64_t(i)} : Property{"value" + std::to_string(i)}));
+
+    for (std::size_t i = 0; i < 50; ++i) {
+        ondisk::Record child{2 + i, "child" + std::to_string(i)};
+
+        ASSERT_TRUE(record.addChild(child).isOk());
+    }
+
+    std::vector<char> streamBuffer;
+    std::vector<char> buffer;
+
+    auto measure = [](auto&& f) {
+        const auto startTime = steady_clock::now();
+
+        for (std::size_t i = 0; i < ITERATIONS; ++i)
+            f();
+
+        return std::max<std::int64_t>(duration_cast<microseconds>(steady_clock::now() - startTime).count(), 1);
+    };
+
+    const auto streamWrite = measure([&] {
+        streamBuffer.clear();
+
+        io::stream<ondisk::ContainerStreamDevice<std::vector<char>>> stream(streamBuffer);
+
+        stream << record;
+        stream.flush();
+    });
+
+    const auto bufferWrite = measure([&] {
+        buffer.clear();
+
+        BufferWriter w{buffer};
+
+        w << record;
+    });
+
+    ASSERT_EQ(streamBuffer, buffer);
+
+    const auto streamRead = measure([&] {
+        io::stream<io::array_source> stream(streamBuffer.data(), streamBuffer.size());
+        ondisk::Record read;
+
+        stream >> read;
+    });
+
+    const auto bufferRead = measure([&] {
+        BufferReader r{buffer};
+        ondisk::Record read;
+
+        r >> read;
+    });
+
+    auto speed = [bytes = double(buffer.size() * ITERATIONS) / (1024 * 1024)](std::int64_t us) {
+        return bytes / (us / 1000000.0);
+    };
+
+    Log::i("SerializationRecordCodecs", "record size: ", buffer.size(), " bytes, iterations: ", ITERATIONS);
+    Log::i("SerializationRecordCodecs", "serialize, stream: ", speed(streamWrite), " MiB/s, buffer: ", speed(bufferWrite), " MiB/s, gain: ", double(streamWrite) / bufferWrite);
+    Log::i("SerializationRecordCodecs", "deserialize, stream: ", speed(streamRead), " MiB/s, buffer: ", speed(bufferRead), " MiB/s, gain: ", double(streamRead) / bufferRead);
+}
+
+/* Index records as written to index table checkpoints */
+TEST(SerializationPerfomanceTest, IndexRecordCodecs) {
+    using namespace std::chrono;
+    namespace io = boost::iostreams;
+    using index_record_type = ondisk::IndexRecord<>;
+
+    static constexpr std::size_t RECORDS_COUNT = 1000000;
+
+    std::vector<index_record_type> records;
+
+    for (std::size_t i = 0; i < RECORDS_COUNT; ++i)
+        records.emplace_back(i, std::uint32_t(i * 3), std::uint32_t(i % 4096), std::uint32_t(i % 2048), std::uint32_t(i / 100000));
+
+    std::vector<char> streamBuffer;
+    std::vector<char> buffer;
+    std::vector<index_record_type> streamRead(RECORDS_COUNT);
+    std::vector<index_record_type> bufferRead(RECORDS_COUNT);
+
+    auto measure = [](auto&& f) {
+        const auto startTime = steady_clock::now();
+
+        f();
+
+        return std::max<std::int64_t>(duration_cast<microseconds>(steady_clock::now() - startTime).count(), 1);
+    };
+
+    const auto streamWriteUs = measure([&] {
+        io::stream<ondisk::ContainerStreamDevice<std::vector<char>>> stream(streamBuffer);
+        Serializer s{stream};
+
+        for (const auto& index : records)
+            s << index;
+
+        stream.flush();
+    });
+
+    const auto bufferWriteUs = measure([&] {
+        BufferWriter w{buffer};
+
+        for (const auto& index : records)
+            w << index;
+    });
+
+    ASSERT_EQ(streamBuffer, buffer);
+
+    const auto streamReadUs = measure([&] {
+        io::stream<io::array_source> stream(streamBuffer.data(), streamBuffer.size());
+        Deserializer d{stream};
+
+        for (auto& index : streamRead)
+            d >> index;
+    });
+
+    const auto bufferReadUs = measure([&] {
+        BufferReader r{buffer};
+
+        for (auto& index : bufferRead)
+            r >> index;
+    });
+
+    EXPECT_EQ(streamRead, records);
+    EXPECT_EQ(bufferRead, records);
+
+    auto speed = [bytes = double(buffer.size()) / (1024 * 1024)](std::int64_t us) {
+        return bytes / (us / 1000000.0);
+    };
+
+    Log::i("SerializationIndexRecordCodecs", "records: ", RECORDS_COUNT, ", size: ", buffer.size() / (1024 * 1024), " MiB");
+    Log::i("SerializationIndexRecordCodecs", "serialize, stream: ", speed(streamWriteUs), " MiB/s, buffer: ", speed(bufferWriteUs), " MiB/s, gain: ", double(streamWriteUs) / bufferWriteUs);
+    Log::i("SerializationIndexRecordCodecs", "deserialize, stream: ", speed(streamReadUs), " MiB/s, buffer: ", speed(bufferReadUs), " MiB/s, gain: ", double(streamReadUs) / bufferReadUs);
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
 
@@ -0,0 +1,61 @@
+#include <chrono>
+
+#include <gtest/gtest.h>
+
+#include <util/RateLimiter.hpp>
+
+using namespace skv::util;
+using namespace std::chrono_literals;
+
+TEST(RateLimiterTest, TokenBucket) {
+    TokenBucket<> bucket{1000};
+
+    const auto now = std::chrono::steady_clock::now();
+
+    EXPECT_EQ(bucket.reserve(1000, now), 0ns); // burst is available at once
+
+    const auto wait = bucket.reserve(500, now); // debt
+
+    EXPECT_GT(wait, 490ms);
+    EXPECT_LT(wait, 510ms);
+
+    EXPECT_EQ(bucket.reserve(0, now + 1500ms), 0ns); // debt is repaid and bucket refilled
+    EXPECT_EQ(bucket.reserve(1000, now + 1500ms), 0ns);
+    EXPECT_GT(bucket.reserve(1, now + 1500ms), 0ns);
+}
+
+TEST(RateLimiterTest, Unlimited) {
+    TokenBucket<> bucket;
+    RateLimiter<> limiter;
+
+    EXPECT_TRUE(bucket.unlimited());
+    EXPECT_TRUE(limiter.unlimited());
+
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_EQ(bucket.reserve(1024 * 1024), 0ns);
+        EXPECT_EQ(limiter.reserve(1024 * 1024, 100), 0ns);
+    }
+}
+
+TEST(RateLimiterTest, BytesAndOps) {
+    RateLimiter<> limiter{1024 * 1024, 10};
+
+    const auto now = std::chrono::steady_clock::now();
+
+    EXPECT_EQ(limiter.reserve(1024, 10, now), 0ns);
+
+    // operations are exhausted even though bytes aren't
+    const auto wait = limiter.reserve(1024, 5, now);
+
+    EXPECT_GT(wait, 490ms);
+    EXPECT_LT(wait, 510ms);
+
+    // bytes are exhausted even though operations aren't
+    EXPECT_GT(limiter.reserve(2 * 1024 * 1024, 0, now + 10s), 900ms);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,306 @@
+#include <algorithm>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <ondisk/SegmentedLogDevice.hpp>
+#include <os/File.hpp>
+
+namespace {
+#ifdef BUILDING_UNIX
+const std::string SEGMENTED_DEVICE_TMP_FILE = "/tmp/segmenteddevice.bin";
+#else
+const std::string SEGMENTED_DEVICE_TMP_FILE = "segmenteddevice.bin";
+#endif
+    const std::size_t SEGMENT_SIZE = 16 * 1024;
+}
+
+using namespace skv;
+using namespace skv::util;
+using namespace skv::ondisk;
+
+class SegmentedLogDeviceTest: public ::testing::Test {
+protected:
+    using device_type = SegmentedLogDevice<>;
+
+    struct Address {
+        device_type::segment_index_type segment;
+        device_type::block_index_type blockIndex;
+        device_type::block_offset_type blockOffset;
+        std::size_t size;
+        char fill;
+    };
+
+    void SetUp() override {
+        SKV_UNUSED(device_type::unlink(SEGMENTED_DEVICE_TMP_FILE));
+
+        opts_.SegmentSize = SEGMENT_SIZE;
+
+        ASSERT_TRUE(device_.open(SEGMENTED_DEVICE_TMP_FILE, opts_).isOk() && device_.opened());
+    }
+
+    void TearDown() override {
+        ASSERT_TRUE(device_.close().isOk() && !device_.opened());
+
+        SKV_UNUSED(device_type::unlink(SEGMENTED_DEVICE_TMP_FILE));
+    }
+
+    void fill(std::size_t count) {
+        for (std::size_t i = 0; i < count; ++i) {
+            const auto size = 1000 + i * 10;
+            const auto fill = char(i % 64 + 1);
+            auto [status, segment, blockIdx, blockCnt, blockOff] = device_.append(device_type::buffer_type(size, fill));
+
+            ASSERT_TRUE(status.isOk());
+            EXPECT_GT(blockCnt, 0u);
+
+            addresses_.push_back({segment, blockIdx, blockOff, size, fill});
+        }
+    }
+
+    void verify() {
+        for (const auto& a : addresses_) {
+            auto [status, buffer] = device_.read(a.segment, a.blockIndex, a.size, a.blockOffset);
+
+            ASSERT_TRUE(status.isOk());
+            EXPECT_EQ(buffer, device_type::buffer_type(a.size, a.fill));
+        }
+    }
+
+    device_type device_;
+    device_type::OpenOption opts_;
+    std::vector<Address> addresses_;
+};
+
+TEST_F(SegmentedLogDeviceTest, Roll) {
+    fill(64);
+
+    const auto segments = device_.segments();
+
+    ASSERT_GT(segments.size(), 1u);
+    EXPECT_TRUE(segments.back().active);
+    EXPECT_EQ(device_.activeSegment(), segments.back().index);
+
+    for (const auto& s : segments)
+        EXPECT_LE(s.bytes, SEGMENT_SIZE);
+
+    verify();
+
+    ASSERT_TRUE(device_.close().isOk());
+    ASSERT_TRUE(device_.open(SEGMENTED_DEVICE_TMP_FILE, opts_).isOk());
+
+    EXPECT_EQ(device_.segments().size(), segments.size());
+    EXPECT_EQ(device_.activeSegment(), segments.back().index);
+
+    verify();
+
+    // invalid segment
+    EXPECT_FALSE(std::get<0>(device_.read(device_.activeSegment() + 1, 0, 1)).isOk());
+}
+
+TEST_F(SegmentedLogDeviceTest, UnlinkSegment) {
+    fill(64);
+
+    EXPECT_FALSE(device_.unlinkSegment(device_.activeSegment()).isOk());
+
+    ASSERT_TRUE(device_.unlinkSegment(0).isOk());
+    EXPECT_FALSE(os::fs::exists(device_type::segmentPath(SEGMENTED_DEVICE_TMP_FILE, 0)));
+    EXPECT_FALSE(std::get<0>(device_.read(0, addresses_[0].blockIndex, addresses_[0].size)).isOk());
+
+    addresses_.erase(std::remove_if(std::begin(addresses_), std::end(addresses_), [](auto&& a) { return a.segment == 0; }),
+                     std::end(addresses_));
+
+    verify();
+
+    ASSERT_TRUE(device_.roll().isOk());
+
+    const auto active = device_.activeSegment();
+
+    fill(1);
+
+    EXPECT_EQ(addresses_.back().segment, active);
+
+    ASSERT_TRUE(device_.close().isOk());
+    ASSERT_TRUE(device_.open(SEGMENTED_DEVICE_TMP_FILE, opts_).isOk());
+
+    EXPECT_EQ(device_.segments().front().index, 1u);
+
+    verify();
+}
+
+TEST_F(SegmentedLogDeviceTest, ConcurrentAppends) {
+    const std::size_t nThreads = 4;
+    const std::size_t nRecords = 64;
+    std::vector<std::vector<Address>> addresses(nThreads);
+    std::vector<std::thread> threads;
+
+    for (std::size_t t = 0; t < nThreads; ++t) {
+        threads.emplace_back([this, t, &addresses]() {
+            for (std::size_t i = 0; i < nRecords; ++i) {
+                const auto fill = char(t * nRecords + i);
+                auto [status, segment, blockIdx, blockCnt, blockOff] = device_.append(device_type::buffer_type(3000, fill));
+
+                if (status.isOk())
+                    addresses[t].push_back({segment, blockIdx, blockOff, 3000, fill});
+            }
+        });
+    }
+
+    for (auto& t : threads)
+        t.join();
+
+    for (const auto& a : addresses) {
+        EXPECT_EQ(a.size(), nRecords);
+
+        addresses_.insert(std::end(addresses_), std::begin(a), std::end(a));
+    }
+
+    verify();
+}
+
+TEST_F(SegmentedLogDeviceTest, RollConcurrentAppends) {
+    const std::size_t nThreads = 4;
+    const std::size_t nRecords = 32; // all records fit one segment, so only explicit rolls seal segments
+    std::vector<std::vector<Address>> addresses(nThreads);
+    std::vector<std::tuple<device_type::segment_index_type, std::uint64_t>> sealed;
+    std::vector<std::thread> threads;
+
+    for (std::size_t t = 0; t < nThreads; ++t) {
+        threads.emplace_back([this, t, &addresses]() {
+            for (std::size_t i = 0; i < nRecords; ++i) {
+                const auto fill = char(t * nRecords + i);
+                auto [status, segment, blockIdx, blockCnt, blockOff] = device_.append(device_type::buffer_type(100, fill));
+
+                if (status.isOk())
+                    addresses[t].push_back({segment, blockIdx, blockOff, 100, fill});
+            }
+        });
+    }
+
+    for (std::size_t i = 0; i < 16; ++i) {
+        const auto active = device_.activeSegment();
+
+        ASSERT_TRUE(device_.roll().isOk());
+
+        for (const auto& s : device_.segments()) { // segment is never written once roll is done
+            if (s.index == active && !s.active)
+                sealed.emplace_back(s.index, s.bytes);
+        }
+
+        std::this_thread::yield();
+    }
+
+    for (auto& t : threads)
+        t.join();
+
+    for (const auto& [index, bytes] : sealed) {
+        for (const auto& s : device_.segments()) {
+            if (s.index == index) {
+                EXPECT_EQ(s.bytes, bytes);
+            }
+        }
+    }
+
+    for (const auto& a : addresses) {
+        EXPECT_EQ(a.size(), nRecords);
+
+        addresses_.insert(std::end(addresses_), std::begin(a), std::end(a));
+    }
+
+    verify();
+}
+
+TEST_F(SegmentedLogDeviceTest, SharedBlockCache) {
+    ASSERT_TRUE(device_.close().isOk());
+
+    opts_.BlockCacheSize = 8 * opts_.BlockSize;
+    opts_.BlockCacheShards = 1;
+
+    ASSERT_TRUE(device_.open(SEGMENTED_DEVICE_TMP_FILE, opts_).isOk());
+
+    fill(64);
+
+    ASSERT_GT(device_.segments().size(), 1u);
+
+    verify();
+    verify();
+
+    // one cache serves all segments, its capacity doesn't grow with them
+    const auto stats = device_.cacheStats();
+
+    EXPECT_EQ(stats.capacity, 8u);
+    EXPECT_LE(stats.size, stats.capacity);
+    EXPECT_GT(stats.misses, 0u);
+
+    // blocks of different segments with the same index aren't mixed up
+    addresses_.erase(std::remove_if(std::begin(addresses_), std::end(addresses_), [](auto&& a) { return a.blockIndex != 0; }),
+                     std::end(addresses_));
+
+    ASSERT_GT(addresses_.size(), 1u);
+
+    verify();
+    verify();
+
+    EXPECT_GT(device_.cacheStats().hits, stats.hits);
+}
+
+TEST_F(SegmentedLogDeviceTest, MonolithicDevice) {
+    ASSERT_TRUE(device_.close().isOk());
+    ASSERT_TRUE(device_type::unlink(SEGMENTED_DEVICE_TMP_FILE));
+
+    {
+        LogDevice<> legacy;
+
+        ASSERT_TRUE(legacy.open(SEGMENTED_DEVICE_TMP_FILE, LogDevice<>::OpenOption()).isOk());
+
+        auto [status, blockIdx, blockCnt, blockOff] = legacy.append(LogDevice<>::buffer_type(100, 'a'));
+
+        ASSERT_TRUE(status.isOk());
+
+        addresses_.push_back({0, blockIdx, blockOff, 100, 'a'});
+
+        ASSERT_TRUE(legacy.close().isOk());
+    }
+
+    ASSERT_TRUE(device_.open(SEGMENTED_DEVICE_TMP_FILE, opts_).isOk());
+
+    EXPECT_FALSE(os::fs::exists(SEGMENTED_DEVICE_TMP_FILE));
+    EXPECT_TRUE(os::fs::exists(device_type::segmentPath(SEGMENTED_DEVICE_TMP_FILE, 0)));
+
+    verify();
+}
+
+TEST_F(SegmentedLogDeviceTest, AppendBatch) {
+    std::vector<device_type::buffer_type> buffers;
+
+    for (std::size_t i = 0; i < 64; ++i)
+        buffers.emplace_back(1000 + i * 10, char(i % 64 + 1));
+
+    const auto results = device_.appendBatch(buffers.data(), buffers.size());
+
+    ASSERT_EQ(results.size(), buffers.size());
+
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const auto& [status, segment, blockIdx, blockCnt, blockOff] = results[i];
+
+        ASSERT_TRUE(status.isOk());
+
+        addresses_.push_back({segment, blockIdx, blockOff, buffers[i].size(), buffers[i].front()});
+    }
+
+    // batch is split by segments
+    EXPECT_GT(device_.segments().size(), 1u);
+
+    for (const auto& s : device_.segments())
+        EXPECT_LE(s.bytes, SEGMENT_SIZE);
+
+    verify();
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+
+    return RUN_ALL_TESTS();
+}
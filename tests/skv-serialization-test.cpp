@@ -0,0 +1,248 @@
+#include <cstdint>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <ondisk/IndexRecord.hpp>
+#include <ondisk/IndexTable.hpp>
+#include <ondisk/Record.hpp>
+#include <util/Serialization.hpp>
+
+using namespace skv::ondisk;
+using namespace skv::util;
+
+TEST(SerializationTest, SameEncodingAsSerializer) {
+    const std::string str{"some text"};
+    const std::vector<char> blob{'a', '\0', 'b'};
+
+    std::stringstream stream;
+    Serializer s{stream};
+
+    s << std::uint8_t{1} << std::int16_t{-2} << std::uint32_t{3} << std::int64_t{-4}
+      << 5.5f << 6.25 << str << blob << Property{"prop"} << Property{std::int32_t{7}};
+
+    std::vector<char> buffer;
+    BufferWriter w{buffer};
+
+    w << std::uint8_t{1} << std::int16_t{-2} << std::uint32_t{3} << std::int64_t{-4}
+      << 5.5f << 6.25 << str << blob << Property{"prop"} << Property{std::int32_t{7}};
+
+    const auto expected = stream.str();
+
+    ASSERT_EQ(std::string(buffer.data(), buffer.size()), expected);
+
+    BufferReader r{buffer};
+
+    std::uint8_t u8{0};
+    std::int16_t i16{0};
+    std::uint32_t u32{0};
+    std::int64_t i64{0};
+    float f{0};
+    double d{0};
+    std::string rstr;
+    std::vector<char> rblob;
+    Property p1;
+    Property p2;
+
+    r >> u8 >> i16 >> u32 >> i64 >> f >> d >> rstr >> rblob >> p1 >> p2;
+
+    EXPECT_TRUE(r.good());
+    EXPECT_TRUE(r.eof());
+
+    EXPECT_EQ(u8, 1);
+    EXPECT_EQ(i16, -2);
+    EXPECT_EQ(u32, 3u);
+    EXPECT_EQ(i64, -4);
+    EXPECT_EQ(f, 5.5f);
+    EXPECT_EQ(d, 6.25);
+    EXPECT_EQ(rstr, str);
+    EXPECT_EQ(rblob, blob);
+    EXPECT_EQ(p1, Property{"prop"});
+    EXPECT_EQ(p2, Property{std::int32_t{7}});
+
+    // strings may refer to buffer
+    BufferReader vr{buffer.data() + 31, buffer.size() - 31};
+    std::string_view view;
+
+    vr >> view;
+
+    EXPECT_TRUE(vr.good());
+    EXPECT_EQ(view, str);
+}
+
+TEST(SerializationTest, BoundsChecked) {
+    std::vector<char> buffer;
+    BufferWriter w{buffer};
+
+    w << std::uint64_t{42} << std::string{"text"};
+
+    {
+        BufferReader r{buffer.data(), buffer.size() - 1}; // string truncated
+        std::uint64_t value{0};
+        std::string str{"unchanged"};
+
+        r >> value >> str;
+
+        EXPECT_FALSE(r.good());
+        EXPECT_EQ(value, 42u);
+        EXPECT_TRUE(str.empty());
+    }
+
+    {
+        BufferReader r{buffer.data(), 4}; // integer truncated
+        std::uint64_t value{1};
+
+        r >> value;
+
+        EXPECT_FALSE(r.good());
+        EXPECT_EQ(value, 0u);
+    }
+
+    {
+        std::vector<char> huge;
+        BufferWriter hw{huge};
+
+        hw << std::numeric_limits<std::uint64_t>::max(); // length of string isn't trusted
+
+        BufferReader r{huge};
+        std::string str;
+
+        r >> str;
+
+        EXPECT_FALSE(r.good());
+    }
+
+    {
+        std::vector<char> unknown;
+        BufferWriter uw{unknown};
+
+        uw << std::uint16_t{0xFF} << std::uint64_t{0};
+
+        BufferReader r{unknown};
+        Property p;
+
+        r >> p;
+
+        EXPECT_FALSE(r.good());
+    }
+}
+
+TEST(SerializationTest, Varints) {
+    const std::vector<std::uint64_t> values{0, 1, 127, 128, 300, 16383, 16384, std::uint64_t{1} << 35,
+                                            std::numeric_limits<std::uint64_t>::max() - 1,
+                                            std::numeric_limits<std::uint64_t>::max()};
+    std::vector<char> buffer;
+    BufferWriter w{buffer};
+    std::size_t size = 0;
+
+    for (auto v : values) {
+        w.writeVarint(v);
+        size += varintSize(v);
+    }
+
+    EXPECT_EQ(buffer.size(), size);
+    EXPECT_EQ(varintSize(127), 1u);
+    EXPECT_EQ(varintSize(128), 2u);
+    EXPECT_EQ(varintSize(std::numeric_limits<std::uint64_t>::max()), MaxVarintSize);
+    EXPECT_EQ(buffer[0], '\0');
+    EXPECT_EQ(std::uint8_t(buffer[3]), 0x80);   // 128: low 7 bits with continuation bit
+    EXPECT_EQ(std::uint8_t(buffer[4]), 0x01);
+
+    {
+        BufferReader r{buffer};
+
+        for (auto v : values)
+            EXPECT_EQ(r.readVarint(), v);
+
+        EXPECT_TRUE(r.good());
+        EXPECT_TRUE(r.eof());
+    }
+
+    {
+        BufferReader r{buffer.data(), buffer.size() - 1}; // last varint truncated
+
+        for (std::size_t i = 0; i + 1 < values.size(); ++i)
+            EXPECT_EQ(r.readVarint(), values[i]);
+
+        EXPECT_EQ(r.readVarint(), 0u);
+        EXPECT_FALSE(r.good());
+    }
+
+    {
+        const std::vector<char> overlong(MaxVarintSize, char(0xFF)); // doesn't fit 64 bits
+        BufferReader r{overlong};
+
+        EXPECT_EQ(r.readVarint(), 0u);
+        EXPECT_FALSE(r.good());
+    }
+
+    for (std::int64_t v : {std::int64_t{0}, std::int64_t{-1}, std::int64_t{1}, std::int64_t{-64}, std::int64_t{63},
+                           std::numeric_limits<std::int64_t>::min(), std::numeric_limits<std::int64_t>::max()})
+        EXPECT_EQ(zigzagDecode(zigzagEncode(v)), v);
+
+    EXPECT_EQ(zigzagEncode(-1), 1u);
+    EXPECT_EQ(zigzagEncode(1), 2u);
+}
+
+TEST(SerializationTest, RecordsAndIndexes) {
+    Record root{1, "root"};
+    Record dev{2, "dev"};
+
+    ASSERT_TRUE(root.addChild(dev).isOk());
+    ASSERT_TRUE(root.setProperty("prop", Property{123}).isOk());
+
+    std::stringstream stream;
+
+    stream << root;
+
+    std::vector<char> buffer;
+    BufferWriter w{buffer};
+
+    w << root;
+
+    ASSERT_EQ(std::string(buffer.data(), buffer.size()), stream.str());
+
+    Record read;
+    BufferReader r{buffer};
+
+    r >> read;
+
+    EXPECT_TRUE(r.good());
+    EXPECT_EQ(read, root);
+
+    // malformed record isn't read silently
+    BufferReader tr{buffer.data(), buffer.size() - 1};
+
+    tr >> read;
+
+    EXPECT_FALSE(tr.good());
+
+    IndexTable<> table;
+
+    ASSERT_TRUE(table.insert(IndexRecord<>{1, 2, 3, 4, 5}));
+    ASSERT_TRUE(table.insert(IndexRecord<>{6, 7, 8, 9, 10}));
+
+    std::vector<char> tbuffer;
+    BufferWriter tw{tbuffer};
+
+    tw << table;
+
+    IndexTable<> readTable;
+    BufferReader rt{tbuffer};
+
+    rt >> readTable;
+
+    EXPECT_TRUE(rt.good());
+    EXPECT_TRUE(rt.eof());
+    EXPECT_EQ(readTable, table);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+
+    return RUN_ALL_TESTS();
+}
@@ -1,4 +1,11 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
 #include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -19,9 +26,8 @@ const std::string STORAGE_NAME = "test_storage";
 }
 
 TEST(StorageTest, OpenClose) {
-    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd"));
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd"));
     SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
-    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logdc"));
 
     StorageEngine<> storage;
 
@@ -40,15 +46,13 @@ TEST(StorageTest, OpenClose) {
 
     ASSERT_TRUE(storage.close().isOk());
 
-    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd"));
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd"));
     SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
-    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logdc"));
 }
 
 TEST(StorageTest, Compaction) {
-    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd"));
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd"));
     SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
-    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logdc"));
 
     StorageEngine<> storage;
 
@@ -98,9 +102,1237 @@ TEST(StorageTest, Compaction) {
         ASSERT_TRUE(storage.close().isOk());
     }
 
-    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd"));
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd"));
     SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
-    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logdc"));
+}
+
+TEST(StorageTest, PackedRecords) {
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd"));
+    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
+
+    StorageEngine<> storage;
+
+    StorageEngine<>::OpenOptions opts;
+    opts.LogDevicePackRecords = true;
+
+    std::vector<IEntry::Handle> handles;
+
+    {
+        ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+        for (std::size_t i = 0; i < 128; ++i) {
+            Record record{storage.newKey(), "entry" + std::to_string(i)};
+
+            record.setProperty("value", Property{std::int64_t(i)});
+
+            ASSERT_TRUE(storage.save(record).isOk());
+
+            handles.push_back(record.handle());
+        }
+
+        ASSERT_TRUE(storage.close().isOk());
+    }
+
+    const auto deviceSize = os::fs::file_size(SegmentedLogDevice<>::segmentPath(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd", 0));
+
+    EXPECT_LT(deviceSize, handles.size() * StorageEngine<>::OpenOptions::DefaultLogDeviceBlockSize / 4); // records share blocks
+
+    {
+        ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+        for (std::size_t i = 0; i < handles.size(); ++i) {
+            auto [status, record] = storage.load(handles[i]);
+
+            ASSERT_TRUE(status.isOk());
+            EXPECT_EQ(record.name(), "entry" + std::to_string(i));
+
+            auto [pstatus, value] = record.property("value");
+
+            ASSERT_TRUE(pstatus.isOk());
+            EXPECT_EQ(value, Property{std::int64_t(i)});
+        }
+
+        ASSERT_TRUE(storage.close().isOk());
+    }
+
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd"));
+    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
+}
+
+TEST(StorageTest, SegmentCompaction) {
+    const auto devicePath = STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd";
+
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(devicePath));
+    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
+
+    StorageEngine<> storage;
+
+    StorageEngine<>::OpenOptions opts;
+    opts.CompactionRatio = 0.5;
+    opts.CompactionDeviceMinSize = 0;
+    opts.CompactionOnline = false;
+    opts.LogDeviceSegmentSize = 64 * 1024;
+
+    std::vector<IEntry::Handle> handles;
+
+    {
+        ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+        for (std::size_t i = 0; i < 256; ++i) {
+            Record record{storage.newKey(), "entry" + std::to_string(i)};
+
+            ASSERT_TRUE(storage.save(record).isOk());
+
+            handles.push_back(record.handle());
+        }
+
+        // first half of records is rewritten, so first segments contain only garbage
+        for (std::size_t i = 0; i < handles.size() / 2; ++i) {
+            auto [status, record] = storage.load(handles[i]);
+
+            ASSERT_TRUE(status.isOk());
+            ASSERT_TRUE(storage.save(record).isOk());
+        }
+
+        ASSERT_TRUE(storage.close().isOk());
+    }
+
+    EXPECT_TRUE(os::fs::exists(SegmentedLogDevice<>::segmentPath(devicePath, 0)));
+
+    {
+        ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk()); // sparse segments are compacted
+
+        EXPECT_FALSE(os::fs::exists(SegmentedLogDevice<>::segmentPath(devicePath, 0)));
+
+        for (std::size_t i = 0; i < handles.size(); ++i) {
+            auto [status, record] = storage.load(handles[i]);
+
+            ASSERT_TRUE(status.isOk());
+            EXPECT_EQ(record.name(), "entry" + std::to_string(i));
+        }
+
+        ASSERT_TRUE(storage.close().isOk());
+    }
+
+    {
+        ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+        for (std::size_t i = 0; i < handles.size(); ++i)
+            EXPECT_TRUE(std::get<0>(storage.load(handles[i])).isOk());
+
+        ASSERT_TRUE(storage.close().isOk());
+    }
+
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(devicePath));
+    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
+}
+
+TEST(StorageTest, SpaceUsage) {
+    const auto devicePath = STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd";
+
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(devicePath));
+    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
+
+    StorageEngine<> storage;
+
+    StorageEngine<>::OpenOptions opts;
+    opts.CompactionRatio = 0.5;
+    opts.CompactionDeviceMinSize = 0;
+    opts.CompactionOnline = false;
+    opts.LogDeviceSegmentSize = 64 * 1024;
+
+    std::vector<IEntry::Handle> handles;
+
+    auto checkTotals = [](const StorageEngine<>::SpaceUsage& usage) {
+        std::uint64_t live = 0;
+        std::uint64_t dead = 0;
+        std::uint32_t segments = 0;
+
+        for (const auto& segment : usage.segments) {
+            EXPECT_EQ(segment.bytes, segment.liveBytes + segment.deadBytes);
+
+            live += segment.liveBytes;
+            dead += segment.deadBytes;
+        }
+
+        for (auto count : usage.garbageHistogram)
+            segments += count;
+
+        EXPECT_EQ(usage.liveBytes, live);
+        EXPECT_EQ(usage.deadBytes, dead);
+        EXPECT_EQ(usage.totalBytes, live + dead);
+        EXPECT_EQ(segments, usage.segments.size());
+    };
+
+    ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+    for (std::size_t i = 0; i < 256; ++i) {
+        Record record{storage.newKey(), "entry" + std::to_string(i)};
+
+        ASSERT_TRUE(storage.save(record).isOk());
+
+        handles.push_back(record.handle());
+    }
+
+    const auto initial = storage.spaceUsage();
+
+    checkTotals(initial);
+    EXPECT_GT(initial.liveBytes, 0u);
+    EXPECT_GT(initial.segments.size(), 1u);
+
+    // first half of records is rewritten, some of the rest is removed
+    for (std::size_t i = 0; i < handles.size() / 2; ++i) {
+        auto [status, record] = storage.load(handles[i]);
+
+        ASSERT_TRUE(status.isOk());
+        ASSERT_TRUE(storage.save(record).isOk());
+    }
+
+    for (std::size_t i = handles.size() / 2; i < handles.size(); i += 4)
+        ASSERT_TRUE(storage.remove(handles[i]).isOk());
+
+    const auto fragmented = storage.spaceUsage();
+
+    checkTotals(fragmented);
+    EXPECT_LT(fragmented.liveBytes, initial.liveBytes);
+    EXPECT_GT(fragmented.deadBytes, initial.deadBytes);
+    EXPECT_GT(fragmented.amplification, initial.amplification);
+    EXPECT_GT(fragmented.garbageHistogram.back(), 0u); // first segments contain only garbage
+
+    ASSERT_TRUE(storage.close().isOk());
+    ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk()); // sparse segments are compacted
+
+    const auto compacted = storage.spaceUsage();
+
+    checkTotals(compacted);
+    EXPECT_EQ(compacted.liveBytes, fragmented.liveBytes);
+    EXPECT_LT(compacted.amplification, fragmented.amplification);
+
+    ASSERT_TRUE(storage.close().isOk());
+
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(devicePath));
+    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
+}
+
+TEST(StorageTest, OnlineCompaction) {
+    const auto devicePath = STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd";
+
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(devicePath));
+    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
+
+    StorageEngine<> storage;
+
+    StorageEngine<>::OpenOptions opts;
+    opts.CompactionRatio = 0.5;
+    opts.CompactionDeviceMinSize = 0;
+    opts.CompactionIntervalMs = 10;
+    opts.LogDeviceSegmentSize = 64 * 1024;
+
+    std::vector<IEntry::Handle> handles;
+
+    ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+    for (std::size_t i = 0; i < 256; ++i) {
+        Record record{storage.newKey(), "entry" + std::to_string(i)};
+        record.setProperty("value", Property{std::int64_t(0)});
+
+        ASSERT_TRUE(storage.save(record).isOk());
+
+        handles.push_back(record.handle());
+    }
+
+    std::atomic<bool> done{false};
+    std::atomic<std::size_t> failedLoads{0};
+
+    std::thread reader([&]() {
+        while (!done) {
+            for (auto handle : handles) {
+                if (!std::get<0>(storage.load(handle)).isOk())
+                    ++failedLoads;
+            }
+        }
+    });
+
+    // first half of records is rewritten several times while compaction runs
+    for (std::int64_t round = 1; round <= 4; ++round) {
+        for (std::size_t i = 0; i < handles.size() / 2; ++i) {
+            Record record{handles[i], "entry" + std::to_string(i)};
+            record.setProperty("value", Property{round});
+
+            ASSERT_TRUE(storage.save(record).isOk());
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+
+    // segment 0 holds only garbage now
+    for (int i = 0; i < 500 && os::fs::exists(SegmentedLogDevice<>::segmentPath(devicePath, 0)); ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    done = true;
+    reader.join();
+
+    EXPECT_FALSE(os::fs::exists(SegmentedLogDevice<>::segmentPath(devicePath, 0)));
+    EXPECT_EQ(failedLoads, 0u);
+
+    auto verify = [&]() {
+        for (std::size_t i = 0; i < handles.size(); ++i) {
+            auto [status, record] = storage.load(handles[i]);
+
+            ASSERT_TRUE(status.isOk());
+            EXPECT_EQ(record.name(), "entry" + std::to_string(i));
+
+            auto [pstatus, value] = record.property("value");
+
+            ASSERT_TRUE(pstatus.isOk());
+            EXPECT_EQ(value, Property{std::int64_t(i < handles.size() / 2? 4 : 0)});
+        }
+    };
+
+    verify();
+
+    ASSERT_TRUE(storage.close().isOk());
+    ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+    verify();
+
+    ASSERT_TRUE(storage.close().isOk());
+
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(devicePath));
+    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
+}
+
+TEST(StorageTest, IncrementalCompaction) {
+    const auto devicePath = STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd";
+    const auto jobPath = STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".compaction";
+
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(devicePath));
+    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
+    SKV_UNUSED(os::File::unlink(jobPath));
+
+    StorageEngine<> storage;
+
+    StorageEngine<>::OpenOptions opts;
+    opts.CompactionRatio = 0.5;
+    opts.CompactionDeviceMinSize = 0;
+    opts.CompactionOnline = false;
+    opts.CompactionStepSize = 16 * 1024;
+    opts.CompactionBytesPerSec = 1024 * 1024;
+    opts.CompactionIOPS = 10000;
+    opts.LogDeviceSegmentSize = 64 * 1024;
+
+    std::vector<IEntry::Handle> handles;
+
+    {
+        ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+        for (std::size_t i = 0; i < 128; ++i) {
+            Record record{storage.newKey(), "entry" + std::to_string(i)};
+            record.setProperty("value", Property{std::string(1000, char('a' + i % 26))});
+
+            ASSERT_TRUE(storage.save(record).isOk());
+
+            handles.push_back(record.handle());
+        }
+
+        // every other record is rewritten, so half of every old segment is garbage
+        for (std::size_t i = 0; i < handles.size(); i += 2) {
+            auto [status, record] = storage.load(handles[i]);
+
+            ASSERT_TRUE(status.isOk());
+            ASSERT_TRUE(storage.save(record).isOk());
+        }
+
+        ASSERT_TRUE(storage.close().isOk());
+    }
+
+    {   // first increment
+        ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+        const auto progress = storage.compactionProgress();
+
+        EXPECT_TRUE(progress.running);
+        EXPECT_GT(progress.movedBytes, 0u);
+        EXPECT_LT(progress.movedBytes, progress.totalBytes);
+        EXPECT_GT(progress.bytesPerSec, 0.0);
+        EXPECT_TRUE(os::fs::exists(jobPath));
+        EXPECT_FALSE(os::fs::exists(jobPath + ".tmp")); // job replaces previous one by rename
+        EXPECT_TRUE(os::fs::exists(SegmentedLogDevice<>::segmentPath(devicePath, 0)));
+
+        ASSERT_TRUE(storage.close().isOk());
+    }
+
+    // job is resumed from cursor by every open()
+    std::uint64_t movedBytes = 0;
+
+    for (int i = 0; i < 32 && os::fs::exists(jobPath); ++i) {
+        ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+        const auto progress = storage.compactionProgress();
+
+        if (progress.running) {
+            EXPECT_GT(progress.movedBytes, movedBytes);
+
+            movedBytes = progress.movedBytes;
+        }
+
+        ASSERT_TRUE(storage.close().isOk());
+    }
+
+    EXPECT_FALSE(os::fs::exists(jobPath));
+    EXPECT_FALSE(os::fs::exists(SegmentedLogDevice<>::segmentPath(devicePath, 0)));
+
+    {
+        ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+        EXPECT_FALSE(storage.compactionProgress().running);
+
+        for (std::size_t i = 0; i < handles.size(); ++i) {
+            auto [status, record] = storage.load(handles[i]);
+
+            ASSERT_TRUE(status.isOk());
+            EXPECT_EQ(record.name(), "entry" + std::to_string(i));
+        }
+
+        ASSERT_TRUE(storage.close().isOk());
+    }
+
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(devicePath));
+    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
+}
+
+TEST(StorageTest, SaveBatch) {
+    const auto devicePath = STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd";
+
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(devicePath));
+    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
+
+    StorageEngine<> storage;
+
+    StorageEngine<>::OpenOptions opts;
+    opts.CompactionOnline = false;
+    opts.LogDeviceSegmentSize = 256 * 1024;
+
+    std::vector<Record> records;
+
+    ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+    for (std::size_t i = 0; i < 2000; ++i) // large enough to be serialized in parallel and span segments
+        records.emplace_back(storage.newKey(), "entry" + std::to_string(i));
+
+    ASSERT_TRUE(storage.saveBatch(records).isOk());
+    ASSERT_TRUE(storage.saveBatch(std::vector<Record>{}).isOk());
+    EXPECT_FALSE(storage.saveBatch(std::vector<Record>{Record{}}).isOk());
+
+    // later record of the same key wins
+    std::vector<Record> rewritten{Record{records[0].handle(), "first"}, Record{records[1].handle(), "second"}, Record{records[0].handle(), "third"}};
+
+    ASSERT_TRUE(storage.saveBatch(rewritten).isOk());
+
+    auto check = [&storage, &records] {
+        for (std::size_t i = 0; i < records.size(); ++i) {
+            auto [status, record] = storage.load(records[i].handle());
+
+            ASSERT_TRUE(status.isOk());
+
+            if (i == 0)
+                EXPECT_EQ(record.name(), "third");
+            else if (i == 1)
+                EXPECT_EQ(record.name(), "second");
+            else
+                EXPECT_EQ(record.name(), "entry" + std::to_string(i));
+        }
+    };
+
+    check();
+
+    ASSERT_TRUE(storage.close().isOk());
+    ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+    check();
+
+    ASSERT_TRUE(storage.close().isOk());
+
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(devicePath));
+    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
+}
+
+TEST(StorageTest, LoadBatch) {
+    const auto devicePath = STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd";
+
+    for (bool packed : {false, true}) {
+        SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(devicePath));
+        SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
+
+        StorageEngine<> storage;
+
+        StorageEngine<>::OpenOptions opts;
+        opts.CompactionOnline = false;
+        opts.LogDevicePackRecords = packed;
+        opts.LogDeviceSegmentSize = 256 * 1024;
+
+        ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+        std::vector<IEntry::Handle> keys;
+
+        for (std::size_t i = 0; i < 2000; ++i) {
+            Record record{storage.newKey(), "entry" + std::to_string(i) + std::string(i % 3000, 'x')};
+
+            ASSERT_TRUE(storage.save(record).isOk());
+
+            keys.push_back(record.handle());
+        }
+
+        auto expectedName = [&keys](IEntry::Handle key) {
+            const auto i = std::size_t(std::find(std::begin(keys), std::end(keys), key) - std::begin(keys));
+
+            return "entry" + std::to_string(i) + std::string(i % 3000, 'x');
+        };
+
+        auto batch = keys;
+
+        std::reverse(std::begin(batch), std::end(batch));
+        batch.push_back(keys[10]);                  // duplicate
+        batch.push_back(StorageEngine<>::InvalidEntryId);
+        batch.push_back(keys.back() + 1000);        // doesn't exist
+
+        const auto results = storage.loadBatch(batch);
+
+        ASSERT_EQ(results.size(), batch.size());
+
+        for (std::size_t i = 0; i < keys.size() + 1; ++i) {
+            const auto& [status, record] = results[i];
+
+            ASSERT_TRUE(status.isOk());
+            EXPECT_EQ(record.handle(), batch[i]);
+            EXPECT_EQ(record.name(), expectedName(batch[i]));
+        }
+
+        EXPECT_FALSE(std::get<0>(results[keys.size() + 1]).isOk());
+        EXPECT_FALSE(std::get<0>(results[keys.size() + 2]).isOk());
+
+        EXPECT_TRUE(storage.loadBatch({}).empty());
+
+        ASSERT_TRUE(storage.close().isOk());
+
+        EXPECT_TRUE(std::get<0>(storage.loadBatch({keys[0]}).front()).isIOError());
+    }
+
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(devicePath));
+    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
+}
+
+TEST(StorageTest, DenseIndex) {
+    using storage_type = StorageEngine<std::uint32_t, std::uint32_t, 0, 1, DenseIndexLayout<64>>;
+
+    const auto devicePath = STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd";
+
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(devicePath));
+    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
+
+    storage_type storage;
+
+    storage_type::OpenOptions opts;
+    opts.CompactionRatio = 0.5;
+    opts.CompactionDeviceMinSize = 0;
+    opts.CompactionOnline = false;
+    opts.LogDeviceSegmentSize = 64 * 1024;
+
+    std::vector<IEntry::Handle> handles;
+
+    ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+    for (std::size_t i = 0; i < 500; ++i) {
+        Record record{storage.newKey(), "entry" + std::to_string(i)};
+
+        ASSERT_TRUE(storage.save(record).isOk());
+
+        handles.push_back(record.handle());
+    }
+
+    for (std::size_t i = 0; i < handles.size(); i += 2)
+        ASSERT_TRUE(storage.remove(handles[i]).isOk());
+
+    ASSERT_TRUE(storage.close().isOk());
+    ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk()); // sparse segments are compacted
+
+    for (std::size_t i = 0; i < handles.size(); ++i) {
+        auto [status, record] = storage.load(handles[i]);
+
+        if (i % 2 == 0)
+            EXPECT_FALSE(status.isOk());
+        else {
+            ASSERT_TRUE(status.isOk());
+            EXPECT_EQ(record.name(), "entry" + std::to_string(i));
+        }
+    }
+
+    ASSERT_TRUE(storage.close().isOk());
+
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(devicePath));
+    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
+}
+
+namespace {
+
+/* Readers load records while they are rewritten and removed; records saved by one batch are seen by loadBatch() together */
+template <typename Storage>
+void concurrentReads() {
+    const auto devicePath = STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd";
+
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(devicePath));
+    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
+
+    Storage storage;
+
+    typename Storage::OpenOptions opts;
+    opts.CompactionOnline = false;
+
+    ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+    constexpr std::size_t N = 256;
+    std::vector<IEntry::Handle> singles;
+    std::vector<IEntry::Handle> pairs;
+
+    for (std::size_t i = 0; i < N; ++i) {
+        singles.push_back(storage.newKey());
+        pairs.push_back(storage.newKey());
+        pairs.push_back(storage.newKey());
+
+        ASSERT_TRUE(storage.save(Record{singles.back(), "0"}).isOk());
+        ASSERT_TRUE(storage.saveBatch(std::vector<Record>{Record{pairs[2 * i], "0"}, Record{pairs[2 * i + 1], "0"}}).isOk());
+    }
+
+    std::atomic<bool> stop{false};
+    std::atomic<std::size_t> errors{0};
+    std::vector<std::thread> threads;
+
+    for (std::size_t t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            for (std::size_t i = t; !stop.load(); i = (i + 7) % N) {
+                auto [status, record] = storage.load(singles[i]);
+
+                if (status.isOk() && record.handle() != singles[i])
+                    ++errors;
+
+                auto results = storage.loadBatch({pairs[2 * i], pairs[2 * i + 1]});
+                const auto& [status1, record1] = results[0];
+                const auto& [status2, record2] = results[1];
+
+                if (status1.isOk() != status2.isOk() || (status1.isOk() && record1.name() != record2.name()))
+                    ++errors;
+            }
+        });
+    }
+
+    threads.emplace_back([&] {
+        for (std::size_t v = 1; v < 60; ++v) {
+            for (std::size_t i = 0; i < N; i += 3) {
+                const auto name = std::to_string(v);
+
+                if (!storage.saveBatch(std::vector<Record>{Record{pairs[2 * i], name}, Record{pairs[2 * i + 1], name}}).isOk())
+                    ++errors;
+            }
+        }
+    });
+
+    threads.emplace_back([&] {
+        for (std::size_t v = 1; v < 60; ++v) {
+            for (std::size_t i = 0; i < N; i += 5) {
+                if (v % 2 == 0)
+                    SKV_UNUSED(storage.remove(singles[i]));
+                else if (!storage.save(Record{singles[i], std::to_string(v)}).isOk())
+                    ++errors;
+            }
+        }
+    });
+
+    threads[5].join();
+    threads[4].join();
+
+    ASSERT_TRUE(storage.close().isOk()); // readers are still running
+    stop = true;
+
+    for (std::size_t t = 0; t < 4; ++t)
+        threads[t].join();
+
+    EXPECT_EQ(errors.load(), 0u);
+
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(devicePath));
+    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
+}
+
+}
+
+TEST(StorageTest, ConcurrentReads) {
+    concurrentReads<StorageEngine<>>();
+    concurrentReads<StorageEngine<std::uint32_t, std::uint32_t, 0, 1, DenseIndexLayout<>>>();
+}
+
+TEST(StorageTest, Checksum) {
+    const auto devicePath = STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd";
+
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(devicePath));
+    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
+
+    StorageEngine<> storage;
+    IEntry::Handle handle;
+
+    {
+        ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME).isOk());
+
+        Record record{storage.newKey(), "entry"};
+        record.setProperty("value", Property{std::string(1000, 'x')});
+
+        ASSERT_TRUE(storage.save(record).isOk());
+
+        handle = record.handle();
+
+        ASSERT_TRUE(storage.close().isOk());
+    }
+
+    {
+        ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME).isOk());
+        ASSERT_TRUE(std::get<0>(storage.load(handle)).isOk());
+        ASSERT_TRUE(storage.close().isOk());
+    }
+
+    {   // flipping one byte of entry payload (root entry occupies first block)
+        auto file = os::File::open(SegmentedLogDevice<>::segmentPath(devicePath, 0), "rb+");
+
+        ASSERT_TRUE(file);
+
+        char c;
+        const auto offset = std::int64_t(StorageEngine<>::OpenOptions::DefaultLogDeviceBlockSize + 500);
+
+        ASSERT_EQ(os::File::pread(file, &c, 1, offset), 1u);
+
+        c = char(~c);
+
+        ASSERT_EQ(os::File::pwrite(file, &c, 1, offset), 1u);
+    }
+
+    {
+        ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME).isOk());
+
+        auto [status, record] = storage.load(handle);
+
+        EXPECT_TRUE(status.isCorruption());
+        EXPECT_TRUE(std::get<0>(storage.load(StorageEngine<>::RootEntryId)).isOk());
+
+        ASSERT_TRUE(storage.close().isOk());
+    }
+
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(devicePath));
+    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
+}
+
+TEST(StorageTest, Recovery) {
+    const auto devicePath = STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd";
+    const auto indexPath = STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index";
+    const auto dirtyPath = STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".dirty";
+
+    auto verify = [](StorageEngine<>& storage, const std::vector<IEntry::Handle>& handles) {
+        for (std::size_t i = 0; i < handles.size(); ++i) {
+            auto [status, record] = storage.load(handles[i]);
+
+            if (i >= 16 && i < 32) { // removed
+                EXPECT_FALSE(status.isOk());
+
+                continue;
+            }
+
+            ASSERT_TRUE(status.isOk());
+
+            auto [pstatus, value] = record.property("value");
+
+            ASSERT_TRUE(pstatus.isOk());
+            EXPECT_EQ(value, Property{std::int64_t(i < 16? i + 1000 : i)});
+        }
+
+        EXPECT_GT(storage.newKey(), handles.back());
+    };
+
+    for (bool packed : {false, true}) {
+        SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(devicePath));
+        SKV_UNUSED(os::File::unlink(indexPath));
+        SKV_UNUSED(os::File::unlink(dirtyPath));
+
+        StorageEngine<> storage;
+
+        StorageEngine<>::OpenOptions opts;
+        opts.LogDevicePackRecords = packed;
+        opts.LogDeviceSegmentSize = 64 * 1024;
+
+        std::vector<IEntry::Handle> handles;
+
+        auto save = [&storage, &handles](std::size_t i, std::int64_t value) {
+            if (i == handles.size())
+                handles.push_back(storage.newKey());
+
+            Record record{handles[i], "entry" + std::to_string(i)};
+            record.setProperty("value", Property{value});
+
+            return storage.save(record);
+        };
+
+        {   // checkpoint
+            ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+            EXPECT_TRUE(os::fs::exists(dirtyPath));
+
+            for (std::size_t i = 0; i < 64; ++i)
+                ASSERT_TRUE(save(i, std::int64_t(i)).isOk());
+
+            ASSERT_TRUE(storage.close().isOk());
+            EXPECT_FALSE(os::fs::exists(dirtyPath));
+        }
+
+        os::fs::copy_file(indexPath, indexPath + ".bak", os::fs::copy_options::overwrite_existing);
+
+        {   // changes after checkpoint
+            ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+            for (std::size_t i = 0; i < 16; ++i)
+                ASSERT_TRUE(save(i, std::int64_t(i + 1000)).isOk());
+
+            for (std::size_t i = 16; i < 32; ++i)
+                ASSERT_TRUE(storage.remove(handles[i]).isOk());
+
+            for (std::size_t i = 64; i < 80; ++i)
+                ASSERT_TRUE(save(i, std::int64_t(i)).isOk());
+
+            ASSERT_TRUE(storage.close().isOk());
+        }
+
+        // crash before index table was saved: stale index table, storage left marked
+        os::fs::copy_file(indexPath + ".bak", indexPath, os::fs::copy_options::overwrite_existing);
+        ASSERT_TRUE(os::File::open(dirtyPath, "w"));
+
+        {
+            ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+            verify(storage, handles);
+
+            ASSERT_TRUE(storage.close().isOk());
+        }
+
+        // index table lost: whole log is replayed
+        ASSERT_TRUE(os::File::unlink(indexPath));
+        ASSERT_TRUE(os::File::open(dirtyPath, "w"));
+
+        {
+            ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+            verify(storage, handles);
+
+            ASSERT_TRUE(storage.close().isOk());
+        }
+
+        SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(devicePath));
+        SKV_UNUSED(os::File::unlink(indexPath));
+        SKV_UNUSED(os::File::unlink(indexPath + ".bak"));
+    }
+}
+
+TEST(StorageTest, IndexCheckpoints) {
+    const auto devicePath = STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd";
+    const auto indexPath = STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index";
+    const auto dirtyPath = STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".dirty";
+    const auto deltaPath = [&indexPath](std::size_t n) { return indexPath + "." + std::to_string(n); };
+
+    auto cleanup = [&] {
+        SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(devicePath));
+        SKV_UNUSED(os::File::unlink(indexPath));
+        SKV_UNUSED(os::File::unlink(dirtyPath));
+
+        for (std::size_t n = 1; n <= 16; ++n) {
+            SKV_UNUSED(os::File::unlink(deltaPath(n)));
+            SKV_UNUSED(os::File::unlink(deltaPath(n) + ".bak"));
+        }
+
+        SKV_UNUSED(os::File::unlink(indexPath + ".bak"));
+    };
+
+    cleanup();
+
+    StorageEngine<> storage;
+    StorageEngine<>::OpenOptions opts;
+    opts.CompactionOnline = false;
+    opts.CheckpointIntervalMs = 0;
+    opts.LogDeviceSegmentSize = 64 * 1024;
+
+    std::vector<IEntry::Handle> handles;
+    std::vector<std::int64_t> values;
+
+    auto save = [&](std::size_t i, std::int64_t value) {
+        if (i == handles.size()) {
+            handles.push_back(storage.newKey());
+            values.push_back(value);
+        }
+
+        values[i] = value;
+
+        Record record{handles[i], "entry" + std::to_string(i)};
+        record.setProperty("value", Property{value});
+
+        return storage.save(record);
+    };
+
+    auto verify = [&] {
+        for (std::size_t i = 0; i < handles.size(); ++i) {
+            auto [status, record] = storage.load(handles[i]);
+
+            if (values[i] < 0) { // removed
+                EXPECT_FALSE(status.isOk());
+
+                continue;
+            }
+
+            ASSERT_TRUE(status.isOk());
+
+            auto [pstatus, value] = record.property("value");
+
+            ASSERT_TRUE(pstatus.isOk());
+            EXPECT_EQ(value, Property{values[i]});
+        }
+
+        EXPECT_GT(storage.newKey(), handles.back());
+    };
+
+    ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+    for (std::size_t i = 0; i < 256; ++i)
+        ASSERT_TRUE(save(i, std::int64_t(i)).isOk());
+
+    ASSERT_TRUE(storage.close().isOk());
+    EXPECT_FALSE(os::fs::exists(deltaPath(1)));
+
+    // few changes are written as deltas, full index table stays as it is
+    const auto indexSize = os::fs::file_size(indexPath);
+
+    for (std::size_t n = 1; n <= 4; ++n) {
+        ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+        verify();
+
+        for (std::size_t i = 0; i < 8; ++i)
+            ASSERT_TRUE(save(n * 8 + i, std::int64_t(n * 1000 + i)).isOk());
+
+        ASSERT_TRUE(storage.remove(handles[100 + n]).isOk());
+        values[100 + n] = -1;
+
+        ASSERT_TRUE(save(handles.size(), std::int64_t(n)).isOk());
+
+        ASSERT_TRUE(storage.close().isOk());
+
+        EXPECT_TRUE(os::fs::exists(deltaPath(n)));
+        EXPECT_FALSE(os::fs::exists(deltaPath(n + 1)));
+        EXPECT_EQ(os::fs::file_size(indexPath), indexSize);
+    }
+
+    // checkpoints in background: after crash only log since the last one is replayed
+    opts.CheckpointIntervalMs = 10;
+
+    ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+    verify();
+
+    for (std::size_t i = 0; i < 8; ++i)
+        ASSERT_TRUE(save(200 + i, std::int64_t(5000 + i)).isOk());
+
+    ASSERT_TRUE(storage.remove(handles[150]).isOk());
+    values[150] = -1;
+
+    for (int i = 0; i < 500 && !os::fs::exists(deltaPath(5)); ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    ASSERT_TRUE(os::fs::exists(deltaPath(5)));
+
+    os::fs::copy_file(indexPath, indexPath + ".bak", os::fs::copy_options::overwrite_existing);
+
+    for (std::size_t n = 1; n <= 5; ++n)
+        os::fs::copy_file(deltaPath(n), deltaPath(n) + ".bak", os::fs::copy_options::overwrite_existing);
+
+    for (std::size_t i = 0; i < 8; ++i)
+        ASSERT_TRUE(save(210 + i, std::int64_t(6000 + i)).isOk());
+
+    ASSERT_TRUE(storage.remove(handles[160]).isOk());
+    values[160] = -1;
+
+    ASSERT_TRUE(storage.close().isOk());
+
+    // crash right after background checkpoint: later checkpoints are lost, storage left marked
+    for (std::size_t n = 1; n <= 16; ++n)
+        SKV_UNUSED(os::File::unlink(deltaPath(n)));
+
+    os::fs::copy_file(indexPath + ".bak", indexPath, os::fs::copy_options::overwrite_existing);
+
+    for (std::size_t n = 1; n <= 5; ++n)
+        os::fs::copy_file(deltaPath(n) + ".bak", deltaPath(n), os::fs::copy_options::overwrite_existing);
+
+    ASSERT_TRUE(os::File::open(dirtyPath, "w"));
+
+    opts.CheckpointIntervalMs = 0;
+
+    ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+    verify();
+
+    ASSERT_TRUE(storage.close().isOk());
+
+    // broken delta: log is replayed from the previous checkpoint, chain is replaced by full index table
+    {
+        std::fstream stream{deltaPath(6), std::ios_base::in | std::ios_base::out | std::ios_base::binary};
+
+        ASSERT_TRUE(stream.is_open());
+
+        stream.seekp(-4, std::ios_base::end);
+        stream.write("\0\0\0\0", 4);
+    }
+
+    ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+    EXPECT_FALSE(os::fs::exists(deltaPath(1)));
+
+    verify();
+
+    ASSERT_TRUE(storage.close().isOk());
+
+    // long chain of deltas is replaced by full index table
+    for (std::size_t n = 0; n < 20; ++n) {
+        ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+        ASSERT_TRUE(save(n, std::int64_t(7000 + n)).isOk());
+        ASSERT_TRUE(storage.close().isOk());
+    }
+
+    EXPECT_FALSE(os::fs::exists(deltaPath(16)));
+
+    ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+    verify();
+
+    ASSERT_TRUE(storage.close().isOk());
+
+    cleanup();
+}
+
+TEST(StorageTest, CheckpointConcurrentSaves) {
+    const auto devicePath = STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd";
+    const auto indexPath = STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index";
+
+    auto cleanup = [&] {
+        SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(devicePath));
+        SKV_UNUSED(os::File::unlink(indexPath));
+
+        for (std::size_t n = 1; n <= 16; ++n)
+            SKV_UNUSED(os::File::unlink(indexPath + "." + std::to_string(n)));
+    };
+
+    cleanup();
+
+    StorageEngine<> storage;
+    StorageEngine<>::OpenOptions opts;
+    opts.CompactionOnline = false;
+    opts.CheckpointIntervalMs = 1; // full table and deltas are written while records are saved
+
+    ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+    const std::size_t nThreads = 4;
+    const std::size_t nRecords = 512;
+    std::vector<std::vector<IEntry::Handle>> handles(nThreads);
+    std::vector<std::thread> threads;
+
+    for (std::size_t t = 0; t < nThreads; ++t) {
+        threads.emplace_back([&storage, &handles, t] {
+            for (std::size_t i = 0; i < nRecords; ++i) {
+                Record record{storage.newKey(), "entry" + std::to_string(t * nRecords + i)};
+
+                if (storage.save(record).isOk())
+                    handles[t].push_back(record.handle());
+            }
+        });
+    }
+
+    for (auto& t : threads)
+        t.join();
+
+    ASSERT_TRUE(storage.close().isOk());
+    ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+    for (std::size_t t = 0; t < nThreads; ++t) {
+        ASSERT_EQ(handles[t].size(), nRecords);
+
+        for (std::size_t i = 0; i < nRecords; ++i) {
+            auto [status, record] = storage.load(handles[t][i]);
+
+            ASSERT_TRUE(status.isOk());
+            EXPECT_EQ(record.name(), "entry" + std::to_string(t * nRecords + i));
+        }
+    }
+
+    ASSERT_TRUE(storage.close().isOk());
+
+    cleanup();
+}
+
+TEST(StorageTest, IndexTableFile) {
+    const auto devicePath = STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd";
+    const auto indexPath = STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index";
+
+    using Storage = StorageEngine<>;
+
+    for (bool dense : {false, true}) {
+        SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(devicePath));
+        SKV_UNUSED(os::File::unlink(indexPath));
+
+        auto test = [&](auto& storage) {
+            typename std::decay_t<decltype(storage)>::OpenOptions opts;
+            opts.CompactionOnline = false;
+            opts.CheckpointIntervalMs = 0;
+
+            std::vector<IEntry::Handle> handles;
+
+            ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+            for (std::size_t i = 0; i < 1000; ++i) {
+                handles.push_back(storage.newKey());
+
+                Record record{handles.back(), "entry" + std::to_string(i)};
+                record.setProperty("value", Property{std::int64_t(i)});
+
+                ASSERT_TRUE(storage.save(record).isOk());
+            }
+
+            ASSERT_TRUE(storage.close().isOk());
+
+            // header and fixed size records (root record included)
+            const auto size = os::fs::file_size(indexPath);
+
+            EXPECT_EQ(size, 64 + 1001 * sizeof(Storage::index_record_type));
+
+            auto verify = [&] {
+                ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+                for (std::size_t i = 0; i < handles.size(); ++i) {
+                    auto [status, record] = storage.load(handles[i]);
+
+                    ASSERT_TRUE(status.isOk());
+                    EXPECT_EQ(record.name(), "entry" + std::to_string(i));
+                }
+
+                EXPECT_GT(storage.newKey(), handles.back());
+
+                ASSERT_TRUE(storage.close().isOk());
+            };
+
+            verify();
+
+            // truncated index table: whole log is replayed
+            os::fs::resize_file(indexPath, size - 10);
+
+            verify();
+
+            EXPECT_EQ(os::fs::file_size(indexPath), size);
+        };
+
+        if (dense) {
+            StorageEngine<std::uint32_t, std::uint32_t, 0, 1, DenseIndexLayout<>> storage;
+
+            test(storage);
+        }
+        else {
+            Storage storage;
+
+            test(storage);
+        }
+
+        SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(devicePath));
+        SKV_UNUSED(os::File::unlink(indexPath));
+    }
+}
+
+TEST(StorageTest, KeyReuse) {
+    const auto devicePath = STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd";
+    const auto indexPath = STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index";
+    const auto dirtyPath = STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".dirty";
+
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(devicePath));
+    SKV_UNUSED(os::File::unlink(indexPath));
+    SKV_UNUSED(os::File::unlink(dirtyPath));
+
+    StorageEngine<> storage;
+    StorageEngine<>::OpenOptions opts;
+    opts.CompactionOnline = false;
+    opts.CheckpointIntervalMs = 0;
+
+    std::vector<IEntry::Handle> handles;
+
+    ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+    for (std::size_t i = 0; i < 16; ++i) {
+        handles.push_back(storage.newKey());
+
+        ASSERT_TRUE(storage.save(Record{handles.back(), "entry" + std::to_string(i)}).isOk());
+    }
+
+    for (auto i : {9, 3, 5})
+        ASSERT_TRUE(storage.remove(handles[i]).isOk());
+
+    for (auto i : {9, 3, 5, 7}) // key of existing record isn't reused
+        storage.reuseKey(handles[i]);
+
+    storage.reuseKey(StorageEngine<>::RootEntryId);
+    storage.reuseKey(handles.back() + 100); // never issued
+
+    // lowest first
+    EXPECT_EQ(storage.newKey(), handles[3]);
+
+    ASSERT_TRUE(storage.save(Record{handles[3], "reused"}).isOk());
+    ASSERT_TRUE(storage.close().isOk());
+
+    // free keys survive reopen
+    ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+    {
+        auto [status, record] = storage.load(handles[3]);
+
+        ASSERT_TRUE(status.isOk());
+        EXPECT_EQ(record.name(), "reused");
+    }
+
+    EXPECT_EQ(storage.newKey(), handles[5]);
+
+    ASSERT_TRUE(storage.save(Record{handles[5], "reused"}).isOk());
+
+    // crash: key issued and saved after checkpoint isn't free after log replay
+    os::fs::copy_file(indexPath, indexPath + ".bak", os::fs::copy_options::overwrite_existing);
+
+    EXPECT_EQ(storage.newKey(), handles[9]);
+
+    ASSERT_TRUE(storage.save(Record{handles[9], "reused"}).isOk());
+    ASSERT_TRUE(storage.close().isOk());
+
+    ASSERT_TRUE(os::File::unlink(indexPath + ".1")); // written by close
+    os::fs::copy_file(indexPath + ".bak", indexPath, os::fs::copy_options::overwrite_existing);
+    ASSERT_TRUE(os::File::open(dirtyPath, "w"));
+
+    ASSERT_TRUE(storage.open(STORAGE_DIR, STORAGE_NAME, opts).isOk());
+
+    for (auto i : {3, 5, 9}) {
+        auto [status, record] = storage.load(handles[i]);
+
+        ASSERT_TRUE(status.isOk());
+        EXPECT_EQ(record.name(), "reused");
+    }
+
+    EXPECT_EQ(storage.newKey(), handles.back() + 1);
+
+    ASSERT_TRUE(storage.close().isOk());
+
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(devicePath));
+    SKV_UNUSED(os::File::unlink(indexPath));
+    SKV_UNUSED(os::File::unlink(indexPath + ".1"));
+    SKV_UNUSED(os::File::unlink(indexPath + ".bak"));
 }
 
 int main(int argc, char** argv) {
@@ -3,6 +3,7 @@
 
 #include <gtest/gtest.h>
 
+#include <ondisk/SegmentedLogDevice.hpp>
 #include <ondisk/Volume.hpp>
 #include <os/File.hpp>
 #include <vfs/Storage.hpp>
@@ -58,9 +59,9 @@ protected:
     }
 
     void removeFiles() {
-        SKV_UNUSED(os::File::unlink(VOLUME_DIR + char(os::path::separator) + VOLUME_N1_NAME + ".logd"));
+        SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(VOLUME_DIR + char(os::path::separator) + VOLUME_N1_NAME + ".logd"));
         SKV_UNUSED(os::File::unlink(VOLUME_DIR + char(os::path::separator) + VOLUME_N1_NAME+ ".index"));
-        SKV_UNUSED(os::File::unlink(VOLUME_DIR + char(os::path::separator) + VOLUME_N2_NAME + ".logd"));
+        SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(VOLUME_DIR + char(os::path::separator) + VOLUME_N2_NAME + ".logd"));
         SKV_UNUSED(os::File::unlink(VOLUME_DIR + char(os::path::separator) + VOLUME_N2_NAME+ ".index"));
     }
 
@@ -4,9 +4,11 @@
 #include <functional>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include <gtest/gtest.h>
 
+#include <ondisk/SegmentedLogDevice.hpp>
 #include <ondisk/Volume.hpp>
 #include <os/File.hpp>
 #include <util/Log.hpp>
@@ -75,7 +77,7 @@ TEST(VolumeTest, MTTestN1) {
 
     ASSERT_TRUE(status.isOk());
 
-    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd"));
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd"));
     SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
 
     status = volume.initialize(STORAGE_DIR, STORAGE_NAME);
@@ -109,7 +111,7 @@ TEST(VolumeTest, MTTestN1) {
 
     std::this_thread::sleep_for(20ms);
 
-    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd"));
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd"));
     SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
 }
 
@@ -156,7 +158,7 @@ TEST(VolumeTest, MTTestN2) {
 
     ASSERT_TRUE(createStatus.isOk());
 
-    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd"));
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd"));
     SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
 
     auto opened = volume.initialize(STORAGE_DIR, STORAGE_NAME);
@@ -203,17 +205,251 @@ TEST(VolumeTest, MTTestN2) {
 
     std::this_thread::sleep_for(20ms);
 
-    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd"));
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd"));
     SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
 }
 
+TEST(VolumeTest, LinkBatch) {
+    Status status;
+    Volume volume{status};
+
+    ASSERT_TRUE(status.isOk());
+
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd"));
+    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
+
+    ASSERT_TRUE(volume.initialize(STORAGE_DIR, STORAGE_NAME).isOk());
+
+    std::vector<std::string> names;
+
+    for (std::size_t i = 0; i < 1000; ++i)
+        names.push_back("child" + std::to_string(i));
+
+    {
+        auto root = volume.entry("/");
+
+        ASSERT_TRUE(root != nullptr);
+        ASSERT_TRUE(volume.link(*root, names).isOk());
+
+        // duplicate name fails whole batch
+        EXPECT_FALSE(volume.link(*root, std::vector<std::string>{"new1", "child1", "new2"}).isOk());
+        EXPECT_FALSE(volume.link(*root, std::vector<std::string>{"new1", "a/b"}).isOk());
+
+        auto [lstatus, children] = root->links();
+
+        ASSERT_TRUE(lstatus.isOk());
+        EXPECT_EQ(children.size(), names.size());
+        EXPECT_EQ(children.count("new1"), 0u);
+
+        ASSERT_TRUE(root->setProperty("prop", 1).isOk());
+    }
+
+    ASSERT_TRUE(volume.deinitialize().isOk());
+    ASSERT_TRUE(volume.initialize(STORAGE_DIR, STORAGE_NAME).isOk());
+
+    {
+        auto root = volume.entry("/");
+
+        ASSERT_TRUE(root != nullptr);
+
+        auto [lstatus, children] = root->links();
+
+        ASSERT_TRUE(lstatus.isOk());
+        EXPECT_EQ(children.size(), names.size());
+
+        for (const auto& name : names)
+            EXPECT_TRUE(volume.entry("/" + name) != nullptr);
+    }
+
+    ASSERT_TRUE(volume.deinitialize().isOk());
+
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd"));
+    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
+}
+
+TEST(VolumeTest, HandleRecycling) {
+    Status status;
+    Volume volume{status};
+
+    ASSERT_TRUE(status.isOk());
+
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd"));
+    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
+
+    ASSERT_TRUE(volume.initialize(STORAGE_DIR, STORAGE_NAME).isOk());
+
+    IEntry::Handle removed;
+
+    {
+        auto root = volume.entry("/");
+
+        ASSERT_TRUE(root != nullptr);
+        ASSERT_TRUE(volume.link(*root, std::vector<std::string>{"a", "b", "c"}).isOk());
+
+        auto b = volume.entry("/b");
+
+        ASSERT_TRUE(b != nullptr);
+        ASSERT_TRUE(b->setProperty("prop", 1).isOk());
+
+        removed = b->handle();
+
+        EXPECT_FALSE(volume.unlink(*root, "b").isOk()); // opened
+    }
+
+    {
+        auto root = volume.entry("/");
+
+        ASSERT_TRUE(volume.unlink(*root, "b").isOk());
+        EXPECT_TRUE(volume.entry("/b") == nullptr);
+    }
+
+    {
+        auto root = volume.entry("/");
+
+        // removed handle is issued again once parent is saved, path cache doesn't lead to it
+        ASSERT_TRUE(volume.link(*root, "d").isOk());
+
+        auto d = volume.entry("/d");
+
+        ASSERT_TRUE(d != nullptr);
+        EXPECT_EQ(d->handle(), removed);
+        EXPECT_TRUE(volume.entry("/b") == nullptr);
+
+        auto [pstatus, props] = d->properties();
+
+        ASSERT_TRUE(pstatus.isOk());
+        EXPECT_TRUE(props.empty());
+
+        ASSERT_TRUE(volume.unlink(*root, "c").isOk());
+    }
+
+    // free handles are persisted with index table
+    ASSERT_TRUE(volume.deinitialize().isOk());
+    ASSERT_TRUE(volume.initialize(STORAGE_DIR, STORAGE_NAME).isOk());
+
+    {
+        auto root = volume.entry("/");
+
+        ASSERT_TRUE(root != nullptr);
+
+        ASSERT_TRUE(volume.entry("/a") != nullptr);
+
+        ASSERT_TRUE(volume.link(*root, "e").isOk());
+
+        auto e = volume.entry("/e");
+
+        ASSERT_TRUE(e != nullptr);
+        EXPECT_EQ(e->handle(), removed + 1);
+
+        auto [lstatus, children] = root->links();
+
+        ASSERT_TRUE(lstatus.isOk());
+        EXPECT_EQ(children.size(), 3u);
+    }
+
+    ASSERT_TRUE(volume.deinitialize().isOk());
+
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd"));
+    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
+}
+
+TEST(VolumeTest, HandleRecyclingCrash) {
+    const std::string crashName = STORAGE_NAME + "_crash";
+    const auto unlinkCrashed = [&crashName]() { // segments, index table and its deltas of copy
+        std::vector<os::path> files;
+
+        for (const auto& file : os::fs::directory_iterator(STORAGE_DIR)) {
+            if (file.path().filename().string().compare(0, crashName.size() + 1, crashName + ".") == 0)
+                files.push_back(file.path());
+        }
+
+        for (const auto& file : files)
+            SKV_UNUSED(os::File::unlink(file));
+    };
+    Status status;
+    Volume volume{status};
+
+    ASSERT_TRUE(status.isOk());
+
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd"));
+    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
+
+    ASSERT_TRUE(volume.initialize(STORAGE_DIR, STORAGE_NAME).isOk());
+
+    {
+        auto root = volume.entry("/");
+
+        ASSERT_TRUE(root != nullptr);
+        ASSERT_TRUE(volume.link(*root, "a").isOk());
+    }
+
+    ASSERT_TRUE(volume.deinitialize().isOk());
+    ASSERT_TRUE(volume.initialize(STORAGE_DIR, STORAGE_NAME).isOk());
+
+    {
+        auto root = volume.entry("/");
+
+        ASSERT_TRUE(root != nullptr);
+
+        const auto removed = volume.entry("/a")->handle();
+
+        ASSERT_TRUE(volume.unlink(*root, "a").isOk());
+        ASSERT_TRUE(volume.link(*root, "b").isOk());
+
+        auto b = volume.entry("/b");
+
+        ASSERT_TRUE(b != nullptr);
+        EXPECT_NE(b->handle(), removed); // root isn't saved yet
+        ASSERT_TRUE(b->setProperty("prop", 1).isOk());
+
+        b.reset();
+
+        // files are copied while root record without "a" isn't saved, as if process crashed
+        unlinkCrashed();
+
+        for (const auto& file : os::fs::directory_iterator(STORAGE_DIR)) {
+            const auto name = file.path().filename().string();
+
+            if (name.compare(0, STORAGE_NAME.size() + 1, STORAGE_NAME + ".") == 0)
+                os::fs::copy_file(file.path(), os::path{STORAGE_DIR} / (crashName + name.substr(STORAGE_NAME.size())),
+                                  os::fs::copy_options::overwrite_existing);
+        }
+    }
+
+    ASSERT_TRUE(volume.deinitialize().isOk());
+
+    {
+        Volume crashed{status};
+
+        ASSERT_TRUE(status.isOk());
+        ASSERT_TRUE(crashed.initialize(STORAGE_DIR, crashName).isOk());
+
+        // stale "a" of root doesn't lead to "b"
+        auto a = crashed.entry("/a");
+
+        if (a) {
+            auto [pstatus, props] = a->properties();
+
+            EXPECT_TRUE(pstatus.isOk() && props.empty());
+        }
+
+        a.reset();
+
+        ASSERT_TRUE(crashed.deinitialize().isOk());
+    }
+
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd"));
+    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
+    unlinkCrashed();
+}
+
 TEST(VolumeTest, OpenCloseLinkClaim) {
     Status status;
     Volume volume{status};
 
     ASSERT_TRUE(status.isOk());
 
-    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd"));
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd"));
     SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
 
     status = volume.initialize(STORAGE_DIR, STORAGE_NAME);
@@ -357,7 +593,7 @@ TEST(VolumeTest, OpenCloseLinkClaim) {
     ASSERT_TRUE(volume.deinitialize().isOk());
     ASSERT_FALSE(volume.initialized());
 
-    SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd"));
+    SKV_UNUSED(ondisk::SegmentedLogDevice<>::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".logd"));
     SKV_UNUSED(os::File::unlink(STORAGE_DIR + char(os::path::separator) + STORAGE_NAME + ".index"));
 }
 